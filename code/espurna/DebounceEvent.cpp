@@ -27,7 +27,9 @@
 
 */
 
+#include <algorithm>
 #include <functional>
+#include <limits>
 #include <memory>
 
 #include "compat.h"
@@ -95,51 +97,213 @@ unsigned long EventEmitter::getEventCount() {
     return _event_count;
 }
 
-// TODO: current implementation allows pin == nullptr
+EventEmitter::~EventEmitter() {
+    disableInterrupts();
+}
 
-types::Event EventEmitter::loop() {
+bool EventEmitter::enableInterrupts(unsigned char gpio, types::Notify notify) {
+    // GPIO16 is not connected to the GPIO interrupt handler
+    if (!_pin || (gpio >= 16)) {
+        return false;
+    }
 
-    static_assert((HIGH) == 1, "Arduino API HIGH is not 1");
-    static_assert((LOW) == 0, "Arduino API LOW is not 0");
+    disableInterrupts();
+
+    _edges.reset(new types::Edges());
+    _edges->notify = notify;
+    _edges->pin = gpio;
+    _pending = false;
+
+    ::attachInterruptArg(gpio, _isr, _edges.get(), CHANGE);
+
+    return true;
+}
+
+void EventEmitter::disableInterrupts() {
+    if (_edges) {
+        ::detachInterrupt(_edges->pin);
+        _edges.reset(nullptr);
+    }
+}
+
+// No need for any locks as it cannot be nested, esp8266/Arduino Core already masks all GPIO handlers before calling this function
+// Buffer contents must be written before the head is moved, consumer will not look past it
+
+void IRAM_ATTR EventEmitter::_isr(void* arg) {
+    auto* edges = reinterpret_cast<types::Edges*>(arg);
+
+    const uint8_t head = edges->head;
+    const uint8_t next = (head + 1) & (types::Edges::Capacity - 1);
+    if (next == edges->tail) {
+        edges->overflow = true;
+        return;
+    }
+
+    edges->buffer[head] = types::Edge{
+        .timestamp = esp_get_cycle_count(),
+        .value = (GPIP(edges->pin) != 0),
+    };
+
+    __asm__ __volatile__ ("" ::: "memory");
+    edges->head = next;
 
+    if (edges->notify) {
+        edges->notify();
+    }
+}
+
+types::Event EventEmitter::_change(unsigned long timestamp) {
     auto event = types::EventNone;
-    bool value = _pin->digitalRead() == (HIGH);
 
+    _value = !_value;
+
+    if (_is_switch) {
+        event = isPressed()
+            ? types::EventPressed
+            : types::EventReleased;
+    } else {
+        if (_value == _default_value) {
+            _event_length = timestamp - _event_start;
+            _ready = true;
+        } else {
+            event = types::EventPressed;
+            _event_start = timestamp;
+            _event_length = 0;
+            if (_reset_count) {
+                _event_count = 1;
+                _reset_count = false;
+            } else {
+                ++_event_count;
+            }
+            _ready = false;
+        }
+    }
+
+    return event;
+}
+
+// Value is only accepted when it is still the same after the debounce delay
+// (instead of blocking for the whole delay duration, check again on the next loop)
+
+types::Event EventEmitter::_pollPin() {
+    const auto now = millis();
+    const bool value = _pin->digitalRead() == (HIGH);
+
+    if (!_pending) {
+        if (value == _value) {
+            return types::EventNone;
+        }
+
+        _pending = true;
+        _pending_start = now;
+    }
+
+    if (now - _pending_start < _delay) {
+        return types::EventNone;
+    }
+
+    _pending = false;
     if (value != _value) {
+        return _change(now);
+    }
 
-        // TODO: check each loop instead of blocking?
-        auto start = millis();
-        while (millis() - start < _delay) delay(1);
+    return types::EventNone;
+}
 
-        value = _pin->digitalRead() == (HIGH);
-        if (value != _value) {
+// Edges are timestamped by the ISR, debounce delay is applied between them instead of the loop() calls.
+// Value is accepted when there are no other edges for the duration of the debounce delay, and the
+// event timestamp is the time of the edge itself. Only one change is resolved per loop(), any
+// remaining edges are kept in the buffer until the next call.
 
-            _value = !_value;
+types::Event EventEmitter::_pollEdges() {
+    auto& edges = *_edges;
 
-            if (_is_switch) {
-                event = isPressed()
-                    ? types::EventPressed
-                    : types::EventReleased;
-            } else {
-                if (_value == _default_value) {
-                    _event_length = millis() - _event_start;
-                    _ready = true;
-                } else {
-                    event = types::EventPressed;
-                    _event_start = millis();
-                    _event_length = 0;
-                    if (_reset_count) {
-                        _event_count = 1;
-                        _reset_count = false;
-                    } else {
-                        ++_event_count;
-                    }
-                    _ready = false;
-                }
+    const auto now = millis();
+
+    // buffer was full and we lost some edges, continue from the current pin value
+    if (edges.overflow) {
+        edges.tail = edges.head;
+        edges.overflow = false;
+
+        _pending = true;
+        _pending_value = _pin->digitalRead() == (HIGH);
+        _pending_start = now;
+    }
+
+    const auto head = edges.head;
+    __asm__ __volatile__ ("" ::: "memory");
+
+    // Every edge up to the head was stored before this point, so the cycle count difference is always
+    // the actual age of the edge, even when the counter wraps around (every ~26s at 160MHz).
+    // Anything older than that would have to be left in the buffer without a loop() call for as long
+    const uint32_t now_cycles = esp_get_cycle_count();
+
+    while (edges.tail != head) {
+        const auto& edge = edges.buffer[edges.tail];
+        const uint32_t age = now_cycles - edge.timestamp;
+        const unsigned long timestamp = now - (clockCyclesToMicroseconds(age) / 1000ul);
+
+        // previous value was stable long enough, resolve it before looking at the next edge
+        if (_pending && (timestamp - _pending_start >= _delay)) {
+            _pending = false;
+            if (_pending_value != _value) {
+                return _change(_pending_start);
             }
         }
+
+        _pending = true;
+        _pending_value = edge.value;
+        _pending_start = timestamp;
+
+        edges.tail = (edges.tail + 1) & (types::Edges::Capacity - 1);
     }
 
+    if (_pending && (now - _pending_start >= _delay)) {
+        _pending = false;
+        if (_pending_value != _value) {
+            return _change(_pending_start);
+        }
+    }
+
+    return types::EventNone;
+}
+
+unsigned long EventEmitter::deadline() const {
+    const auto now = millis();
+
+    unsigned long out { _delay };
+    if (_edges) {
+        if (_edges->overflow || (_edges->head != _edges->tail)) {
+            return 0;
+        }
+
+        out = std::numeric_limits<unsigned long>::max();
+    }
+
+    if (_pending) {
+        const auto elapsed = now - _pending_start;
+        out = (elapsed < _delay) ? (_delay - elapsed) : 0;
+    }
+
+    if (_ready) {
+        const auto elapsed = now - _event_start;
+        out = std::min(out, (elapsed <= _repeat) ? (_repeat - elapsed + 1) : 0);
+    }
+
+    return out;
+}
+
+// TODO: current implementation allows pin == nullptr
+
+types::Event EventEmitter::loop() {
+
+    static_assert((HIGH) == 1, "Arduino API HIGH is not 1");
+    static_assert((LOW) == 0, "Arduino API LOW is not 0");
+
+    auto event = _edges
+        ? _pollEdges()
+        : _pollPin();
+
     if (_ready && (millis() - _event_start > _repeat)) {
         _ready = false;
         _reset_count = true;
@@ -25,7 +25,6 @@ Copyright (C) 2020-2021 by Maxim Prokhorov <prokhorov dot max at outlook dot com
 #include <algorithm>
 #include <memory>
 #include <cstring>
-#include <forward_list>
 #include <vector>
 
 #include "system.h"
@@ -35,233 +34,6 @@ Copyright (C) 2020-2021 by Maxim Prokhorov <prokhorov dot max at outlook dot com
 
 // -----------------------------------------------------------------------------
 
-PathParts::PathParts(espurna::StringView path) :
-    _path(path)
-{
-    if (!_path.length()) {
-        _ok = false;
-        return;
-    }
-
-    PathPart::Type type { PathPart::Type::Unknown };
-    size_t length { 0ul };
-    size_t offset { 0ul };
-
-    const char* p { _path.begin() };
-    if (*p == '\0') {
-       goto error;
-    }
-
-    _parts.reserve(std::count(_path.begin(), _path.end(), '/') + 1);
-
-start:
-    type = PathPart::Type::Unknown;
-    length = 0;
-    offset = p - _path.c_str();
-
-    switch (*p) {
-    case '+':
-        goto parse_single_wildcard;
-    case '#':
-        goto parse_multi_wildcard;
-    case '/':
-    default:
-        goto parse_value;
-    }
-
-parse_value:
-    type = PathPart::Type::Value;
-
-    switch (*p) {
-    case '+':
-    case '#':
-        goto error;
-    case '/':
-    case '\0':
-        goto push_result;
-    }
-
-    ++p;
-    ++length;
-
-    goto parse_value;
-
-parse_single_wildcard:
-    type = PathPart::Type::SingleWildcard;
-
-    ++p;
-    switch (*p) {
-    case '/':
-        ++p;
-    case '\0':
-        goto push_result;
-    }
-
-    goto error;
-
-parse_multi_wildcard:
-    type = PathPart::Type::MultiWildcard;
-
-    ++p;
-    if (*p == '\0') {
-        goto push_result;
-    }
-    goto error;
-
-push_result:
-    emplace_back(type, offset, length);
-    if (*p == '/') {
-        ++p;
-        goto start;
-    } else if (*p != '\0') {
-        goto start;
-    }
-    goto success;
-
-error:
-    _ok = false;
-    _parts.clear();
-    return;
-
-success:
-    _ok = true;
-}
-
-// match when, for example, given the path 'topic/one/two/three' and pattern 'topic/+/two/+'
-
-bool PathParts::match(const PathParts& path) const {
-    if (!_ok || !path) {
-        return false;
-    }
-
-    auto lhs = begin();
-    auto lhs_end = end();
-
-    auto rhs = path.begin();
-    auto rhs_end = path.end();
-loop:
-    if (lhs == lhs_end) {
-        goto check_end;
-    }
-
-    switch ((*lhs).type) {
-    case PathPart::Type::Value:
-        if (
-            (rhs != rhs_end)
-            && ((*rhs).type == PathPart::Type::Value)
-            && ((*rhs).length == (*lhs).length)
-        ) {
-            if (0 == std::memcmp(
-                _path.c_str() + (*lhs).offset,
-                path.path().c_str() + (*rhs).offset,
-                (*rhs).length))
-            {
-                std::advance(lhs, 1);
-                std::advance(rhs, 1);
-                goto loop;
-            }
-        }
-        goto error;
-
-    case PathPart::Type::SingleWildcard:
-        if (
-            (rhs != rhs_end)
-            && ((*rhs).type == PathPart::Type::Value)
-        ) {
-            std::advance(lhs, 1);
-            std::advance(rhs, 1);
-            goto loop;
-        }
-        goto error;
-
-    case PathPart::Type::MultiWildcard:
-        if (std::next(lhs) == lhs_end) {
-            while (rhs != rhs_end) {
-                if ((*rhs).type != PathPart::Type::Value) {
-                    goto error;
-                }
-                std::advance(rhs, 1);
-            }
-            lhs = lhs_end;
-            break;
-        }
-        goto error;
-
-    case PathPart::Type::Unknown:
-        goto error;
-    };
-
-check_end:
-    if ((lhs == lhs_end) && (rhs == rhs_end)) {
-        return true;
-    }
-
-error:
-    return false;
-}
-
-espurna::StringView PathParts::wildcard(const PathParts& pattern, const PathParts& value, int index) {
-    if (index < 0) {
-        index = std::abs(index + 1);
-    }
-
-    espurna::StringView out;
-
-    if (std::abs(index) < pattern.parts().size()) {
-        const auto& pattern_parts = pattern.parts();
-        int counter { 0 };
-
-        for (size_t part = 0; part < pattern.size(); ++part) {
-            const auto& lhs = pattern_parts[part];
-            const auto& rhs = value.parts()[part];
-
-            const auto path = value.path();
-
-            switch (lhs.type) {
-            case PathPart::Type::Value:
-            case PathPart::Type::Unknown:
-                break;
-
-            case PathPart::Type::SingleWildcard:
-                if (counter == index) {
-                    out = espurna::StringView(
-                        path.begin() + rhs.offset, path.begin() + rhs.offset + rhs.length);
-                    return out;
-                }
-                ++counter;
-                break;
-
-            case PathPart::Type::MultiWildcard:
-                if (counter == index) {
-                    out = espurna::StringView(
-                        path.begin() + rhs.offset, path.end());
-                }
-                return out;
-            }
-        }
-    }
-
-    return out;
-}
-
-size_t PathParts::wildcards(const PathParts& pattern) {
-    size_t out { 0 };
-
-    for (const auto& part : pattern) {
-        switch (part.type) {
-        case PathPart::Type::Unknown:
-        case PathPart::Type::Value:
-        case PathPart::Type::MultiWildcard:
-            break;
-        case PathPart::Type::SingleWildcard:
-            ++out;
-            break;
-        }
-    }
-
-    return out;
-}
-
 #if WEB_SUPPORT
 String ApiRequest::wildcard(int index) const {
     return PathParts::wildcard(_pattern, _parts, index).toString();
@@ -364,11 +136,18 @@ bool is_json(AsyncWebServerRequest* request) {
 // - ALL headers are parsed (and we could access those during filter and canHandle callbacks), but we need to explicitly
 //   request them to stay in memory so that the actual handler can work with them
 
-void attach_helper(AsyncWebServerRequest& request, RequestHelper&& helper) {
-    request._tempObject = new RequestHelper(std::move(helper));
+class BaseWebHandler;
+
+struct RouteHelper {
+    BaseWebHandler& handler;
+    RequestHelper helper;
+};
+
+void attach_helper(AsyncWebServerRequest& request, RouteHelper&& helper) {
+    request._tempObject = new RouteHelper(std::move(helper));
     request.onDisconnect(
         [&]() {
-            auto* ptr = reinterpret_cast<RequestHelper*>(request._tempObject);
+            auto* ptr = reinterpret_cast<RouteHelper*>(request._tempObject);
             delete ptr;
             request._tempObject = nullptr;
         });
@@ -378,7 +157,18 @@ void attach_helper(AsyncWebServerRequest& request, RequestHelper&& helper) {
         STRING_VIEW("Accept").toString());
 }
 
-class BaseWebHandler : public AsyncWebHandler {
+RouteHelper& route_helper(AsyncWebServerRequest* request) {
+    return *reinterpret_cast<RouteHelper*>(request->_tempObject);
+}
+
+RequestHelper& request_helper(AsyncWebServerRequest* request) {
+    return route_helper(request).helper;
+}
+
+// Handlers are never added to the webserver directly, see Router below.
+// canHandle() is only called when path already matched the pattern.
+
+class BaseWebHandler {
 public:
     BaseWebHandler() = delete;
 
@@ -397,6 +187,14 @@ public:
         _parts(_pattern)
     {}
 
+    virtual ~BaseWebHandler() = default;
+
+    virtual bool canHandle(AsyncWebServerRequest*) = 0;
+    virtual void handleRequest(AsyncWebServerRequest*) = 0;
+
+    virtual void handleBody(AsyncWebServerRequest*, uint8_t*, size_t, size_t, size_t) {
+    }
+
     const String& pattern() const {
         return _pattern;
     }
@@ -439,41 +237,32 @@ public:
         _put(std::forward<Put>(put))
     {}
 
-    bool isRequestHandlerTrivial() override {
-        return true;
-    }
-
     bool canHandle(AsyncWebServerRequest* request) override {
-        if (!apiEnabled()) {
+        if (!apiAuthenticate(request)) {
             return false;
         }
 
-        auto helper = RequestHelper(*request, parts());
-        if (helper.match() && apiAuthenticate(request)) {
-            switch (request->method()) {
-            case HTTP_HEAD:
-                return true;
-            case HTTP_PUT:
-                if (!is_json(request)) {
-                    return false;
-                }
-                if (!_put) {
-                    return false;
-                }
-                // fallthrough!
-            case HTTP_GET:
-                if (!_get) {
-                    return false;
-                }
-                break;
-            default:
+        switch (request->method()) {
+        case HTTP_HEAD:
+            return true;
+        case HTTP_PUT:
+            if (!is_json(request)) {
                 return false;
             }
-            attach_helper(*request, std::move(helper));
-            return true;
+            if (!_put) {
+                return false;
+            }
+            // fallthrough!
+        case HTTP_GET:
+            if (!_get) {
+                return false;
+            }
+            break;
+        default:
+            return false;
         }
 
-        return false;
+        return true;
     }
 
     void _handleGet(AsyncWebServerRequest* request, Request& apireq) {
@@ -508,9 +297,7 @@ public:
             return;
         }
 
-        auto& helper = *reinterpret_cast<RequestHelper*>(request->_tempObject);
-
-        auto apireq = helper.request();
+        auto apireq = request_helper(request).request();
         if (!_put(apireq, root)) {
             request->send(500);
             return;
@@ -537,15 +324,13 @@ public:
             return;
         }
 
-        auto& helper = *reinterpret_cast<RequestHelper*>(request->_tempObject);
-
         switch (request->method()) {
         case HTTP_HEAD:
             request->send(204);
             return;
 
         case HTTP_GET: {
-            auto apireq = helper.request();
+            auto apireq = request_helper(request).request();
             _handleGet(request, apireq);
             return;
         }
@@ -571,8 +356,6 @@ private:
 // ESPurna legacy API configuration
 // - ?apikey=... to authorize in GET or PUT
 // - ?anything=... for input data (common key is "value")
-// MUST correctly override isRequestHandlerTrivial() to allow auth with PUT
-// (i.e. so that ESPAsyncWebServer parses the body and adds form-data to request params list)
 
 class BasicWebHandler final : public BaseWebHandler {
 public:
@@ -583,15 +366,7 @@ public:
         _put(std::forward<Put>(put))
     {}
 
-    bool isRequestHandlerTrivial() override {
-        return false;
-    }
-
     bool canHandle(AsyncWebServerRequest* request) override {
-        if (!apiEnabled()) {
-            return false;
-        }
-
         switch (request->method()) {
         case HTTP_HEAD:
         case HTTP_GET:
@@ -605,13 +380,7 @@ public:
             return false;
         }
 
-        auto helper = RequestHelper(*request, parts());
-        if (helper.match()) {
-            attach_helper(*request, std::move(helper));
-            return true;
-        }
-
-        return false;
+        return true;
     }
 
     void handleRequest(AsyncWebServerRequest* request) override {
@@ -640,9 +409,7 @@ public:
 
         case HTTP_GET:
         case HTTP_PUT: {
-            auto& helper = *reinterpret_cast<RequestHelper*>(request->_tempObject);
-
-            auto apireq = helper.request();
+            auto apireq = request_helper(request).request();
             if (is_put) {
                 if (!_put(apireq)) {
                     request->send(500);
@@ -689,12 +456,92 @@ private:
     BasicHandler _put;
 };
 
+// Single webserver handler for every registered API path.
+// Instead of each handler parsing and matching the request path in turn, patterns are
+// arranged into a tree and the request path is resolved in one walk. When multiple
+// patterns match, the handler registered first wins (just like webserver would do)
+// MUST correctly override isRequestHandlerTrivial() to allow auth with PUT in the legacy API
+// (i.e. so that ESPAsyncWebServer parses the body and adds form-data to request params list)
+// JSON API only accepts json content-type for PUT requests, which are never parsed like that
+
+class Router final : public AsyncWebHandler {
+public:
+    using Handlers = std::vector<std::unique_ptr<BaseWebHandler>>;
+
+    bool isRequestHandlerTrivial() override {
+        return false;
+    }
+
+    bool canHandle(AsyncWebServerRequest* request) override {
+        if (!apiEnabled()) {
+            return false;
+        }
+
+        auto path = PathParts(request->url());
+
+        size_t route { PathTree::Invalid };
+        _tree.match(path,
+            [&](size_t index) {
+                if ((index < route) && _handlers[index]->canHandle(request)) {
+                    route = index;
+                }
+            });
+
+        if (route == PathTree::Invalid) {
+            return false;
+        }
+
+        auto& handler = *_handlers[route];
+        attach_helper(*request,
+            RouteHelper{
+                .handler = handler,
+                .helper = RequestHelper(*request, handler.parts(), std::move(path)),
+            });
+
+        return true;
+    }
+
+    void handleBody(AsyncWebServerRequest* request, uint8_t* data, size_t len, size_t index, size_t total) override {
+        route_helper(request).handler.handleBody(request, data, len, index, total);
+    }
+
+    void handleRequest(AsyncWebServerRequest* request) override {
+        route_helper(request).handler.handleRequest(request);
+    }
+
+    void add(BaseWebHandler* ptr) {
+        if (_tree.add(ptr->parts()) == PathTree::Invalid) {
+            delete ptr;
+            return;
+        }
+
+        _handlers.emplace_back(ptr);
+    }
+
+    const Handlers& handlers() const {
+        return _handlers;
+    }
+
+private:
+    PathTree _tree;
+    Handlers _handlers;
+};
+
 namespace internal {
 
-std::forward_list<BaseWebHandler*> list;
+Router* router { nullptr };
 
 } // namespace internal
 
+Router& router() {
+    if (!internal::router) {
+        internal::router = new Router();
+        webServer().addHandler(internal::router);
+    }
+
+    return *internal::router;
+}
+
 namespace simple {
 
 bool ok(Request& request) {
@@ -714,8 +561,7 @@ bool error(ApiRequest& request) {
 STRING_VIEW_INLINE(BasePath, API_BASE_PATH);
 
 void add(BaseWebHandler* ptr) {
-    webServer().addHandler(ptr);
-    internal::list.emplace_front(ptr);
+    router().add(ptr);
 }
 
 template <typename Handler, typename Get, typename Put>
@@ -739,8 +585,10 @@ void setup() {
         STRING_VIEW("list"),
         [](Request& request) {
             String paths;
-            for (auto& api : internal::list) {
-                paths += api->pattern();
+
+            const auto& handlers = router().handlers();
+            for (auto it = handlers.rbegin(); it != handlers.rend(); ++it) {
+                paths += (*it)->pattern();
                 paths += '\r';
                 paths += '\n';
             }
@@ -112,6 +112,14 @@ struct RequestHelper {
         _match(_pattern.match(_path))
     {}
 
+    // &path was already parsed from request->url() and matched against the &pattern
+    RequestHelper(AsyncWebServerRequest& request, const PathParts& pattern, PathParts&& path) :
+        _request(request),
+        _pattern(pattern),
+        _path(std::move(path)),
+        _match(true)
+    {}
+
     Request request() const {
         return Request(_request, _pattern, _path);
     }
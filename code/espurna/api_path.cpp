@@ -0,0 +1,354 @@
+/*
+
+Part of the API MODULE
+
+Copyright (C) 2021 by Maxim Prokhorov <prokhorov dot max at outlook dot com>
+
+*/
+
+#include <Arduino.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#include "api_path.h"
+
+PathParts::PathParts(espurna::StringView path) :
+    _path(path)
+{
+    if (!_path.length()) {
+        _ok = false;
+        return;
+    }
+
+    PathPart::Type type { PathPart::Type::Unknown };
+    size_t length { 0ul };
+    size_t offset { 0ul };
+
+    const char* p { _path.begin() };
+    if (*p == '\0') {
+       goto error;
+    }
+
+    _parts.reserve(std::count(_path.begin(), _path.end(), '/') + 1);
+
+start:
+    type = PathPart::Type::Unknown;
+    length = 0;
+    offset = p - _path.c_str();
+
+    switch (*p) {
+    case '+':
+        goto parse_single_wildcard;
+    case '#':
+        goto parse_multi_wildcard;
+    case '/':
+    default:
+        goto parse_value;
+    }
+
+parse_value:
+    type = PathPart::Type::Value;
+
+    switch (*p) {
+    case '+':
+    case '#':
+        goto error;
+    case '/':
+    case '\0':
+        goto push_result;
+    }
+
+    ++p;
+    ++length;
+
+    goto parse_value;
+
+parse_single_wildcard:
+    type = PathPart::Type::SingleWildcard;
+
+    ++p;
+    switch (*p) {
+    case '/':
+        ++p;
+    case '\0':
+        goto push_result;
+    }
+
+    goto error;
+
+parse_multi_wildcard:
+    type = PathPart::Type::MultiWildcard;
+
+    ++p;
+    if (*p == '\0') {
+        goto push_result;
+    }
+    goto error;
+
+push_result:
+    emplace_back(type, offset, length);
+    if (*p == '/') {
+        ++p;
+        goto start;
+    } else if (*p != '\0') {
+        goto start;
+    }
+    goto success;
+
+error:
+    _ok = false;
+    _parts.clear();
+    return;
+
+success:
+    _ok = true;
+}
+
+// match when, for example, given the path 'topic/one/two/three' and pattern 'topic/+/two/+'
+
+bool PathParts::match(const PathParts& path) const {
+    if (!_ok || !path) {
+        return false;
+    }
+
+    auto lhs = begin();
+    auto lhs_end = end();
+
+    auto rhs = path.begin();
+    auto rhs_end = path.end();
+loop:
+    if (lhs == lhs_end) {
+        goto check_end;
+    }
+
+    switch ((*lhs).type) {
+    case PathPart::Type::Value:
+        if (
+            (rhs != rhs_end)
+            && ((*rhs).type == PathPart::Type::Value)
+            && ((*rhs).length == (*lhs).length)
+        ) {
+            if (0 == std::memcmp(
+                _path.c_str() + (*lhs).offset,
+                path.path().c_str() + (*rhs).offset,
+                (*rhs).length))
+            {
+                std::advance(lhs, 1);
+                std::advance(rhs, 1);
+                goto loop;
+            }
+        }
+        goto error;
+
+    case PathPart::Type::SingleWildcard:
+        if (
+            (rhs != rhs_end)
+            && ((*rhs).type == PathPart::Type::Value)
+        ) {
+            std::advance(lhs, 1);
+            std::advance(rhs, 1);
+            goto loop;
+        }
+        goto error;
+
+    case PathPart::Type::MultiWildcard:
+        if (std::next(lhs) == lhs_end) {
+            while (rhs != rhs_end) {
+                if ((*rhs).type != PathPart::Type::Value) {
+                    goto error;
+                }
+                std::advance(rhs, 1);
+            }
+            lhs = lhs_end;
+            break;
+        }
+        goto error;
+
+    case PathPart::Type::Unknown:
+        goto error;
+    };
+
+check_end:
+    if ((lhs == lhs_end) && (rhs == rhs_end)) {
+        return true;
+    }
+
+error:
+    return false;
+}
+
+espurna::StringView PathParts::wildcard(const PathParts& pattern, const PathParts& value, int index) {
+    if (index < 0) {
+        index = std::abs(index + 1);
+    }
+
+    espurna::StringView out;
+
+    if (std::abs(index) < pattern.parts().size()) {
+        const auto& pattern_parts = pattern.parts();
+        int counter { 0 };
+
+        for (size_t part = 0; part < pattern.size(); ++part) {
+            const auto& lhs = pattern_parts[part];
+            const auto& rhs = value.parts()[part];
+
+            const auto path = value.path();
+
+            switch (lhs.type) {
+            case PathPart::Type::Value:
+            case PathPart::Type::Unknown:
+                break;
+
+            case PathPart::Type::SingleWildcard:
+                if (counter == index) {
+                    out = espurna::StringView(
+                        path.begin() + rhs.offset, path.begin() + rhs.offset + rhs.length);
+                    return out;
+                }
+                ++counter;
+                break;
+
+            case PathPart::Type::MultiWildcard:
+                if (counter == index) {
+                    out = espurna::StringView(
+                        path.begin() + rhs.offset, path.end());
+                }
+                return out;
+            }
+        }
+    }
+
+    return out;
+}
+
+size_t PathParts::wildcards(const PathParts& pattern) {
+    size_t out { 0 };
+
+    for (const auto& part : pattern) {
+        switch (part.type) {
+        case PathPart::Type::Unknown:
+        case PathPart::Type::Value:
+        case PathPart::Type::MultiWildcard:
+            break;
+        case PathPart::Type::SingleWildcard:
+            ++out;
+            break;
+        }
+    }
+
+    return out;
+}
+
+// Segments are ordered by length first, so that most comparisons would not need to look at the contents
+
+namespace {
+
+bool segment_less(espurna::StringView lhs, espurna::StringView rhs) {
+    if (lhs.length() != rhs.length()) {
+        return lhs.length() < rhs.length();
+    }
+
+    return std::memcmp(lhs.data(), rhs.data(), lhs.length()) < 0;
+}
+
+} // namespace
+
+size_t PathTree::lookup(const Node& node, espurna::StringView segment) const {
+    const auto it = std::lower_bound(
+        node.literals.begin(), node.literals.end(), segment,
+        [&](size_t lhs, espurna::StringView rhs) {
+            return segment_less(_nodes[lhs].segment, rhs);
+        });
+
+    if ((it != node.literals.end())
+        && (_nodes[*it].segment.length() == segment.length())
+        && (0 == std::memcmp(_nodes[*it].segment.c_str(), segment.data(), segment.length())))
+    {
+        return *it;
+    }
+
+    return 0;
+}
+
+size_t PathTree::child(size_t index, espurna::StringView segment) {
+    auto out = lookup(_nodes[index], segment);
+    if (out) {
+        return out;
+    }
+
+    out = _nodes.size();
+    _nodes.push_back(Node{
+        .segment = segment.toString(),
+        .literals = {},
+        .single = 0,
+        .routes = {},
+        .multi = {},
+    });
+
+    auto& literals = _nodes[index].literals;
+    literals.insert(
+        std::lower_bound(literals.begin(), literals.end(), segment,
+            [&](size_t lhs, espurna::StringView rhs) {
+                return segment_less(_nodes[lhs].segment, rhs);
+            }),
+        out);
+
+    return out;
+}
+
+size_t PathTree::single(size_t index) {
+    if (!_nodes[index].single) {
+        _nodes[index].single = _nodes.size();
+        _nodes.push_back(Node{});
+    }
+
+    return _nodes[index].single;
+}
+
+size_t PathTree::add(const PathParts& pattern) {
+    if (!pattern) {
+        return Invalid;
+    }
+
+    if (_nodes.empty()) {
+        _nodes.push_back(Node{});
+    }
+
+    const auto route = _routes++;
+
+    size_t node { 0 };
+    for (size_t part = 0; part < pattern.size(); ++part) {
+        switch (pattern.parts()[part].type) {
+        case PathPart::Type::Value:
+            node = child(node, pattern[part]);
+            break;
+
+        case PathPart::Type::SingleWildcard:
+            node = single(node);
+            break;
+
+        // parser only allows '#' as the last part
+        case PathPart::Type::MultiWildcard:
+            _nodes[node].multi.push_back(route);
+            return route;
+
+        case PathPart::Type::Unknown:
+            break;
+        }
+    }
+
+    _nodes[node].routes.push_back(route);
+
+    return route;
+}
+
+size_t PathTree::find(const PathParts& path) const {
+    size_t out { Invalid };
+    match(path, [&](size_t route) {
+        out = std::min(out, route);
+    });
+
+    return out;
+}
@@ -9,6 +9,8 @@ Copyright (C) 2021 by Maxim Prokhorov <prokhorov dot max at outlook dot com>
 #pragma once
 
 #include <Arduino.h>
+
+#include <limits>
 #include <vector>
 
 #include "types.h"
@@ -127,3 +129,89 @@ private:
     Parts _parts;
     bool _ok { false };
 };
+
+// Multiple patterns, arranged as a tree of path segments.
+// Every level keeps literal segments sorted, plus optional '+' and '#' branches, so
+// the path is resolved in a single walk instead of matching every pattern separately.
+// Matching routes are reported by their index, in the order they were add()'ed
+
+struct PathTree {
+    static constexpr size_t Invalid { std::numeric_limits<size_t>::max() };
+
+    // Pattern segments are copied, PathParts does not need to outlive the tree
+    size_t add(const PathParts& pattern);
+
+    // Callback is called for every route matching the path, in no particular order
+    template <typename T>
+    void match(const PathParts& path, T&& callback) const {
+        if (!path || _nodes.empty()) {
+            return;
+        }
+
+        // wildcards in the path itself never match anything
+        for (const auto& part : path) {
+            if (part.type != PathPart::Type::Value) {
+                return;
+            }
+        }
+
+        walk(0, path, 0, callback);
+    }
+
+    // Lowest matching route index, or Invalid when nothing matches
+    size_t find(const PathParts& path) const;
+
+    size_t routes() const {
+        return _routes;
+    }
+
+    size_t nodes() const {
+        return _nodes.size();
+    }
+
+    void clear() {
+        _nodes.clear();
+        _routes = 0;
+    }
+
+private:
+    struct Node {
+        String segment;
+        std::vector<size_t> literals;
+        size_t single { 0 };
+        std::vector<size_t> routes;
+        std::vector<size_t> multi;
+    };
+
+    template <typename T>
+    void walk(size_t index, const PathParts& path, size_t part, T& callback) const {
+        const auto& node = _nodes[index];
+        for (const auto route : node.multi) {
+            callback(route);
+        }
+
+        if (part == path.size()) {
+            for (const auto route : node.routes) {
+                callback(route);
+            }
+            return;
+        }
+
+        const auto literal = lookup(node, path[part]);
+        if (literal) {
+            walk(literal, path, part + 1, callback);
+        }
+
+        if (node.single) {
+            walk(node.single, path, part + 1, callback);
+        }
+    }
+
+    // root node is never a child, so 0 also means 'not found'
+    size_t lookup(const Node&, espurna::StringView) const;
+    size_t child(size_t index, espurna::StringView);
+    size_t single(size_t index);
+
+    std::vector<Node> _nodes;
+    size_t _routes { 0 };
+};
@@ -108,6 +108,7 @@ PROGMEM_STRING(DebounceDelay, "btnDebDel");
 PROGMEM_STRING(LongClickDelay, "btnLclkDel");
 PROGMEM_STRING(LongLongClickDelay, "btnLLclkDel");
 PROGMEM_STRING(RepeatDelay, "btnRepDel");
+PROGMEM_STRING(Interrupt, "btnIntr");
 
 PROGMEM_STRING(Relay, "btnRelay");
 
@@ -510,6 +511,10 @@ constexpr unsigned long debounceDelay(size_t index) {
     );
 }
 
+constexpr bool interrupt() {
+    return 1 == BUTTON_INTERRUPT_MODE;
+}
+
 constexpr unsigned long repeatDelay() {
     return BUTTON_REPEAT_DELAY;
 }
@@ -729,6 +734,10 @@ unsigned long repeatDelay(size_t index) {
     return internal::indexedThenGlobal(keys::RepeatDelay, index, build::repeatDelay(index));
 }
 
+bool interrupt(size_t index) {
+    return internal::indexedThenGlobal(keys::Interrupt, index, build::interrupt());
+}
+
 [[gnu::unused]]
 size_t relay(size_t index) {
     return getSetting({keys::Relay, index}, build::relay(index));
@@ -783,6 +792,7 @@ ID_VALUE(longLongClick, settings::longLongClick)
 ID_VALUE(debounceDelay, settings::debounceDelay)
 ID_VALUE(longClickDelay, settings::longClickDelay)
 ID_VALUE(longLongClickDelay, settings::longLongClickDelay)
+ID_VALUE(interrupt, settings::interrupt)
 
 #if RELAY_SUPPORT
 ID_VALUE(relay, settings::relay)
@@ -817,6 +827,7 @@ static constexpr espurna::settings::query::IndexedSetting IndexedSettings[] PROG
     {keys::DebounceDelay, internal::debounceDelay},
     {keys::LongClickDelay, internal::longClickDelay},
     {keys::LongLongClickDelay, internal::longLongClickDelay},
+    {keys::Interrupt, internal::interrupt},
 #if RELAY_SUPPORT
     {keys::Relay, internal::relay},
 #endif
@@ -1277,6 +1288,21 @@ void buttonLoop() {
             buttonEvent(id, event);
         }
     }
+
+#if LOOP_ADAPTIVE_SUPPORT
+    // polled buttons always need the next check, interrupt-driven ones
+    // only need it while debouncing or waiting for the repeat delay
+    auto deadline = std::numeric_limits<unsigned long>::max();
+    for (const auto& button : espurna::button::internal::buttons) {
+        if (button.event_emitter) {
+            deadline = std::min(deadline, button.event_emitter->deadline());
+        }
+    }
+
+    if (deadline != std::numeric_limits<unsigned long>::max()) {
+        espurnaLoopDeadline(espurna::duration::Milliseconds(deadline));
+    }
+#endif
 }
 
 // Resistor ladder buttons. Inspired by:
@@ -1510,8 +1536,25 @@ bool _buttonSetupProvider(size_t index, ButtonProvider provider) {
             break;
         }
 
+        const auto gpio = pin->pin();
         _buttonAddWithPin(index, std::move(pin));
         result = true;
+
+        // hardware pins can avoid polling & report timestamped changes
+        if ((ButtonProvider::Gpio == provider)
+         && (GpioType::Hardware == espurna::button::settings::pinType(index))
+         && espurna::button::settings::interrupt(index))
+        {
+            auto& emitter = espurna::button::internal::buttons.back().event_emitter;
+#if LOOP_ADAPTIVE_SUPPORT
+            const auto notify = espurnaLoopWake;
+#else
+            const debounce_event::types::Notify notify = nullptr;
+#endif
+            if (!emitter->enableInterrupts(gpio, notify)) {
+                DEBUG_MSG_P(PSTR("[BUTTON] GPIO%hhu does not support interrupts\n"), gpio);
+            }
+        }
 #endif
         break;
     }
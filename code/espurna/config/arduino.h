@@ -201,6 +201,8 @@
 //#define BUTTON_PROVIDER_GPIO_SUPPORT 1
 //#define BUTTON_SUPPORT 1
 //#define DEBUG_LOG_BUFFER_SUPPORT 1
+//#define DEBUG_LOG_COMPACT_SUPPORT 1
+//#define DEBUG_LOG_QUEUE_SUPPORT 1
 //#define DEBUG_SERIAL_SUPPORT 1
 //#define DEBUG_SUPPORT 1
 //#define DEBUG_TELNET_SUPPORT 1
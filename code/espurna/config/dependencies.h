@@ -48,6 +48,15 @@
 #define TERMINAL_SERIAL_SUPPORT     0
 #endif
 
+#if GARLAND_SUPPORT && (GARLAND_OUTPUT == GARLAND_OUTPUT_I2S_DMA)
+#undef TERMINAL_SERIAL_SUPPORT
+#define TERMINAL_SERIAL_SUPPORT     0           // I2S data pin is the serial RX pin
+#if UART1_RX_PIN == 3
+#undef UART1_RX_PIN
+#define UART1_RX_PIN                GPIO_NONE   // Serial is TX only, debug output is still available
+#endif
+#endif
+
 #if not UART_SUPPORT
 #undef DEBUG_SERIAL_SUPPORT
 #define DEBUG_SERIAL_SUPPORT        0
@@ -127,6 +136,11 @@
 #define PWM_SUPPORT                 1           // Need PWM to update channel values
 #endif
 
+#if LIGHT_PROVIDER == LIGHT_PROVIDER_CUSTOM
+#undef LIGHT_OUTPUT_STAGE_SUPPORT
+#define LIGHT_OUTPUT_STAGE_SUPPORT  0           // Custom providers are only expected to be called from the loop()
+#endif
+
 //------------------------------------------------------------------------------
 // Hint about ESPAsyncTCP options and our internal one
 // TODO: clean-up SSL_ENABLED and USE_SSL settings for 1.15.0
@@ -152,6 +166,13 @@
 #undef DEBUG_LOG_BUFFER_SUPPORT
 #define DEBUG_LOG_BUFFER_SUPPORT  0              // Can't buffer if there is no debugging enabled.
                                                  // Helps to avoid checking twice for both DEBUG_SUPPORT and BUFFER_LOG_SUPPORT
+#undef DEBUG_LOG_QUEUE_SUPPORT
+#define DEBUG_LOG_QUEUE_SUPPORT   0
+#endif
+
+#if !DEBUG_LOG_QUEUE_SUPPORT
+#undef DEBUG_LOG_COMPACT_SUPPORT
+#define DEBUG_LOG_COMPACT_SUPPORT 0              // Records are only formatted when written out from the queue
 #endif
 
 //------------------------------------------------------------------------------
@@ -28,6 +28,36 @@
                                                 // - https://github.com/esp8266/Arduino/issues/5825
 #endif
 
+#ifndef LOOP_ADAPTIVE_SUPPORT
+#define LOOP_ADAPTIVE_SUPPORT   0               // Instead of always waiting for LOOP_DELAY_TIME, wait until the earliest deadline
+                                                // requested by the modules or start the next loop right away when some work is pending.
+                                                // Idle time can be spent in the WiFi modem or light sleep, see WIFI_SLEEP_MODE
+#endif
+
+#ifndef LOOP_ADAPTIVE_DELAY_MAX
+#define LOOP_ADAPTIVE_DELAY_MAX 100             // (ms) Default `loopDelay` of the adaptive loop, used instead of LOOP_DELAY_TIME.
+                                                // `loopDelay` is the longest wait when no earlier deadline was requested
+#endif
+
+#ifndef LOOP_ADAPTIVE_WAKE_INTERVAL
+#define LOOP_ADAPTIVE_WAKE_INTERVAL 10          // (ms) How often the adaptive loop checks registered wake sources (e.g. UART RX) while waiting
+#endif
+
+#ifndef LOOP_PROFILER_SUPPORT
+#define LOOP_PROFILER_SUPPORT   0               // Count CPU cycles spent in every loop callback.
+                                                // Results are available through the `loop.profile` command and `/api/profile`
+#endif
+
+#ifndef SYSTEM_TIMER_WHEEL_SUPPORT
+#define SYSTEM_TIMER_WHEEL_SUPPORT  0           // Run every system timer from a single timer wheel instead of a separate SDK timer.
+                                                // Callbacks are called from the main loop and are delayed while it is blocked.
+                                                // Needs ~2KiB of RAM for the wheel slots. Stats are available through the `timer.wheel` command
+#endif
+
+#ifndef SYSTEM_TIMER_WHEEL_TICK
+#define SYSTEM_TIMER_WHEEL_TICK     10          // (ms) Timer wheel resolution, durations are rounded up to it
+#endif
+
 //------------------------------------------------------------------------------
 // HEARTBEAT
 //------------------------------------------------------------------------------
@@ -91,6 +121,16 @@
 // DEBUG_UDP_FAC_PRI is the facility+priority
 #define DEBUG_UDP_FAC_PRI       (SYSLOG_LOCAL0 | SYSLOG_DEBUG)
 
+#ifndef DEBUG_UDP_BATCH_SIZE
+#define DEBUG_UDP_BATCH_SIZE    0               // When not 0, pack multiple syslog messages into a single datagram of up to N bytes
+                                                // using octet-counting framing (https://tools.ietf.org/html/rfc6587#section-3.4.1)
+                                                // Receiver must support it. 1400 will fit into a single Ethernet frame
+#endif
+
+#ifndef DEBUG_UDP_BATCH_TIMEOUT
+#define DEBUG_UDP_BATCH_TIMEOUT 500             // (ms) Send pending messages when the oldest one waited for this long
+#endif
+
 //------------------------------------------------------------------------------
 
 #ifndef DEBUG_TELNET_SUPPORT
@@ -119,6 +159,22 @@
                                                 // WARNING! Memory is only reclaimed after `debug.buffer` prints the buffer contents
 #endif
 
+#ifndef DEBUG_LOG_QUEUE_SUPPORT
+#define DEBUG_LOG_QUEUE_SUPPORT        0        // Copy log messages into a ring buffer and write them out from the main loop,
+                                                // each output at its own pace. Messages still in the queue are lost on crash or reset
+#endif
+
+#ifndef DEBUG_LOG_QUEUE_SIZE
+#define DEBUG_LOG_QUEUE_SIZE           2048     // Ring buffer size in bytes. When some output falls behind,
+                                                // its oldest messages are dropped and counted in `debug.queue`
+#endif
+
+#ifndef DEBUG_LOG_COMPACT_SUPPORT
+#define DEBUG_LOG_COMPACT_SUPPORT      0        // Queue and log buffer keep the format string pointer and a copy of the arguments,
+                                                // text is only created when the message is written out.
+                                                // Requires DEBUG_LOG_QUEUE_SUPPORT. Format strings must be literals, PSTR(...) or "..."
+#endif
+
 //------------------------------------------------------------------------------
 // TELNET
 //------------------------------------------------------------------------------
@@ -240,6 +296,22 @@
 #define GARLAND_LEDS                60          // Number of LEDs
 #endif
 
+#ifndef GARLAND_LEDS_MAX
+#define GARLAND_LEDS_MAX            1000        // Upper limit of the `garlandLeds` setting. Pixel buffers of every segment scene
+                                                // and the I2S DMA output are allocated for each LED
+#endif
+
+#ifndef GARLAND_SEGMENTS
+#define GARLAND_SEGMENTS            1           // Number of strip parts, each one with its own animation and palette
+                                                // (LEDs are split evenly, unless configured otherwise)
+#endif
+
+#ifndef GARLAND_OUTPUT
+#define GARLAND_OUTPUT              GARLAND_OUTPUT_NEOPIXEL // Use GARLAND_OUTPUT_I2S_DMA for long strips. Data pin is then always
+                                                            // GPIO3 (RX) and serial input is no longer available.
+                                                            // Output stays disabled when `uartRx0` setting still points to GPIO3
+#endif
+
 //------------------------------------------------------------------------------
 // THERMOSTAT
 //------------------------------------------------------------------------------
@@ -474,6 +546,11 @@
 #define BUTTON_REPEAT_DELAY         500         // Time in ms to wait for a second (or third...) click
 #endif
 
+#ifndef BUTTON_INTERRUPT_MODE
+#define BUTTON_INTERRUPT_MODE       0           // 0 - poll the pin in the loop and wait for the debounce delay there
+                                                // 1 - capture hardware GPIO pin changes with an interrupt handler
+#endif
+
 #ifndef BUTTON_LNGCLICK_DELAY
 #define BUTTON_LNGCLICK_DELAY       1000        // Time in ms holding the button down to get a long click
 #endif
@@ -710,6 +787,16 @@
 #define WS_UPDATE_INTERVAL          30          // Time (in seconds) between periodic status updates sent out to every client
 #endif
 
+#ifndef WS_MESSAGE_BLOCK_SIZE
+#define WS_MESSAGE_BLOCK_SIZE       512         // Size of the reusable block outgoing messages are written into.
+                                                // Larger messages span several blocks and are sent as continuation frames
+#endif
+
+#ifndef WS_MESSAGE_POOL_SIZE
+#define WS_MESSAGE_POOL_SIZE        8           // Number of reusable blocks, allocated on first use. Temporary ones are allocated
+                                                // when every block is still queued
+#endif
+
 // -----------------------------------------------------------------------------
 // API
 // -----------------------------------------------------------------------------
@@ -1238,6 +1325,25 @@
 #define LIGHT_TRANSITION_TIME   500         // Time in millis from color to color
 #endif
 
+#ifndef LIGHT_TRANSITION_EASING
+#define LIGHT_TRANSITION_EASING LIGHT_EASING_LINEAR // How transition progresses over time
+                                                    // LIGHT_EASING_LINEAR, LIGHT_EASING_IN_OUT or LIGHT_EASING_EXPONENTIAL
+#endif
+
+#ifndef LIGHT_TRANSITION_SPACE
+#define LIGHT_TRANSITION_SPACE LIGHT_SPACE_CHANNELS // How color changes during the transition
+                                                    // LIGHT_SPACE_CHANNELS (every channel separately), LIGHT_SPACE_HSV or LIGHT_SPACE_OKLAB
+#endif
+
+#ifndef LIGHT_OUTPUT_STAGE_SUPPORT
+#define LIGHT_OUTPUT_STAGE_SUPPORT  0           // Prepare transition steps ahead of time and send them to the provider from the SDK timer,
+                                                // so that a slow loop() does not stall the transition (LIGHT_PROVIDER_DIMMER and LIGHT_PROVIDER_MY92XX)
+#endif
+
+#ifndef LIGHT_OUTPUT_STAGE_FRAMES
+#define LIGHT_OUTPUT_STAGE_FRAMES   8           // Number of prepared transition steps. Each one uses ~50 bytes of RAM
+#endif
+
 // -----------------------------------------------------------------------------
 // DOMOTICZ
 // -----------------------------------------------------------------------------
@@ -1448,6 +1554,34 @@
 #define RPN_STICKY                  1               // Keeps variable after rule execution
 #endif
 
+// -----------------------------------------------------------------------------
+// GROUP SYNC
+// -----------------------------------------------------------------------------
+
+#ifndef GROUP_SYNC_SUPPORT
+#define GROUP_SYNC_SUPPORT          0               // Synchronize light and relay state with other devices via UDP multicast
+#endif
+
+#ifndef GROUP_SYNC_ID
+#define GROUP_SYNC_ID               0               // Devices with the same ID are in the same group. 0 disables synchronization
+#endif
+
+#ifndef GROUP_SYNC_ADDRESS
+#define GROUP_SYNC_ADDRESS          "239.255.42.42" // Multicast address shared by the group
+#endif
+
+#ifndef GROUP_SYNC_PORT
+#define GROUP_SYNC_PORT             4242
+#endif
+
+#ifndef GROUP_SYNC_DELAY
+#define GROUP_SYNC_DELAY            100             // (ms) Every device in the group applies the state after this delay
+#endif
+
+#ifndef GROUP_SYNC_REPEATS
+#define GROUP_SYNC_REPEATS          2               // Send the same frame this many more times, in case some of them are lost
+#endif
+
 // -----------------------------------------------------------------------------
 // NTP
 // -----------------------------------------------------------------------------
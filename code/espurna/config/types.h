@@ -224,6 +224,24 @@
 #define LIGHT_PROVIDER_DIMMER       2
 #define LIGHT_PROVIDER_CUSTOM       3
 
+// Transition easing curves
+#define LIGHT_EASING_LINEAR         espurna::light::Easing::Linear
+#define LIGHT_EASING_IN_OUT         espurna::light::Easing::InOut
+#define LIGHT_EASING_EXPONENTIAL    espurna::light::Easing::Exponential
+
+// Transition color interpolation
+#define LIGHT_SPACE_CHANNELS        espurna::light::ColorSpace::Channels
+#define LIGHT_SPACE_HSV             espurna::light::ColorSpace::Hsv
+#define LIGHT_SPACE_OKLAB           espurna::light::ColorSpace::Oklab
+
+// -----------------------------------------------------------------------------
+// GARLAND
+// -----------------------------------------------------------------------------
+
+// Strip output methods
+#define GARLAND_OUTPUT_NEOPIXEL     0       // blocking bit-bang output, any pin
+#define GARLAND_OUTPUT_I2S_DMA      1       // background output through the I2S DMA, GPIO3 (RX) only
+
 // -----------------------------------------------------------------------------
 // IR
 // -----------------------------------------------------------------------------
@@ -14,6 +14,8 @@ Copyright (C) 2016-2019 by Xose Pérez <xose dot perez at gmail dot com>
 #include "telnet.h"
 #include "ntp.h"
 
+#include <algorithm>
+#include <cstring>
 #include <limits>
 #include <type_traits>
 #include <vector>
@@ -203,7 +205,42 @@ void send(const char* message, size_t len) {
     send(message, len, build::AddTimestamp);
 }
 
+void format_prefix(char (&prefix)[10], unsigned long timestamp) {
+    snprintf_P(prefix, sizeof(prefix), PSTR("[%06lu] "), timestamp % 1000000);
+}
+
+// timestamp is only added at the start of the line
+bool with_timestamp(Timestamp timestamp, char last) {
+    static bool continue_timestamp = true;
+    const bool out = timestamp && continue_timestamp;
+
+    continue_timestamp = static_cast<bool>(timestamp)
+        || (last == '\r')
+        || (last == '\n');
+
+    return out;
+}
+
+#if DEBUG_LOG_COMPACT_SUPPORT
+bool sendCompact(const char* format, va_list args);
+namespace queue {
+bool active();
+} // namespace queue
+#endif
+
 void formatAndSend(const char* format, va_list args) {
+#if DEBUG_LOG_COMPACT_SUPPORT
+    if (queue::active()) {
+        va_list copy;
+        va_copy(copy, args);
+        const auto result = sendCompact(format, copy);
+        va_end(copy);
+        if (result) {
+            return;
+        }
+    }
+#endif
+
     constexpr size_t SmallStringBufferSize { 128 };
     char temp[SmallStringBufferSize];
 
@@ -230,6 +267,410 @@ void formatAndSend(const char* format, va_list args) {
     delete[] buffer;
 }
 
+#if DEBUG_LOG_COMPACT_SUPPORT
+namespace compact {
+
+// Instead of the text, keep the format string pointer and a copy of every argument it consumes.
+// Text is only created when the message is written out. Formatting is done one conversion
+// at a time, re-reading the format string to know the argument types.
+// (which means that the format string must be a literal, either in RAM or in flash)
+
+enum class Arg {
+    Percent,
+    Int,
+    Long,
+    LongLong,
+    Size,
+    Double,
+    Pointer,
+    String,
+};
+
+// Precision is -1 when not specified, or -2 when it is the last '*' argument
+struct Spec {
+    size_t length;
+    size_t stars;
+    int precision;
+    Arg arg;
+};
+
+constexpr int PrecisionNone { -1 };
+constexpr int PrecisionStar { -2 };
+
+// '%' [flags] [width] [.precision] [length] conversion
+bool parse(const char* format, Spec& out) {
+    enum class Length {
+        Default,
+        Long,
+        LongLong,
+        Size,
+    };
+
+    size_t length { 1 };
+    size_t stars { 0 };
+    int precision { PrecisionNone };
+    auto kind = Length::Default;
+
+    for (;;) {
+        const char c = pgm_read_byte(format + length);
+        ++length;
+
+        if ((c >= '0') && (c <= '9')) {
+            if (precision >= 0) {
+                precision = (precision * 10) + (c - '0');
+            }
+            continue;
+        }
+
+        switch (c) {
+        case '-':
+        case '+':
+        case ' ':
+        case '#':
+        case 'h':
+            continue;
+
+        case '.':
+            precision = 0;
+            continue;
+
+        case '*':
+            if (precision == 0) {
+                precision = PrecisionStar;
+            }
+            ++stars;
+            continue;
+
+        case 'l':
+            kind = (kind == Length::Long)
+                ? Length::LongLong
+                : Length::Long;
+            continue;
+
+        case 'j':
+            kind = Length::LongLong;
+            continue;
+
+        case 'z':
+        case 't':
+            kind = Length::Size;
+            continue;
+
+        case '%':
+            out = Spec{length, stars, precision, Arg::Percent};
+            return true;
+
+        case 'd':
+        case 'i':
+        case 'u':
+        case 'o':
+        case 'x':
+        case 'X':
+        case 'c':
+            switch (kind) {
+            case Length::Default:
+                out = Spec{length, stars, precision, Arg::Int};
+                break;
+            case Length::Long:
+                out = Spec{length, stars, precision, Arg::Long};
+                break;
+            case Length::LongLong:
+                out = Spec{length, stars, precision, Arg::LongLong};
+                break;
+            case Length::Size:
+                out = Spec{length, stars, precision, Arg::Size};
+                break;
+            }
+            return true;
+
+        case 'f':
+        case 'F':
+        case 'e':
+        case 'E':
+        case 'g':
+        case 'G':
+            out = Spec{length, stars, precision, Arg::Double};
+            return true;
+
+        case 'p':
+            out = Spec{length, stars, precision, Arg::Pointer};
+            return true;
+
+        case 's':
+            out = Spec{length, stars, precision, Arg::String};
+            return (kind == Length::Default);
+
+        // long double, %n, wide strings and anything else are not supported
+        default:
+            return false;
+        }
+    }
+}
+
+struct Encoder {
+    Encoder() = delete;
+    Encoder(uint8_t* data, size_t size) :
+        _data(data),
+        _size(size)
+    {}
+
+    template <typename T>
+    void write(T value) {
+        write(&value, sizeof(value));
+    }
+
+    void write(const void* ptr, size_t size) {
+        if (reserve(size)) {
+            std::memcpy(_data + _length, ptr, size);
+            _length += size;
+        }
+    }
+
+    // string arguments can also be in flash
+    void write_P(const char* ptr, size_t size) {
+        if (reserve(size + 1)) {
+            memcpy_P(_data + _length, ptr, size);
+            _data[_length + size] = '\0';
+            _length += size + 1;
+        }
+    }
+
+    size_t length() const {
+        return _ok ? _length : 0;
+    }
+
+private:
+    bool reserve(size_t size) {
+        _ok = _ok && ((_length + size) <= _size);
+        return _ok;
+    }
+
+    uint8_t* _data;
+    size_t _size;
+    size_t _length { 0 };
+    bool _ok { true };
+};
+
+// Returns the record length, or 0 when the format cannot be stored like this.
+// &last is set to the last character of the resulting text, when known
+size_t encode(uint8_t* data, size_t size, const char* format, va_list args, char& last) {
+    Encoder encoder(data, size);
+    encoder.write(reinterpret_cast<uintptr_t>(format));
+
+    const char* ptr = format;
+    last = '\0';
+
+    for (;;) {
+        const char c = pgm_read_byte(ptr);
+        if (c == '\0') {
+            break;
+        }
+
+        if (c != '%') {
+            last = c;
+            ++ptr;
+            continue;
+        }
+
+        Spec spec;
+        if (!parse(ptr, spec)) {
+            return 0;
+        }
+
+        // width always comes before the precision
+        int precision { spec.precision };
+        for (size_t star = 0; star < spec.stars; ++star) {
+            const int value = va_arg(args, int);
+            if ((spec.precision == PrecisionStar) && ((star + 1) == spec.stars)) {
+                precision = value;
+            }
+
+            encoder.write(value);
+        }
+
+        last = '\0';
+
+        switch (spec.arg) {
+        case Arg::Percent:
+            last = '%';
+            break;
+        case Arg::Int:
+            encoder.write(va_arg(args, int));
+            break;
+        case Arg::Long:
+            encoder.write(va_arg(args, long));
+            break;
+        case Arg::LongLong:
+            encoder.write(va_arg(args, long long));
+            break;
+        case Arg::Size:
+            encoder.write(va_arg(args, size_t));
+            break;
+        case Arg::Double:
+            encoder.write(va_arg(args, double));
+            break;
+        case Arg::Pointer:
+            encoder.write(va_arg(args, void*));
+            break;
+        case Arg::String:
+        {
+            const char* value = va_arg(args, const char*);
+            if (!value) {
+                value = PSTR("(null)");
+            }
+
+            // string is not required to be null-terminated when precision is set, and
+            // the copy is always limited to it. negative '*' value means there is no precision
+            const auto length = (precision >= 0)
+                ? strnlen_P(value, precision)
+                : strlen_P(value);
+            encoder.write_P(value, length);
+            if (length) {
+                last = pgm_read_byte(value + length - 1);
+            }
+            break;
+        }
+        }
+
+        ptr += spec.length;
+    }
+
+    return encoder.length();
+}
+
+struct Decoder {
+    Decoder() = delete;
+    Decoder(const uint8_t* data, size_t length) :
+        _data(data),
+        _length(length)
+    {}
+
+    template <typename T>
+    T read() {
+        T out{};
+        if ((_offset + sizeof(out)) <= _length) {
+            std::memcpy(&out, _data + _offset, sizeof(out));
+            _offset += sizeof(out);
+        }
+
+        return out;
+    }
+
+    const char* string() {
+        if (_offset >= _length) {
+            return "";
+        }
+
+        const auto* out = reinterpret_cast<const char*>(_data + _offset);
+        _offset += strnlen(out, _length - _offset) + 1;
+
+        return out;
+    }
+
+private:
+    const uint8_t* _data;
+    size_t _length;
+    size_t _offset { 0 };
+};
+
+template <typename T>
+void append(std::vector<char>& out, const char* spec, T value) {
+    const int length = snprintf(nullptr, 0, spec, value);
+    if (length <= 0) {
+        return;
+    }
+
+    const auto size = out.size();
+    out.resize(size + length + 1);
+    snprintf(out.data() + size, length + 1, spec, value);
+    out.pop_back();
+}
+
+// Text is appended to the &out, *not* null-terminated
+void decode(std::vector<char>& out, const uint8_t* data, size_t length) {
+    Decoder decoder(data, length);
+
+    const char* ptr = reinterpret_cast<const char*>(
+        decoder.read<uintptr_t>());
+    if (!ptr) {
+        return;
+    }
+
+    for (;;) {
+        const char c = pgm_read_byte(ptr);
+        if (c == '\0') {
+            break;
+        }
+
+        if (c != '%') {
+            out.push_back(c);
+            ++ptr;
+            continue;
+        }
+
+        Spec spec;
+        if (!parse(ptr, spec)) {
+            break;
+        }
+
+        // copy the conversion into RAM, replacing any '*' with the stored value.
+        // negative precision is the same as no precision at all, and it is dropped
+        char buffer[32];
+        size_t size { 0 };
+        for (size_t index = 0; index < spec.length; ++index) {
+            const char value = pgm_read_byte(ptr + index);
+            if (value == '*') {
+                const int stored = decoder.read<int>();
+                if ((stored < 0) && size && (buffer[size - 1] == '.')) {
+                    --size;
+                } else {
+                    size += snprintf_P(buffer + size, sizeof(buffer) - size,
+                        PSTR("%d"), stored);
+                }
+            } else if (size < (sizeof(buffer) - 1)) {
+                buffer[size++] = value;
+            }
+
+            if (size >= (sizeof(buffer) - 1)) {
+                return;
+            }
+        }
+        buffer[size] = '\0';
+
+        switch (spec.arg) {
+        case Arg::Percent:
+            out.push_back('%');
+            break;
+        case Arg::Int:
+            append(out, buffer, decoder.read<int>());
+            break;
+        case Arg::Long:
+            append(out, buffer, decoder.read<long>());
+            break;
+        case Arg::LongLong:
+            append(out, buffer, decoder.read<long long>());
+            break;
+        case Arg::Size:
+            append(out, buffer, decoder.read<size_t>());
+            break;
+        case Arg::Double:
+            append(out, buffer, decoder.read<double>());
+            break;
+        case Arg::Pointer:
+            append(out, buffer, decoder.read<void*>());
+            break;
+        case Arg::String:
+            append(out, buffer, decoder.string());
+            break;
+        }
+
+        ptr += spec.length;
+    }
+}
+
+} // namespace compact
+#endif
+
 namespace buffer {
 namespace internal {
 
@@ -382,42 +823,98 @@ void sendBytes(const uint8_t* bytes, size_t size) {
 
 // Longer recording of all log data. Stops when storage is filled, requires manual flushing.
 
-void add(const char (&prefix)[10], const char* data, size_t len) {
-    if (len > std::numeric_limits<uint16_t>::max()) {
-        return;
+// Every entry starts with 2 byte length, followed by the text itself.
+// Compact entries are marked by the length's top bit, and store timestamp and the encoded record instead.
+
+constexpr size_t Compact { 1 << 15 };
+
+bool entry(size_t total, size_t flags) {
+    if ((total >= Compact) || ((internal::storage.capacity() - internal::storage.size()) <= (total + 3))) {
+        internal::enabled = false;
+        return false;
     }
 
+    const auto value = total | flags;
+    internal::storage.push_back(value >> 8);
+    internal::storage.push_back(value & 0xff);
+
+    return true;
+}
+
+void add(const char (&prefix)[10], const char* data, size_t len) {
     size_t total { len };
     bool withPrefix { prefix[0] != '\0' };
     if (withPrefix) {
         total += sizeof(prefix) - 1;
     }
 
-    if ((internal::storage.capacity() - internal::storage.size()) <= (total + 3)) {
-        internal::enabled = false;
+    if (!entry(total, 0)) {
         return;
     }
 
-    internal::storage.push_back(total >> 8);
-    internal::storage.push_back(total & 0xff);
-
     if (withPrefix) {
-        internal::storage.insert(internal::storage.end(), prefix, prefix + sizeof(prefix));
+        internal::storage.insert(internal::storage.end(), prefix, prefix + sizeof(prefix) - 1);
     }
     internal::storage.insert(internal::storage.end(), data, data + len);
 }
 
+#if DEBUG_LOG_COMPACT_SUPPORT
+void add_compact(bool timestamp, uint32_t millis, const uint8_t* data, size_t len) {
+    if (!entry(1 + sizeof(millis) + len, Compact)) {
+        return;
+    }
+
+    internal::storage.push_back(timestamp ? 1 : 0);
+
+    const auto* ptr = reinterpret_cast<const char*>(&millis);
+    internal::storage.insert(internal::storage.end(), ptr, ptr + sizeof(millis));
+
+    ptr = reinterpret_cast<const char*>(data);
+    internal::storage.insert(internal::storage.end(), ptr, ptr + len);
+}
+
+void dump_compact(Print& out, const char* data, size_t len) {
+    uint32_t millis;
+    if (len < (1 + sizeof(millis))) {
+        return;
+    }
+
+    if (data[0]) {
+        std::memcpy(&millis, data + 1, sizeof(millis));
+
+        char prefix[10];
+        format_prefix(prefix, millis);
+        out.print(prefix);
+    }
+
+    std::vector<char> text;
+    compact::decode(text,
+        reinterpret_cast<const uint8_t*>(data + 1 + sizeof(millis)),
+        len - 1 - sizeof(millis));
+    out.write(text.data(), text.size());
+}
+#endif
+
 void dump(Print& out) {
     size_t index = 0;
     do {
-        if (index >= internal::storage.size()) {
+        if ((index + 2) > internal::storage.size()) {
             break;
         }
 
-        size_t len = internal::storage[index] << 8;
-        len = len | internal::storage[index + 1];
+        size_t len = static_cast<uint8_t>(internal::storage[index]) << 8;
+        len = len | static_cast<uint8_t>(internal::storage[index + 1]);
         index += 2;
 
+#if DEBUG_LOG_COMPACT_SUPPORT
+        if (len & Compact) {
+            len &= ~Compact;
+            dump_compact(out, internal::storage.data() + index, len);
+            index += len;
+            continue;
+        }
+#endif
+
         auto value = internal::storage[index + len];
         internal::storage[index + len] = '\0';
         out.print(internal::storage.data() + index);
@@ -444,6 +941,7 @@ namespace internal {
 
 Print* port { nullptr };
 Output output { null_output };
+bool fifo { false };
 
 } // namespace
 
@@ -487,6 +985,22 @@ void setup() {
 
     internal::port = port->stream;
     internal::output = port_output;
+    internal::fifo = (port->type == driver::uart::Type::Uart0)
+        || (port->type == driver::uart::Type::Uart1);
+}
+
+// Only hardware ports report TX FIFO space. Message does not have
+// to fit completely, just don't start writing into an almost full FIFO
+// (and block until it drains) when we could do that on the next loop
+bool writeable(size_t len) {
+    constexpr size_t Chunk { 64 };
+    if (internal::fifo) {
+        const auto available = internal::port->availableForWrite();
+        return (available > 0)
+            && (static_cast<size_t>(available) >= std::min(len, Chunk));
+    }
+
+    return true;
 }
 
 } // namespace serial
@@ -508,6 +1022,18 @@ constexpr bool enabled() {
     return port() == 514;
 }
 
+constexpr size_t batchSize() {
+    return DEBUG_UDP_BATCH_SIZE;
+}
+
+constexpr bool batch() {
+    return batchSize() > 0;
+}
+
+constexpr duration::Milliseconds batchTimeout() {
+    return duration::Milliseconds(DEBUG_UDP_BATCH_TIMEOUT);
+}
+
 } // namespace build
 
 namespace internal {
@@ -516,6 +1042,13 @@ size_t len { 0 };
 char header[128] = {0};
 WiFiUDP udp;
 
+std::vector<char> batch;
+time::CoreClock::time_point batch_start;
+uint32_t batch_lines { 0 };
+
+uint32_t lines { 0 };
+uint32_t datagrams { 0 };
+
 } // namespace
 
 // We use the syslog header as defined in RFC5424 (The Syslog Protocol), ref:
@@ -523,42 +1056,119 @@ WiFiUDP udp;
 // - https://github.com/xoseperez/espurna/issues/2312/
 
 void configure() {
-    snprintf_P(
+    const int result = snprintf_P(
         internal::header, sizeof(internal::header),
         PSTR("<%u>1 - %.31s ESPurna - - - "), DEBUG_UDP_FAC_PRI,
         systemHostname().c_str());
+
+    internal::len = (result > 0)
+        ? std::min(static_cast<size_t>(result), sizeof(internal::header) - 1)
+        : 0;
+}
+
+bool flush() {
+    if (internal::batch.empty()) {
+        return false;
+    }
+
+    internal::udp.beginPacket(build::ip(), build::port());
+    internal::udp.write(internal::batch.data(), internal::batch.size());
+    const bool out = internal::udp.endPacket() > 0;
+
+    internal::lines += internal::batch_lines;
+    ++internal::datagrams;
+
+    internal::batch_lines = 0;
+    internal::batch.clear();
+
+    return out;
+}
+
+// Pack as many messages as possible into a single datagram, each one prefixed with its length
+// - https://tools.ietf.org/html/rfc6587#section-3.4.1
+bool append(const char* message, size_t len) {
+    char count[12];
+    const int count_len = snprintf_P(count, sizeof(count),
+        PSTR("%u "), internal::len + len);
+    if (count_len <= 0) {
+        return false;
+    }
+
+    const size_t total { count_len + internal::len + len };
+
+    bool out { false };
+    if ((internal::batch.size() + total) > build::batchSize()) {
+        out = flush();
+    }
+
+    // too large for the batch, send it right away
+    if (total > build::batchSize()) {
+        internal::udp.beginPacket(build::ip(), build::port());
+        internal::udp.write(count, count_len);
+        internal::udp.write(internal::header, internal::len);
+        internal::udp.write(message, len);
+        out = (internal::udp.endPacket() > 0) || out;
+
+        ++internal::lines;
+        ++internal::datagrams;
+
+        return out;
+    }
+
+    if (internal::batch.empty()) {
+        internal::batch_start = time::CoreClock::now();
+    }
+
+    internal::batch.insert(internal::batch.end(), count, count + count_len);
+    internal::batch.insert(internal::batch.end(), internal::header, internal::header + internal::len);
+    internal::batch.insert(internal::batch.end(), message, message + len);
+    ++internal::batch_lines;
+
+    return out;
 }
 
 bool output(const char* message, size_t len) {
     if (build::enabled() && wifiConnected()) {
+        if (build::batch()) {
+            return append(message, len);
+        }
+
         internal::udp.beginPacket(build::ip(), build::port());
         internal::udp.write(internal::header, internal::len);
         internal::udp.write(message, len);
 
+        ++internal::lines;
+        ++internal::datagrams;
+
         return internal::udp.endPacket() > 0;
     }
 
     return false;
 }
 
-} // namespace syslog
-#endif
-
-void send(const char* message, size_t len, Timestamp timestamp) {
-    if (!message || !len) {
-        return;
+// Pending messages are sent when the batch is full, or when the oldest one waited for long enough
+void loop() {
+    if (!internal::batch.empty()
+        && (time::CoreClock::now() - internal::batch_start >= build::batchTimeout()))
+    {
+        flush();
     }
+}
 
-    char prefix[10] = {0};
-    static bool continue_timestamp = true;
-    if (timestamp && continue_timestamp) {
-        snprintf(prefix, sizeof(prefix), "[%06lu] ", millis() % 1000000);
+void setup() {
+    configure();
+    espurnaRegisterReload(configure);
+
+    if (build::batch()) {
+        internal::batch.reserve(build::batchSize());
+        espurnaRegisterLoop(loop);
     }
+}
 
-    continue_timestamp = static_cast<bool>(timestamp)
-        || (message[len - 1] == '\r')
-        || (message[len - 1] == '\n');
+} // namespace syslog
+#endif
 
+void output(const char (&prefix)[10], const char* message, size_t len) {
     bool pause { false };
 
 #if DEBUG_SERIAL_SUPPORT
@@ -586,6 +1196,397 @@ void send(const char* message, size_t len, Timestamp timestamp) {
     }
 }
 
+#if DEBUG_LOG_QUEUE_SUPPORT
+namespace queue {
+namespace build {
+
+constexpr size_t size() {
+    return DEBUG_LOG_QUEUE_SIZE;
+}
+
+static_assert((size() >= 256) && ((size() & (size() - 1)) == 0),
+    "queue size must be a power of two, so positions are not disturbed when counters overflow");
+
+} // namespace build
+
+// Log messages are copied into the ring buffer as-is. Every output keeps its own
+// read position and is written from the main loop, when it is ready to accept more data.
+// When there is not enough space for the new message, outputs that are the furthest
+// behind lose their oldest messages first. Nothing else is ever blocked by a slow output.
+
+struct Header {
+    uint16_t length;
+    uint16_t flags;
+    uint32_t timestamp;
+};
+
+static_assert(sizeof(Header) == 8, "");
+
+// record that does not fit at the end of the buffer is placed at the start,
+// marking the remaining space (when there is enough of it for the header)
+constexpr uint16_t Wrap { std::numeric_limits<uint16_t>::max() };
+
+constexpr uint16_t FlagTimestamp { 1 };
+constexpr uint16_t FlagCompact { 1 << 1 };
+
+constexpr size_t record_size(size_t len) {
+    return (sizeof(Header) + len + 1 + 3) & ~static_cast<size_t>(3);
+}
+
+enum class Result {
+    Done,
+    Busy,
+};
+
+// Record text is only prepared once, no matter how many outputs need it
+struct Record {
+    Record() = delete;
+    Record(const Header& header, const uint8_t* data) :
+        _header(header),
+        _data(data)
+    {}
+
+    const char (&prefix())[10] {
+        if ((_header.flags & FlagTimestamp) && (_prefix[0] == '\0')) {
+            format_prefix(_prefix, _header.timestamp);
+        }
+
+        return _prefix;
+    }
+
+    const char* message();
+    size_t length();
+
+    const Header& header() const {
+        return _header;
+    }
+
+    const uint8_t* data() const {
+        return _data;
+    }
+
+private:
+    Header _header;
+    const uint8_t* _data;
+    char _prefix[10] = {0};
+    bool _decoded { false };
+};
+
+using Writer = Result(*)(Record&);
+
+struct Sink {
+    const char* name;
+    Writer writer;
+    uint32_t tail;
+    uint32_t sent;
+    uint32_t dropped;
+    bool busy { false };
+};
+
+#if DEBUG_SERIAL_SUPPORT
+Result serial_writer(Record& record) {
+    if (!serial::writeable(strlen(record.prefix()) + record.length())) {
+        return Result::Busy;
+    }
+
+    serial::output(record.prefix(), record.message(), record.length());
+    return Result::Done;
+}
+#endif
+
+#if DEBUG_UDP_SUPPORT
+Result syslog_writer(Record& record) {
+    syslog::output(record.message(), record.length());
+    return Result::Done;
+}
+#endif
+
+#if DEBUG_TELNET_SUPPORT
+Result telnet_writer(Record& record) {
+    if (!telnetDebugWriteable()) {
+        return Result::Busy;
+    }
+
+    telnetDebugSend(record.prefix(), record.message());
+    return Result::Done;
+}
+#endif
+
+#if DEBUG_WEB_SUPPORT
+Result web_writer(Record& record) {
+    wsDebugSend(record.prefix(), record.message());
+    return Result::Done;
+}
+#endif
+
+#if DEBUG_LOG_BUFFER_SUPPORT
+Result buffer_writer(Record& record) {
+#if DEBUG_LOG_COMPACT_SUPPORT
+    if (record.header().flags & FlagCompact) {
+        buffer::add_compact(
+            (record.header().flags & FlagTimestamp) != 0,
+            record.header().timestamp,
+            record.data(), record.header().length);
+        return Result::Done;
+    }
+#endif
+
+    buffer::add(record.prefix(), record.message(), record.length());
+    return Result::Done;
+}
+#endif
+
+namespace internal {
+
+alignas(4) uint8_t storage[build::size()];
+uint32_t head { 0 };
+bool active { false };
+
+#if DEBUG_LOG_COMPACT_SUPPORT
+std::vector<char> text;
+#endif
+
+Sink sinks[] {
+#if DEBUG_SERIAL_SUPPORT
+    {"serial", serial_writer, 0, 0, 0},
+#endif
+#if DEBUG_UDP_SUPPORT
+    {"syslog", syslog_writer, 0, 0, 0},
+#endif
+#if DEBUG_TELNET_SUPPORT
+    {"telnet", telnet_writer, 0, 0, 0},
+#endif
+#if DEBUG_WEB_SUPPORT
+    {"web", web_writer, 0, 0, 0},
+#endif
+#if DEBUG_LOG_BUFFER_SUPPORT
+    {"buffer", buffer_writer, 0, 0, 0},
+#endif
+};
+
+} // namespace internal
+
+const char* Record::message() {
+#if DEBUG_LOG_COMPACT_SUPPORT
+    if (_header.flags & FlagCompact) {
+        if (!_decoded) {
+            _decoded = true;
+            internal::text.clear();
+            compact::decode(internal::text, _data, _header.length);
+            internal::text.push_back('\0');
+        }
+
+        return internal::text.data();
+    }
+#endif
+
+    return reinterpret_cast<const char*>(_data);
+}
+
+size_t Record::length() {
+#if DEBUG_LOG_COMPACT_SUPPORT
+    if (_header.flags & FlagCompact) {
+        message();
+        return internal::text.size() - 1;
+    }
+#endif
+
+    return _header.length;
+}
+
+bool active() {
+    return internal::active;
+}
+
+size_t offset(uint32_t position) {
+    return position % build::size();
+}
+
+Header header(uint32_t position) {
+    Header out;
+
+    const auto start = offset(position);
+    if ((build::size() - start) < sizeof(Header)) {
+        out.length = Wrap;
+        return out;
+    }
+
+    std::memcpy(&out, &internal::storage[start], sizeof(out));
+    return out;
+}
+
+size_t pending(const Sink& sink) {
+    return internal::head - sink.tail;
+}
+
+size_t used() {
+    size_t out { 0 };
+    for (const auto& sink : internal::sinks) {
+        out = std::max(out, pending(sink));
+    }
+
+    return out;
+}
+
+// move to the next record, returns whether the current one was an actual message
+bool skip(Sink& sink) {
+    const auto current = header(sink.tail);
+    if (current.length == Wrap) {
+        sink.tail += build::size() - offset(sink.tail);
+        return false;
+    }
+
+    sink.tail += record_size(current.length);
+    return true;
+}
+
+void push(const uint8_t* data, size_t len, uint16_t flags) {
+    const auto size = record_size(len);
+    if ((len >= Wrap) || (size > (build::size() / 2))) {
+        for (auto& sink : internal::sinks) {
+            ++sink.dropped;
+        }
+        return;
+    }
+
+    const auto left = build::size() - offset(internal::head);
+    const size_t padding = (left < size) ? left : 0;
+
+    for (auto distance = used(); (build::size() - distance) < (padding + size); distance = used()) {
+        for (auto& sink : internal::sinks) {
+            if ((pending(sink) == distance) && skip(sink)) {
+                ++sink.dropped;
+            }
+        }
+    }
+
+    if (padding >= sizeof(Header)) {
+        const Header wrap { Wrap, 0, 0 };
+        std::memcpy(&internal::storage[offset(internal::head)], &wrap, sizeof(wrap));
+    }
+    internal::head += padding;
+
+    const Header current {
+        static_cast<uint16_t>(len),
+        flags,
+        static_cast<uint32_t>(millis()) };
+
+    auto* ptr = &internal::storage[offset(internal::head)];
+    std::memcpy(ptr, &current, sizeof(current));
+    std::memcpy(ptr + sizeof(current), data, len);
+    ptr[sizeof(current) + len] = '\0';
+
+    internal::head += size;
+}
+
+void push(const char* message, size_t len, bool timestamp) {
+    push(reinterpret_cast<const uint8_t*>(message), len,
+        timestamp ? FlagTimestamp : uint16_t{ 0 });
+}
+
+// pick the oldest record that some output is still waiting for
+Sink* next() {
+    Sink* out { nullptr };
+    for (auto& sink : internal::sinks) {
+        if (!sink.busy && pending(sink) && (!out || (pending(sink) > pending(*out)))) {
+            out = &sink;
+        }
+    }
+
+    return out;
+}
+
+void loop() {
+    internal::active = true;
+
+    // anything logged by the outputs themselves could overwrite the message being sent
+    buffer::DebugLock lock;
+
+    for (auto& sink : internal::sinks) {
+        sink.busy = false;
+    }
+
+    for (auto* oldest = next(); oldest; oldest = next()) {
+        const auto position = oldest->tail;
+
+        const auto current = header(position);
+        if (current.length == Wrap) {
+            for (auto& sink : internal::sinks) {
+                if (sink.tail == position) {
+                    skip(sink);
+                }
+            }
+            continue;
+        }
+
+        Record record(current, &internal::storage[offset(position) + sizeof(Header)]);
+        for (auto& sink : internal::sinks) {
+            if (sink.busy || (sink.tail != position)) {
+                continue;
+            }
+
+            if (sink.writer(record) == Result::Busy) {
+                sink.busy = true;
+                continue;
+            }
+
+            skip(sink);
+            ++sink.sent;
+        }
+    }
+}
+
+// messages sent before the first loop() are still written out immediately
+void setup() {
+    ::espurnaRegisterLoop(loop);
+}
+
+} // namespace queue
+#endif
+
+#if DEBUG_LOG_COMPACT_SUPPORT
+bool sendCompact(const char* format, va_list args) {
+    constexpr size_t RecordSize { 128 };
+    uint8_t data[RecordSize];
+
+    char last;
+    const auto length = compact::encode(data, sizeof(data), format, args, last);
+    if (!length) {
+        return false;
+    }
+
+    auto flags = queue::FlagCompact;
+    if (with_timestamp(build::AddTimestamp, last)) {
+        flags |= queue::FlagTimestamp;
+    }
+
+    queue::push(data, length, flags);
+    return true;
+}
+#endif
+
+void send(const char* message, size_t len, Timestamp timestamp) {
+    if (!message || !len) {
+        return;
+    }
+
+    const bool timestamped = with_timestamp(timestamp, message[len - 1]);
+
+#if DEBUG_LOG_QUEUE_SUPPORT
+    if (queue::active()) {
+        queue::push(message, len, timestamped);
+        return;
+    }
+#endif
+
+    char prefix[10] = {0};
+    if (timestamped) {
+        format_prefix(prefix, millis());
+    }
+
+    output(prefix, message, len);
+}
+
 // -----------------------------------------------------------------------------
 
 #if DEBUG_WEB_SUPPORT
@@ -669,6 +1670,7 @@ void onBoot() {
 #if TERMINAL_SUPPORT
 namespace terminal {
 
+#if DEBUG_LOG_BUFFER_SUPPORT
 PROGMEM_STRING(DebugBuffer, "DEBUG.BUFFER");
 
 void debug_buffer(::terminal::CommandContext&& ctx) {
@@ -683,9 +1685,49 @@ void debug_buffer(::terminal::CommandContext&& ctx) {
     debug::buffer::dump(ctx.output);
     terminalOK(ctx);
 }
+#endif
+
+#if DEBUG_LOG_QUEUE_SUPPORT
+PROGMEM_STRING(DebugQueue, "DEBUG.QUEUE");
+
+void debug_queue(::terminal::CommandContext&& ctx) {
+    ctx.output.printf_P(PSTR("queue size: %u bytes\n"),
+        debug::queue::build::size());
+    for (const auto& sink : debug::queue::internal::sinks) {
+        ctx.output.printf_P(PSTR("%-6s sent %u dropped %u pending %u bytes\n"),
+            sink.name, sink.sent, sink.dropped, debug::queue::pending(sink));
+    }
+    terminalOK(ctx);
+}
+#endif
+
+#if DEBUG_UDP_SUPPORT
+PROGMEM_STRING(DebugSyslog, "DEBUG.SYSLOG");
+
+void debug_syslog(::terminal::CommandContext&& ctx) {
+    ctx.output.printf_P(PSTR("lines: %u datagrams: %u\n"),
+        debug::syslog::internal::lines,
+        debug::syslog::internal::datagrams);
+    if (debug::syslog::build::batch()) {
+        ctx.output.printf_P(PSTR("pending: %u lines, %u / %u bytes\n"),
+            debug::syslog::internal::batch_lines,
+            debug::syslog::internal::batch.size(),
+            debug::syslog::build::batchSize());
+    }
+    terminalOK(ctx);
+}
+#endif
 
 static constexpr ::terminal::Command commands[] PROGMEM {
+#if DEBUG_LOG_BUFFER_SUPPORT
     {DebugBuffer, debug_buffer},
+#endif
+#if DEBUG_LOG_QUEUE_SUPPORT
+    {DebugQueue, debug_queue},
+#endif
+#if DEBUG_UDP_SUPPORT
+    {DebugSyslog, debug_syslog},
+#endif
 };
 
 void setup() {
@@ -755,11 +1797,13 @@ void debugShowBanner() {
 void debugSetup() {
 #if DEBUG_UDP_SUPPORT
     if (espurna::debug::syslog::build::enabled()) {
-        espurna::debug::syslog::configure();
-        espurnaRegisterReload(espurna::debug::syslog::configure);
+        espurna::debug::syslog::setup();
     }
 #endif
-#if DEBUG_LOG_BUFFER_SUPPORT
+#if DEBUG_LOG_QUEUE_SUPPORT
+    espurna::debug::queue::setup();
+#endif
+#if DEBUG_LOG_BUFFER_SUPPORT || DEBUG_LOG_QUEUE_SUPPORT || DEBUG_UDP_SUPPORT
 #if TERMINAL_SUPPORT
     espurna::debug::terminal::setup();
 #endif
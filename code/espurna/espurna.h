@@ -68,4 +68,15 @@ void espurnaRegisterOnceUnique(espurna::Callback::Type);
 espurna::duration::Milliseconds espurnaLoopDelay();
 void espurnaLoopDelay(espurna::duration::Milliseconds);
 
+// With LOOP_ADAPTIVE_SUPPORT, start the next loop() right away. Safe to call from the SYS context and the ISR
+void espurnaLoopWake();
+// With LOOP_ADAPTIVE_SUPPORT, do not wait longer than the specified duration after the current loop()
+void espurnaLoopDeadline(espurna::duration::Milliseconds);
+// With LOOP_ADAPTIVE_SUPPORT, periodically checked while waiting. Next loop() starts as soon as any of them returns true
+using LoopWakeCallback = bool (*)();
+void espurnaRegisterLoopWake(LoopWakeCallback);
+
+// Total time spent waiting between loop() calls
+espurna::duration::Microseconds espurnaLoopIdleTime();
+
 void extraSetup();
@@ -14,7 +14,7 @@ Debug output shows timings. Overal timing should be not more that 3000 ms.
 MQTT control:
 Topic: $root/garland/set
 Message: {"command":"string", "enable":"string", "brightness":int, "speed":int, "animation":"string",
-          "palette":"string"/int, "duration":int}
+          "palette":"string"/int, "duration":int, "segment":int}
 All parameters are optional.
 
 "command:["immediate", "queue", "sequence", "reset"] - if not set, than "immediate" by default
@@ -36,6 +36,8 @@ All parameters are optional.
     - one color palette can be set by string, that represents color in the format "0xRRGGBB" (0xFF0000 for red) or
       integer number, corresponding to it. Examples: "palette":"0x0000FF", "palette":255 equal to Blue color.
 "duration":5000 - setup command duration in milliseconds. If not set, than infinite duration will setup.
+"segment":0 - part of the strip this command is for, when it is split into several ones (see garlandSegments and
+    garlandSegLeds# settings). Every segment runs its own animation, palette and command queue. First one by default.
 
 If command contains animation, palette or duration, than it setup next animation, that will be shown for duration (infinite if
 duration does not set), otherwise it just set scene parameters.
@@ -55,7 +57,13 @@ Infinite commands can be interrupted by immediate command or by reset command.
 #include <queue>
 #include <vector>
 
+#if GARLAND_OUTPUT == GARLAND_OUTPUT_I2S_DMA
+#include <i2s_reg.h>
+#endif
+
 #include "garland.h"
+#include "garland/bitstream.h"
+#include "garland/pixels.h"
 #include "mqtt.h"
 #include "ws.h"
 
@@ -65,9 +73,16 @@ namespace {
 #include "garland/palette.h"
 #include "garland/scene.h"
 
+#if GARLAND_OUTPUT == GARLAND_OUTPUT_I2S_DMA
+#include "garland/output.h"
+#endif
+
 alignas(4) static constexpr char NAME_GARLAND_ENABLED[] = "garlandEnabled";
 alignas(4) static constexpr char NAME_GARLAND_BRIGHTNESS[] = "garlandBrightness";
 alignas(4) static constexpr char NAME_GARLAND_SPEED[] = "garlandSpeed";
+alignas(4) static constexpr char NAME_GARLAND_LEDS[] = "garlandLeds";
+alignas(4) static constexpr char NAME_GARLAND_SEGMENTS[] = "garlandSegments";
+alignas(4) static constexpr char NAME_GARLAND_SEGMENT_LEDS[] = "garlandSegLeds";
 
 alignas(4) static constexpr char NAME_GARLAND_SWITCH[] = "garland_switch";
 alignas(4) static constexpr char NAME_GARLAND_SET_BRIGHTNESS[] = "garland_set_brightness";
@@ -83,6 +98,7 @@ alignas(4) static constexpr char MQTT_PAYLOAD_ANIM_SPEED[] = "speed";
 alignas(4) static constexpr char MQTT_PAYLOAD_ANIMATION[] = "animation";
 alignas(4) static constexpr char MQTT_PAYLOAD_PALETTE[] = "palette";
 alignas(4) static constexpr char MQTT_PAYLOAD_DURATION[] = "duration";
+alignas(4) static constexpr char MQTT_PAYLOAD_SEGMENT[] = "segment";
 
 alignas(4) static constexpr char MQTT_COMMAND_IMMEDIATE[] = "immediate";
 alignas(4) static constexpr char MQTT_COMMAND_RESET[] = "reset"; // reset queue
@@ -95,12 +111,6 @@ alignas(4) static constexpr char MQTT_COMMAND_SEQUENCE[] = "sequence"; // place
 #define NUMLEDS_CAN_CAUSE_WDT_RESET     100
 
 bool          _garland_enabled          = true;
-unsigned long _lastTimeUpdate           = 0;
-unsigned long _currentDuration          = ULONG_MAX;
-unsigned int  _currentCommandInSequence = 0;
-String        _immediate_command;
-std::queue<String>  _command_queue;
-std::vector<String> _command_sequence;
 
 // Palette should
 std::array<Palette, 14> pals {
@@ -147,48 +157,114 @@ std::array<Palette, 14> pals {
     Palette("Gaang", true, {0xe7a532, 0x46a8ca, 0xaf7440, 0xb4d29d, 0x9f5b72, 0x585c82})
 };
 
-auto one_color_palette = std::unique_ptr<Palette>(new Palette("White", true, {0xffffff}));
-
 constexpr uint16_t GarlandLeds { GARLAND_LEDS };
+constexpr uint16_t GarlandLedsMax { GARLAND_LEDS_MAX };
+static_assert(GarlandLeds <= GarlandLedsMax, "");
+constexpr size_t GarlandSegments { GARLAND_SEGMENTS };
+constexpr size_t GarlandSegmentsMax { 8 };
 constexpr unsigned char GarlandPin { GARLAND_DATA_PIN };
 constexpr neoPixelType GarlandPixelType { NEO_GRB + NEO_KHZ800 };
 
-Adafruit_NeoPixel pixels(GarlandLeds, GarlandPin, GarlandPixelType);
-Scene<GarlandLeds> scene(&pixels);
-
-std::array<Anim*, 18> anims {
-    new AnimStart(),
-    new AnimGlow(),
-    new AnimPixieDust(),
-    new AnimSparkr(),
-    new AnimStars(),
-    new AnimSpread(),
-    new AnimRandCyc(),
-    new AnimFly(),
-    new AnimComets(),
-    new AnimAssemble(),
-    new AnimDolphins(),
-    new AnimSalut(),
-    new AnimFountain(),
-    new AnimRandRun(),
-    new AnimWaves(AnimWaves::Type::LongWaves),
-    new AnimWaves(AnimWaves::Type::ShortWaves),
-    new AnimWaves(AnimWaves::Type::Comets),
-    new AnimWaves(AnimWaves::Type::CrossWaves),
-};
+// Actual length is only known after settings are loaded, see `_garlandSetupSegments()`
+Adafruit_NeoPixel pixels(0, GarlandPin, GarlandPixelType);
+
+#if GARLAND_OUTPUT == GARLAND_OUTPUT_I2S_DMA
+// Strip object is only used as the pixel buffer, which is sent out in the background
+I2sDmaOutput output;
+#endif
+
+// Animations keep the state of the scene they are running in, so every segment needs its own set
+using Anims = std::array<Anim*, 18>;
+
+Anims makeAnims() {
+    return Anims{
+        new AnimStart(),
+        new AnimGlow(),
+        new AnimPixieDust(),
+        new AnimSparkr(),
+        new AnimStars(),
+        new AnimSpread(),
+        new AnimRandCyc(),
+        new AnimFly(),
+        new AnimComets(),
+        new AnimAssemble(),
+        new AnimDolphins(),
+        new AnimSalut(),
+        new AnimFountain(),
+        new AnimRandRun(),
+        new AnimWaves(AnimWaves::Type::LongWaves),
+        new AnimWaves(AnimWaves::Type::ShortWaves),
+        new AnimWaves(AnimWaves::Type::Comets),
+        new AnimWaves(AnimWaves::Type::CrossWaves),
+    };
+}
 
 #define START_ANIMATION  0
 
+// Independently animated part of the strip, with its own scene timings and command queue
+struct Segment {
+    Segment(Adafruit_NeoPixel* pixels, uint16_t offset, uint16_t leds) :
+        scene(pixels, offset, leds),
+        anims(makeAnims())
+    {}
+
+    Scene scene;
+    Anims anims;
+    std::unique_ptr<Palette> one_color_palette { new Palette("White", true, {0xffffff}) };
+
+    unsigned long lastTimeUpdate = 0;
+    unsigned long currentDuration = ULONG_MAX;
+    unsigned int currentCommandInSequence = 0;
+    String immediate_command;
+    std::queue<String> command_queue;
+    std::vector<String> command_sequence;
+};
+
+// Allocated once on boot, changing the layout requires a reboot
+std::vector<Segment> segments;
+
 //------------------------------------------------------------------------------
 // Setup
 //------------------------------------------------------------------------------
+void _garlandSetupSegments() {
+    uint16_t leds = getSetting(NAME_GARLAND_LEDS, GarlandLeds);
+    if (leds > GarlandLedsMax) {
+        DEBUG_MSG_P(PSTR("[GARLAND] %hu LEDs requested, limited to %hu\n"), leds, GarlandLedsMax);
+        leds = GarlandLedsMax;
+    }
+
+    const size_t count = std::max<size_t>(1,
+        std::min(getSetting(NAME_GARLAND_SEGMENTS, GarlandSegments), GarlandSegmentsMax));
+
+    pixels.updateLength(leds);
+    segments.reserve(count);
+
+    uint16_t offset = 0;
+    for (size_t index = 0; index < count; ++index) {
+        const uint16_t left = leds - offset;
+        const uint16_t even = (index + 1 == count) ? left : (leds / count);
+
+        const uint16_t size = std::min(getSetting({NAME_GARLAND_SEGMENT_LEDS, index}, even), left);
+        if (!size) {
+            break;
+        }
+
+        segments.emplace_back(&pixels, offset, size);
+        DEBUG_MSG_P(PSTR("[GARLAND] Segment #%u: %hu LEDs starting at %hu\n"), index, size, offset);
+
+        offset += size;
+    }
+}
+
 void _garlandConfigure() {
     _garland_enabled = getSetting(NAME_GARLAND_ENABLED, true);
     byte brightness = getSetting(NAME_GARLAND_BRIGHTNESS, 255);
-    scene.setBrightness(brightness);
-
     float speed = getSetting(NAME_GARLAND_SPEED, 50);
-    scene.setSpeed(speed);
+
+    for (auto& segment : segments) {
+        segment.scene.setBrightness(brightness);
+        segment.scene.setSpeed(speed);
+    }
 
     DEBUG_MSG_P(PSTR("[GARLAND] enabled %s brightness %d speed %s\n"),
             _garland_enabled ? "YES" : "NO", brightness, String(speed).c_str());
@@ -201,10 +277,17 @@ void _garlandReload() {
 
 //------------------------------------------------------------------------------
 void setDefault() {
-    scene.setDefault();
-    byte brightness = scene.getBrightness();
+    if (segments.empty()) {
+        return;
+    }
+
+    for (auto& segment : segments) {
+        segment.scene.setDefault();
+    }
+
+    byte brightness = segments[0].scene.getBrightness();
     setSetting(NAME_GARLAND_BRIGHTNESS, brightness);
-    byte speed = scene.getSpeed();
+    byte speed = segments[0].scene.getSpeed();
     setSetting(NAME_GARLAND_SPEED, speed);
 #if WEB_SUPPORT
     wsPost([brightness, speed](JsonObject& root) {
@@ -222,15 +305,20 @@ void _garlandWebSocketOnVisible(JsonObject& root) {
 
 void _garlandWebSocketOnConnected(JsonObject& root) {
     root[NAME_GARLAND_ENABLED] = garlandEnabled();
-    root[NAME_GARLAND_BRIGHTNESS] = scene.getBrightness();
-    root[NAME_GARLAND_SPEED] = scene.getSpeed();
+    if (!segments.empty()) {
+        root[NAME_GARLAND_BRIGHTNESS] = segments[0].scene.getBrightness();
+        root[NAME_GARLAND_SPEED] = segments[0].scene.getSpeed();
+    }
 }
 
 //------------------------------------------------------------------------------
 bool _garlandWebSocketOnKeyCheck(espurna::StringView key, const JsonVariant&) {
     return key.equals(NAME_GARLAND_ENABLED)
         || key.equals(NAME_GARLAND_BRIGHTNESS)
-        || key.equals(NAME_GARLAND_SPEED);
+        || key.equals(NAME_GARLAND_SPEED)
+        || key.equals(NAME_GARLAND_LEDS)
+        || key.equals(NAME_GARLAND_SEGMENTS)
+        || key.startsWith(NAME_GARLAND_SEGMENT_LEDS);
 }
 
 //------------------------------------------------------------------------------
@@ -245,7 +333,9 @@ void _garlandWebSocketOnAction(uint32_t client_id, const char* action, JsonObjec
         if (data.containsKey("brightness")) {
             byte new_brightness = data.get<byte>("brightness");
             setSetting(NAME_GARLAND_BRIGHTNESS, new_brightness);
-            scene.setBrightness(new_brightness);
+            for (auto& segment : segments) {
+                segment.scene.setBrightness(new_brightness);
+            }
         }
     }
 
@@ -253,7 +343,9 @@ void _garlandWebSocketOnAction(uint32_t client_id, const char* action, JsonObjec
         if (data.containsKey("speed")) {
             byte new_speed = data.get<byte>("speed");
             setSetting(NAME_GARLAND_SPEED, new_speed);
-            scene.setSpeed(new_speed);
+            for (auto& segment : segments) {
+                segment.scene.setSpeed(new_speed);
+            }
         }
     }
 
@@ -264,22 +356,24 @@ void _garlandWebSocketOnAction(uint32_t client_id, const char* action, JsonObjec
 #endif
 
 //------------------------------------------------------------------------------
-void setupScene(Anim* new_anim, Palette* new_palette, unsigned long new_duration) {
-    unsigned long currentAnimRunTime = millis() - _lastTimeUpdate;
-    _lastTimeUpdate = millis();
+void setupScene(size_t index, Anim* new_anim, Palette* new_palette, unsigned long new_duration) {
+    auto& segment = segments[index];
+    auto& scene = segment.scene;
+
+    unsigned long currentAnimRunTime = millis() - segment.lastTimeUpdate;
+    segment.lastTimeUpdate = millis();
 
     int numShows = scene.getNumShows();
     int frameRate = currentAnimRunTime > 0 ? numShows * 1000 / currentAnimRunTime : 0;
 
-    static String palette_name = "Start";
-    DEBUG_MSG_P(PSTR("[GARLAND] Anim: %-10s Pal: %-8s timings: calc: %4d pixl: %3d show: %4d frate: %d\n"),
-                scene.getAnim()->name(), palette_name.c_str(),
+    const char* palette_name = scene.getPalette() ? scene.getPalette()->name() : "Start";
+    DEBUG_MSG_P(PSTR("[GARLAND] #%u Anim: %-10s Pal: %-8s timings: calc: %4d pixl: %3d show: %4d frate: %d\n"),
+                index, scene.getAnim()->name(), palette_name,
                 scene.getAvgCalcTime(), scene.getAvgPixlTime(), scene.getAvgShowTime(), frameRate);
 
-    _currentDuration = new_duration;
-    palette_name = new_palette->name();
-    DEBUG_MSG_P(PSTR("[GARLAND] Anim: %-10s Pal: %-8s Inter: %d\n"),
-                new_anim->name(), palette_name.c_str(), _currentDuration);
+    segment.currentDuration = new_duration;
+    DEBUG_MSG_P(PSTR("[GARLAND] #%u Anim: %-10s Pal: %-8s Inter: %d\n"),
+                index, new_anim->name(), new_palette->name(), segment.currentDuration);
 
     scene.setAnim(new_anim);
     scene.setPalette(new_palette);
@@ -287,8 +381,8 @@ void setupScene(Anim* new_anim, Palette* new_palette, unsigned long new_duration
 }
 
 //------------------------------------------------------------------------------
-bool executeCommand(const String& command) {
-    DEBUG_MSG_P(PSTR("[GARLAND] Executing command \"%s\"\n"), command.c_str());
+bool executeCommand(size_t index, const String& command) {
+    DEBUG_MSG_P(PSTR("[GARLAND] #%u Executing command \"%s\"\n"), index, command.c_str());
     // Parse JSON input
     DynamicJsonBuffer jsonBuffer;
     JsonObject& root = jsonBuffer.parseObject(command);
@@ -297,6 +391,7 @@ bool executeCommand(const String& command) {
         return false;
     }
 
+    auto& segment = segments[index];
     bool scene_setup_required = false;
 
     if (root.containsKey(MQTT_PAYLOAD_ENABLE)) {
@@ -306,21 +401,21 @@ bool executeCommand(const String& command) {
 
     if (root.containsKey(MQTT_PAYLOAD_BRIGHTNESS)) {
         auto brightness = root[MQTT_PAYLOAD_BRIGHTNESS].as<byte>();
-        scene.setBrightness(brightness);
+        segment.scene.setBrightness(brightness);
     }
 
     if (root.containsKey(MQTT_PAYLOAD_ANIM_SPEED)) {
         auto speed = root[MQTT_PAYLOAD_ANIM_SPEED].as<byte>();
-        scene.setSpeed(speed);
+        segment.scene.setSpeed(speed);
     }
 
-    Anim* newAnim = anims[0];
+    Anim* newAnim = segment.anims[0];
     if (root.containsKey(MQTT_PAYLOAD_ANIMATION)) {
         auto animation = root[MQTT_PAYLOAD_ANIMATION].as<const char*>();
-        for (size_t i = 0; i < anims.size(); ++i) {
-            auto anim_name = anims[i]->name();
+        for (size_t i = 0; i < segment.anims.size(); ++i) {
+            auto anim_name = segment.anims[i]->name();
             if (strcmp(animation, anim_name) == 0) {
-                newAnim = anims[i];
+                newAnim = segment.anims[i];
                 scene_setup_required = true;
                 break;
             }
@@ -330,8 +425,8 @@ bool executeCommand(const String& command) {
     Palette* newPalette = &pals[0];
     if (root.containsKey(MQTT_PAYLOAD_PALETTE)) {
         if (root.is<int>(MQTT_PAYLOAD_PALETTE)) {
-            one_color_palette.reset(new Palette("Color", true, {root[MQTT_PAYLOAD_PALETTE].as<uint32_t>()}));
-            newPalette = one_color_palette.get();
+            segment.one_color_palette.reset(new Palette("Color", true, {root[MQTT_PAYLOAD_PALETTE].as<uint32_t>()}));
+            newPalette = segment.one_color_palette.get();
         } else {
             auto palette = root[MQTT_PAYLOAD_PALETTE].as<String>();
             bool palette_found = false;
@@ -347,8 +442,8 @@ bool executeCommand(const String& command) {
             if (!palette_found) {
                 const auto result = parseUnsigned(palette);
                 if (result.ok) {
-                    one_color_palette.reset(new Palette("Color", true, {result.value}));
-                    newPalette = one_color_palette.get();
+                    segment.one_color_palette.reset(new Palette("Color", true, {result.value}));
+                    newPalette = segment.one_color_palette.get();
                 }
             }
         }
@@ -361,7 +456,7 @@ bool executeCommand(const String& command) {
     }
 
     if (scene_setup_required) {
-        setupScene(newAnim, newPalette, newAnimDuration);
+        setupScene(index, newAnim, newPalette, newAnimDuration);
         return true;
     }
     return false;
@@ -370,34 +465,68 @@ bool executeCommand(const String& command) {
 //------------------------------------------------------------------------------
 // Loop
 //------------------------------------------------------------------------------
-void garlandLoop(void) {
-    if (!_immediate_command.isEmpty()) {
-        executeCommand(_immediate_command);
-        _immediate_command.clear();
+// Returns `false` when the frame could not be sent out yet
+bool _garlandOutput() {
+#if GARLAND_OUTPUT == GARLAND_OUTPUT_I2S_DMA
+    // NEO_GRB buffer is already in the strip order, 3 bytes per pixel
+    return output.show(pixels.getPixels(), pixels.numPixels() * 3);
+#else
+    /* Showing pixels (actually transmitting their RGB data) is most time consuming operation in the
+    garland workflow. Using 800 kHz gives 1.25 μs per bit. -> 30 μs (0.03 ms) per RGB LED.
+    So for example 3 ms for 100 LEDs. Unfortunately it can't be postponed and resumed later as it
+    will lead to reseting the transmition operation. From other hand, long operation can cause
+    Soft WDT reset. To avoid wdt reset we need to switch soft wdt off for long strips.
+    It is not best practice, but assuming that it is only garland, it can be acceptable.
+    Tested up to 300 leds. */
+    const bool wdt = pixels.numPixels() > NUMLEDS_CAN_CAUSE_WDT_RESET;
+    if (wdt) {
+        ESP.wdtDisable();
+    }
+    pixels.show();
+    if (wdt) {
+        ESP.wdtEnable(5000);
     }
 
-    if (!garlandEnabled())
+    return true;
+#endif
+}
+
+void _garlandShow() {
+    unsigned long show_start_time = micros();
+
+    // Previous frame is still being sent, scenes keep their pending output until the next loop
+    if (!_garlandOutput()) {
         return;
+    }
 
-    scene.run();
+    // Every segment that was waiting for the output gets the same time, since strip is shown all at once
+    const unsigned long show_time = micros() - show_start_time;
+    for (auto& segment : segments) {
+        segment.scene.shown(show_time);
+    }
+}
 
-    unsigned long currentAnimRunTime = millis() - _lastTimeUpdate;
-    if (currentAnimRunTime > _currentDuration && scene.finishedAnimCycle()) {
+void _garlandNextScene(size_t index) {
+    auto& segment = segments[index];
+    auto& scene = segment.scene;
+
+    unsigned long currentAnimRunTime = millis() - segment.lastTimeUpdate;
+    if (currentAnimRunTime > segment.currentDuration && scene.finishedAnimCycle()) {
         bool scene_setup_done = false;
-        if (!_command_queue.empty()) {
-            scene_setup_done = executeCommand(_command_queue.front());
-            _command_queue.pop();
-        } else if (!_command_sequence.empty()) {
-            scene_setup_done = executeCommand(_command_sequence[_currentCommandInSequence]);
-            ++_currentCommandInSequence;
-            if (_currentCommandInSequence >= _command_sequence.size())
-                _currentCommandInSequence = 0;
+        if (!segment.command_queue.empty()) {
+            scene_setup_done = executeCommand(index, segment.command_queue.front());
+            segment.command_queue.pop();
+        } else if (!segment.command_sequence.empty()) {
+            scene_setup_done = executeCommand(index, segment.command_sequence[segment.currentCommandInSequence]);
+            ++segment.currentCommandInSequence;
+            if (segment.currentCommandInSequence >= segment.command_sequence.size())
+                segment.currentCommandInSequence = 0;
         }
 
         if (!scene_setup_done) {
             Anim* newAnim = scene.getAnim();
             while (newAnim == scene.getAnim()) {
-                newAnim = anims[secureRandom(START_ANIMATION + 1, anims.size())];
+                newAnim = segment.anims[secureRandom(START_ANIMATION + 1, segment.anims.size())];
             }
 
             Palette* newPalette = scene.getPalette();
@@ -407,11 +536,38 @@ void garlandLoop(void) {
 
             unsigned long newAnimDuration = secureRandom(EFFECT_UPDATE_INTERVAL_MIN, EFFECT_UPDATE_INTERVAL_MAX);
 
-            setupScene(newAnim, newPalette, newAnimDuration);
+            setupScene(index, newAnim, newPalette, newAnimDuration);
         }
     }
 }
 
+void garlandLoop(void) {
+    for (size_t index = 0; index < segments.size(); ++index) {
+        auto& segment = segments[index];
+        if (!segment.immediate_command.isEmpty()) {
+            executeCommand(index, segment.immediate_command);
+            segment.immediate_command.clear();
+        }
+    }
+
+    if (!garlandEnabled())
+        return;
+
+    // Every segment renders into the same output frame
+    bool show = false;
+    for (auto& segment : segments) {
+        show = segment.scene.run() || show;
+    }
+
+    if (show) {
+        _garlandShow();
+    }
+
+    for (size_t index = 0; index < segments.size(); ++index) {
+        _garlandNextScene(index);
+    }
+}
+
 //------------------------------------------------------------------------------
 void garlandMqttCallback(unsigned int type, espurna::StringView topic, espurna::StringView payload) {
     if (type == MQTT_CONNECT_EVENT) {
@@ -433,21 +589,34 @@ void garlandMqttCallback(unsigned int type, espurna::StringView topic, espurna::
                 command = root[MQTT_PAYLOAD_COMMAND].as<String>();
             }
 
+            size_t index = 0;
+            if (root.containsKey(MQTT_PAYLOAD_SEGMENT)) {
+                index = root[MQTT_PAYLOAD_SEGMENT].as<size_t>();
+            }
+
+            if (index >= segments.size()) {
+                DEBUG_MSG_P(PSTR("[GARLAND] Invalid segment #%u\n"), index);
+                return;
+            }
+
+            auto& segment = segments[index];
             if (command == MQTT_COMMAND_IMMEDIATE) {
-                _immediate_command = payload.toString();
+                segment.immediate_command = payload.toString();
             } else if (command == MQTT_COMMAND_RESET) {
-                std::queue<String> empty_queue;
-                std::swap(_command_queue, empty_queue);
-                std::vector<String> empty_sequence;
-                std::swap(_command_sequence, empty_sequence);
-                _immediate_command.clear();
-                _currentDuration = 0;
+                for (auto& entry : segments) {
+                    std::queue<String> empty_queue;
+                    std::swap(entry.command_queue, empty_queue);
+                    std::vector<String> empty_sequence;
+                    std::swap(entry.command_sequence, empty_sequence);
+                    entry.immediate_command.clear();
+                    entry.currentDuration = 0;
+                }
                 setDefault();
                 garlandEnabled(true);
             } else if (command == MQTT_COMMAND_QUEUE) {
-                _command_queue.push(payload.toString());
+                segment.command_queue.push(payload.toString());
             } else if (command == MQTT_COMMAND_SEQUENCE) {
-                _command_sequence.push_back(payload.toString());
+                segment.command_sequence.push_back(payload.toString());
             }
         }
     }
@@ -465,37 +634,43 @@ void garlandMqttCallback(unsigned int type, espurna::StringView topic, espurna::
 #define GARLAND_SCENE_TRANSITION_MS      1000    // transition time between animations, ms
 #define GARLAND_SCENE_DEFAULT_BRIGHTNESS 255
 
-template<uint16_t Leds>
-void Scene<Leds>::setPalette(Palette* palette) {
+Scene::Scene(Adafruit_NeoPixel* pixels, uint16_t offset, uint16_t leds) :
+    _pixels(pixels),
+    _offset(offset),
+    _numLeds(leds),
+    _leds1(leds),
+    _leds2(leds),
+    _ledstmp(leds),
+    _seq(leds)
+{}
+
+void Scene::setPalette(Palette* palette) {
     _palette = palette;
     if (setUpOnPalChange) {
         setupImpl();
     }
 }
 
-template<uint16_t Leds>
-void Scene<Leds>::setBrightness(byte value) {
+void Scene::setBrightness(byte value) {
     DEBUG_MSG_P(PSTR("[GARLAND] new brightness = %d\n"), value);
     brightness = value;
+    _lut.update(bri_lvl, brightness);
 }
 
 // Speed is reverse to cycleFactor and 10x
-template<uint16_t Leds>
-void Scene<Leds>::setSpeed(byte speed) {
+void Scene::setSpeed(byte speed) {
     DEBUG_MSG_P(PSTR("[GARLAND] new speed = %d\n"), speed);
     this->speed = speed;
     cycleFactor = (float)(GARLAND_SCENE_SPEED_MAX - speed) / GARLAND_SCENE_SPEED_FACTOR;
 }
 
-template<uint16_t Leds>
-void Scene<Leds>::setDefault() {
+void Scene::setDefault() {
     DEBUG_MSG_P(PSTR("[GARLAND] set default\n"));
     this->setBrightness(GARLAND_SCENE_DEFAULT_BRIGHTNESS);
     this->setSpeed(GARLAND_SCENE_DEFAULT_SPEED);
 }
 
-template<uint16_t Leds>
-void Scene<Leds>::run() {
+bool Scene::run() {
     unsigned long iteration_start_time = micros();
 
     if (state == Calculate || cyclesRemain < 1) {
@@ -521,78 +696,61 @@ void Scene<Leds>::run() {
     }
 
     if (state == Transition && cyclesRemain < 3) {
-        // transition coef, if within 0..1 - transition is active
-        // changes from 1 to 0 during transition, so we interpolate from current
+        // transition weight, if above 0 - transition is active
+        // changes from 256 to 0 during transition, so we blend from current
         // color to previous
-        float transc = (float)((long)transms - (long)millis()) / GARLAND_SCENE_TRANSITION_MS;
-        Color* leds_prev = (_leds == &_leds1[0]) ? &_leds2[0] : &_leds1[0];
-
-        if (transc > 0) {
-            for (int i = 0; i < Leds; i++) {
-                // transition is in progress
-                Color c = _leds[i].interpolate(leds_prev[i], transc);
-                byte r = (int)(bri_lvl[c.r]) * brightness / 256;
-                byte g = (int)(bri_lvl[c.g]) * brightness / 256;
-                byte b = (int)(bri_lvl[c.b]) * brightness / 256;
-                _pixels->setPixelColor(i, _pixels->Color(r, g, b));
-            }
-        } else {
-            for (int i = 0; i < Leds; i++) {
-                // regular operation
-                byte r = (int)(bri_lvl[_leds[i].r]) * brightness / 256;
-                byte g = (int)(bri_lvl[_leds[i].g]) * brightness / 256;
-                byte b = (int)(bri_lvl[_leds[i].b]) * brightness / 256;
-                _pixels->setPixelColor(i, _pixels->Color(r, g, b));
-            }
-        }
+        const long left = (long)transms - (long)millis();
+        const auto weight = (left > 0)
+            ? static_cast<espurna::garland::pixels::Weight>(
+                std::min<long>(left, GARLAND_SCENE_TRANSITION_MS)
+                    * espurna::garland::pixels::WeightMax / GARLAND_SCENE_TRANSITION_MS)
+            : espurna::garland::pixels::Weight{ 0 };
+
+        const Color* leds_prev = (_leds == _leds1.data()) ? _leds2.data() : _leds1.data();
+        espurna::garland::pixels::render(_leds, leds_prev, _numLeds, weight, _lut,
+            [&](size_t index, espurna::garland::pixels::Packed pixel) {
+                _pixels->setPixelColor(_offset + index, pixel);
+            });
 
         sum_pixl_time += (micros() - iteration_start_time);
-        iteration_start_time = micros();
         ++pixl_num;
         state = Show;
     }
 
     if (state == Show && cyclesRemain < 2) {
-        /* Showing pixels (actually transmitting their RGB data) is most time consuming operation in the
-        garland workflow. Using 800 kHz gives 1.25 μs per bit. -> 30 μs (0.03 ms) per RGB LED.
-        So for example 3 ms for 100 LEDs. Unfortunately it can't be postponed and resumed later as it
-        will lead to reseting the transmition operation. From other hand, long operation can cause
-        Soft WDT reset. To avoid wdt reset we need to switch soft wdt off for long strips.
-        It is not best practice, but assuming that it is only garland, it can be acceptable.
-        Tested up to 300 leds. */
-        if (Leds > NUMLEDS_CAN_CAUSE_WDT_RESET) {
-            ESP.wdtDisable();
-        }
-        _pixels->show();
-        if (Leds > NUMLEDS_CAN_CAUSE_WDT_RESET) {
-            ESP.wdtEnable(5000);
-        }
-        sum_show_time += (micros() - iteration_start_time);
-        ++show_num;
+        showPending = true;
         state = Calculate;
-        ++numShows;
     }
     --cyclesRemain;
+
+    return showPending;
+}
+
+void Scene::shown(unsigned long show_time) {
+    if (showPending) {
+        showPending = false;
+        sum_show_time += show_time;
+        ++show_num;
+        ++numShows;
+    }
 }
 
-template<uint16_t Leds>
-void Scene<Leds>::setupImpl() {
+void Scene::setupImpl() {
     transms = millis() + GARLAND_SCENE_TRANSITION_MS;
 
     // switch operation buffers (for transition to operate)
-    if (_leds == &_leds1[0]) {
-        _leds = &_leds2[0];
+    if (_leds == _leds1.data()) {
+        _leds = _leds2.data();
     } else {
-        _leds = &_leds1[0];
+        _leds = _leds1.data();
     }
 
     if (_anim) {
-        _anim->Setup(_palette, _pals, _palsNum, Leds, _leds, _ledstmp.data(), _seq.data());
+        _anim->Setup(_palette, _pals, _palsNum, _numLeds, _leds, _ledstmp.data(), _seq.data());
     }
 }
 
-template<uint16_t Leds>
-void Scene<Leds>::setup() {
+void Scene::setup() {
     sum_calc_time = 0;
     sum_pixl_time = 0;
     sum_show_time = 0;
@@ -701,7 +859,10 @@ void garlandEnabled(bool enabled) {
     if (_garland_enabled != enabled) {
         espurnaRegisterOnceUnique([]() {
             pixels.clear();
-            pixels.show();
+#if GARLAND_OUTPUT == GARLAND_OUTPUT_I2S_DMA
+            output.wait();
+#endif
+            _garlandOutput();
         });
     }
 
@@ -723,6 +884,17 @@ void garlandDisable() {
 }
 
 void garlandSetup() {
+#if GARLAND_OUTPUT == GARLAND_OUTPUT_I2S_DMA
+    // Serial RX function would replace the I2S one as soon as the port is started.
+    // UART is set up first, RX pin would already be locked when configured
+    if (!gpioLock(I2sDmaOutput::Pin)) {
+        DEBUG_MSG_P(PSTR("[GARLAND] GPIO%hhu is already in use, check the serial RX pin. Output is disabled\n"),
+            I2sDmaOutput::Pin);
+        return;
+    }
+#endif
+
+    _garlandSetupSegments();
     _garlandConfigure();
 
     mqttRegister(garlandMqttCallback);
@@ -738,13 +910,20 @@ void garlandSetup() {
     espurnaRegisterLoop(garlandLoop);
     espurnaRegisterReload(_garlandReload);
 
+#if GARLAND_OUTPUT == GARLAND_OUTPUT_I2S_DMA
+    output.begin(pixels.numPixels() * 3);
+#else
     pixels.begin();
-    scene.setAnim(anims[START_ANIMATION]);
-    scene.setPalette(&pals[0]);
-    scene.setPals(pals.data(), pals.size());
-    scene.setup();
+#endif
 
-    _currentDuration = 12000; // Start animation duration
+    for (auto& segment : segments) {
+        segment.scene.setAnim(segment.anims[START_ANIMATION]);
+        segment.scene.setPalette(&pals[0]);
+        segment.scene.setPals(pals.data(), pals.size());
+        segment.scene.setup();
+
+        segment.currentDuration = 12000; // Start animation duration
+    }
 }
 
 #endif  // GARLAND_SUPPORT
@@ -0,0 +1,54 @@
+/*
+Part of the GARLAND MODULE
+Copyright (C) 2021 by Maxim Prokhorov <prokhorov dot max at outlook dot com>
+
+WS2812 bitstream, encoded ahead of time and sent out through the I2S DMA
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace espurna {
+namespace garland {
+namespace bitstream {
+
+// I2S runs at 3.2MHz, which is 4 times the 800kHz of the strip. Every pixel bit becomes 4 I2S bits
+// - 0 is high for 312.5ns and low for 937.5ns, 0b1000
+// - 1 is high for 937.5ns and low for 312.5ns, 0b1110
+constexpr uint32_t BitRate { 3200000 };
+
+constexpr uint32_t Zero { 0b1000 };
+constexpr uint32_t One { 0b1110 };
+
+// Every pixel byte is exactly one 32-bit I2S sample. Output starts with the MSB of the sample,
+// so it also starts with the MSB of the pixel byte
+constexpr uint32_t encode(uint8_t value) {
+    return ((value & 0x80) ? One : Zero) << 28
+        | ((value & 0x40) ? One : Zero) << 24
+        | ((value & 0x20) ? One : Zero) << 20
+        | ((value & 0x10) ? One : Zero) << 16
+        | ((value & 0x08) ? One : Zero) << 12
+        | ((value & 0x04) ? One : Zero) << 8
+        | ((value & 0x02) ? One : Zero) << 4
+        | ((value & 0x01) ? One : Zero);
+}
+
+// Strip latches the data after the line stays low for a while. Newer WS2812B revisions
+// need at least 280us, which is 896 I2S bits
+constexpr uint32_t ResetMicros { 300 };
+constexpr size_t ResetWords { ((BitRate / 1000) * ResetMicros / 1000 + 31) / 32 };
+
+// Pixel data is expected to be in the strip order already (e.g. GRB). Returns the number of samples written
+inline size_t encode(const uint8_t* data, size_t size, uint32_t* out) {
+    for (size_t index = 0; index < size; ++index) {
+        out[index] = encode(data[index]);
+    }
+
+    return size;
+}
+
+} // namespace bitstream
+} // namespace garland
+} // namespace espurna
@@ -0,0 +1,195 @@
+/*
+Part of the GARLAND MODULE
+Copyright (C) 2021 by Maxim Prokhorov <prokhorov dot max at outlook dot com>
+
+Non-blocking strip output through the I2S DMA, based on the NeoPixelBus DMA method
+(ref. https://github.com/Makuna/NeoPixelBus/blob/master/src/internal/NeoEsp8266DmaMethod.h)
+*/
+
+#pragma once
+
+// Frame is encoded into the bitstream buffer, which DMA sends out on its own. `show()` returns right away,
+// and there is no need to disable the watchdog for long strips. Data is always sent through the GPIO3 (RX)
+//
+// DMA descriptors are linked like this, where the last frame one is the only one with the EOF bit:
+// | idle (reset) | -> | frame #0 | -> ... -> | frame #N | -> | idle (reset) | -> ...
+// When nothing is pending, idle descriptor points to itself and the line stays low
+class I2sDmaOutput {
+public:
+    static constexpr unsigned char Pin { 3 };
+
+    I2sDmaOutput() = default;
+
+    I2sDmaOutput(const I2sDmaOutput&) = delete;
+    I2sDmaOutput& operator=(const I2sDmaOutput&) = delete;
+
+    // Buffers are allocated once for the specified number of pixel bytes
+    void begin(size_t bytes);
+
+    // Returns `false` when previous frame is still being sent out
+    bool show(const uint8_t* data, size_t size);
+
+    bool busy() const {
+        return _state != State::Idle;
+    }
+
+    void wait() const {
+        while (busy()) {
+            espurna::time::blockingDelay(espurna::duration::Milliseconds(1));
+        }
+    }
+
+private:
+    // Same as the SDK `struct sdio_queue`, layout is fixed by the hardware
+    struct Descriptor {
+        uint32_t blocksize : 12;
+        uint32_t datalen : 12;
+        uint32_t unused : 5;
+        uint32_t sub_sof : 1;
+        uint32_t eof : 1;
+        volatile uint32_t owner : 1;
+        uint32_t* buffer;
+        Descriptor* next;
+    };
+
+    // Block size is 12 bits, but it should also be a multiple of the sample size
+    static constexpr size_t DescriptorBytesMax { 4092 };
+
+    // 160MHz / (5 * 10) is exactly the `bitstream::BitRate`
+    static constexpr uint32_t ClockDivider { 5 };
+    static constexpr uint32_t BitClockDivider { 10 };
+
+    enum class State {
+        Idle,
+        Pending,
+        Sending,
+    };
+
+    static void IRAM_ATTR isr(void*);
+
+    std::vector<uint32_t> _data;
+    std::vector<Descriptor> _descriptors;
+    Descriptor* _first { nullptr };
+
+    std::array<uint32_t, espurna::garland::bitstream::ResetWords> _reset{};
+    Descriptor _idle{};
+
+    volatile State _state { State::Idle };
+};
+
+void IRAM_ATTR I2sDmaOutput::isr(void* arg) {
+    auto* self = reinterpret_cast<I2sDmaOutput*>(arg);
+
+    const uint32_t status = SLCIS;
+    SLCIC = 0xFFFFFFFF;
+
+    if ((status & SLCIRXEOF) == 0) {
+        return;
+    }
+
+    auto* finished = reinterpret_cast<Descriptor*>(SLCRXEDA);
+
+    // DMA goes to the frame after the current reset is done
+    if (finished == &self->_idle) {
+        if (self->_state == State::Pending) {
+            self->_idle.next = self->_first;
+            self->_state = State::Sending;
+        }
+        return;
+    }
+
+    // Frame is done and DMA is sending the reset. There is enough time to loop it back
+    // before it is over, so the same frame is not sent twice
+    self->_idle.next = &self->_idle;
+    self->_state = State::Idle;
+}
+
+void I2sDmaOutput::begin(size_t bytes) {
+    _data.resize(std::max<size_t>(bytes, 1));
+
+    const size_t data_bytes = _data.size() * sizeof(uint32_t);
+    const size_t count = (data_bytes + DescriptorBytesMax - 1) / DescriptorBytesMax;
+    _descriptors.resize(count);
+
+    size_t offset = 0;
+    for (size_t index = 0; index < count; ++index) {
+        const bool last = (index + 1) == count;
+        const size_t size = std::min(data_bytes - offset, DescriptorBytesMax);
+
+        auto& descriptor = _descriptors[index];
+        descriptor.blocksize = size;
+        descriptor.datalen = size;
+        descriptor.unused = 0;
+        descriptor.sub_sof = 0;
+        descriptor.eof = last ? 1 : 0;
+        descriptor.owner = 1;
+        descriptor.buffer = _data.data() + (offset / sizeof(uint32_t));
+        descriptor.next = last ? &_idle : &_descriptors[index + 1];
+
+        offset += size;
+    }
+
+    _first = _descriptors.data();
+
+    _idle.blocksize = sizeof(_reset);
+    _idle.datalen = sizeof(_reset);
+    _idle.unused = 0;
+    _idle.sub_sof = 0;
+    _idle.eof = 1;
+    _idle.owner = 1;
+    _idle.buffer = _reset.data();
+    _idle.next = &_idle;
+
+    // Reset DMA and configure the 'RX' link, which is actually used for the I2S TX
+    ETS_SLC_INTR_DISABLE();
+    SLCC0 |= SLCRXLR | SLCTXLR;
+    SLCC0 &= ~(SLCRXLR | SLCTXLR);
+    SLCIC = 0xFFFFFFFF;
+
+    SLCC0 &= ~(SLCMM << SLCM);
+    SLCC0 |= (1 << SLCM);
+    SLCRXDC |= SLCBINR | SLCBTNR;
+    SLCRXDC &= ~(SLCBRXFE | SLCBRXEM | SLCBRXFM);
+
+    SLCRXL &= ~(SLCRXLAM << SLCRXLA);
+    SLCRXL |= reinterpret_cast<uint32_t>(&_idle) << SLCRXLA;
+
+    ETS_SLC_INTR_ATTACH(isr, this);
+    SLCIE = SLCIRXEOF;
+    ETS_SLC_INTR_ENABLE();
+
+    SLCRXL |= SLCRXLS;
+
+    // I2S data pin function, clock and 3.2MHz output
+    pinMode(Pin, FUNCTION_1);
+
+    I2S_CLK_ENABLE();
+    I2SIC = 0x3F;
+    I2SIE = 0;
+
+    I2SC &= ~(I2SRST);
+    I2SC |= I2SRST;
+    I2SC &= ~(I2SRST);
+
+    I2SFC &= ~(I2SDE | (I2STXFMM << I2STXFM) | (I2SRXFMM << I2SRXFM));
+    I2SFC |= I2SDE;
+    I2SCC &= ~((I2STXCMM << I2STXCM) | (I2SRXCMM << I2SRXCM));
+
+    I2SC &= ~(I2STSM | I2SRSM | (I2SBMM << I2SBM) | (I2SBDM << I2SBD) | (I2SCDM << I2SCD));
+    I2SC |= I2SRF | I2SMR | I2SRSM | I2SRMS
+        | ((BitClockDivider & I2SBDM) << I2SBD)
+        | ((ClockDivider & I2SCDM) << I2SCD);
+
+    I2SC |= I2STXS;
+}
+
+bool I2sDmaOutput::show(const uint8_t* data, size_t size) {
+    if (busy()) {
+        return false;
+    }
+
+    espurna::garland::bitstream::encode(data, std::min(size, _data.size()), _data.data());
+    _state = State::Pending;
+
+    return true;
+}
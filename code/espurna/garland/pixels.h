@@ -0,0 +1,97 @@
+/*
+Part of the GARLAND MODULE
+Copyright (C) 2021 by Maxim Prokhorov <prokhorov dot max at outlook dot com>
+
+Fixed-point pixel processing, shared by the scene and the unit tests
+*/
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace espurna {
+namespace garland {
+namespace pixels {
+
+// 0x00RRGGBB, same as the `Adafruit_NeoPixel::Color(r, g, b)`
+using Packed = uint32_t;
+
+constexpr Packed pack(uint8_t r, uint8_t g, uint8_t b) {
+    return (static_cast<Packed>(r) << 16)
+        | (static_cast<Packed>(g) << 8)
+        | static_cast<Packed>(b);
+}
+
+template <typename T>
+constexpr Packed pack(const T& color) {
+    return pack(color.r, color.g, color.b);
+}
+
+// Cross-fade weight in 8.8 fixed point, where 0 is `from` and 256 is `to`
+using Weight = uint16_t;
+
+constexpr Weight WeightMax { 256 };
+
+// Both red and blue are blended at the same time, since they are 16 bits apart in the packed value.
+// Neither of the lanes could overflow, 255 * 256 still fits into 16 bits
+inline Packed blend(Packed from, Packed to, Weight weight) {
+    constexpr Packed RedBlue { 0x00ff00ff };
+    constexpr Packed Green { 0x0000ff00 };
+
+    const Packed inverse = WeightMax - weight;
+
+    const Packed rb = (((from & RedBlue) * inverse) + ((to & RedBlue) * weight)) >> 8;
+    const Packed g = (((from & Green) * inverse) + ((to & Green) * weight)) >> 8;
+
+    return (rb & RedBlue) | (g & Green);
+}
+
+// Output level for every input level, with both gamma and brightness already applied
+class Lut {
+public:
+    using Table = std::array<uint8_t, 256>;
+
+    Lut() = default;
+
+    void update(const Table& gamma, uint8_t brightness) {
+        for (size_t index = 0; index < _table.size(); ++index) {
+            _table[index] = (static_cast<int>(gamma[index]) * brightness) / 256;
+        }
+    }
+
+    uint8_t operator[](uint8_t value) const {
+        return _table[value];
+    }
+
+    Packed operator()(Packed value) const {
+        return pack(
+            _table[(value >> 16) & 0xff],
+            _table[(value >> 8) & 0xff],
+            _table[value & 0xff]);
+    }
+
+private:
+    Table _table{};
+};
+
+// Either blends `current` into the `previous` frame, or simply applies the lut when transition is over.
+// `Out` receives the index and the packed pixel, ready to be sent to the strip
+template <typename T, typename Out>
+void render(const T* current, const T* previous, size_t size, Weight weight, const Lut& lut, Out&& out) {
+    if (weight && previous) {
+        for (size_t index = 0; index < size; ++index) {
+            out(index, lut(blend(pack(current[index]), pack(previous[index]), weight)));
+        }
+        return;
+    }
+
+    for (size_t index = 0; index < size; ++index) {
+        out(index, lut(pack(current[index])));
+    }
+}
+
+} // namespace pixels
+} // namespace garland
+} // namespace espurna
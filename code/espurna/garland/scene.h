@@ -28,11 +28,19 @@ Inspired by https://github.com/Vasil-Pahomov/ArWs2812 (currently https://github.
 #define GARLAND_SCENE_SPEED_FACTOR       10
 #define GARLAND_SCENE_DEFAULT_SPEED      40
 
-template <uint16_t Leds>
+// Part of the strip, starting at the `offset` pixel. Buffers are allocated once, when the scene is created
 class Scene {
 public:
-    Scene(Adafruit_NeoPixel* pixels) : _pixels(pixels) {}
-    constexpr uint16_t getLeds() const { return Leds; }
+    Scene(Adafruit_NeoPixel* pixels, uint16_t offset, uint16_t leds);
+
+    Scene(const Scene&) = delete;
+    Scene& operator=(const Scene&) = delete;
+
+    Scene(Scene&&) = default;
+    Scene& operator=(Scene&&) = default;
+
+    uint16_t getLeds() const { return _numLeds; }
+    uint16_t getOffset() const { return _offset; }
 
     bool finishedAnimCycle() { return _anim ? _anim->finishedycle() : true; }
     unsigned long getAvgCalcTime() { return calc_num > 0 ? sum_calc_time / calc_num : 0; }
@@ -51,21 +59,28 @@ public:
     void setBrightness(byte value);
     void setSpeed(byte speed);
     void setDefault();
-    void run();
     void setup();
 
+    // Returns `true` when this part of the strip wants to be shown. Since every scene shares the same
+    // output frame, strip is shown once for all of them and the time spent is reported back via `shown()`
+    bool run();
+    void shown(unsigned long show_time);
+
 private:
     Adafruit_NeoPixel* _pixels = nullptr;
+    uint16_t           _offset = 0;
+    uint16_t           _numLeds = 0;
+
     //Color arrays - two for making transition
-    std::array<Color, Leds> _leds1;
-    std::array<Color, Leds> _leds2;
+    std::vector<Color> _leds1;
+    std::vector<Color> _leds2;
     // array of Colorfor anim to currently work with
     Color*             _leds = nullptr;
     Anim*              _anim = nullptr;
 
     //auxiliary colors array for mutual usage of anims
-    std::array<Color, Leds> _ledstmp;
-    std::array<byte, Leds>  _seq;
+    std::vector<Color> _ledstmp;
+    std::vector<byte>  _seq;
 
     Palette*           _palette = nullptr;
     Palette*           _pals = nullptr;
@@ -97,6 +112,7 @@ private:
     }                  state = Calculate;
 
     int                numShows = 0;
+    bool               showPending = false;
 
     //whether to call SetUp on palette change
     //(some animations require full transition with fade, otherwise the colors would change in a step, some not)
@@ -120,5 +136,8 @@ private:
                                       158, 161, 163, 166, 169, 171, 174, 177, 180, 183, 186, 189, 192, 195, 198, 201, 204, 208, 211, 214, 218, 221,
                                       225, 228, 232, 236, 239, 243, 247, 251, 255}};
 
+    // gamma from the table above combined with the current brightness
+    espurna::garland::pixels::Lut _lut;
+
     void setupImpl();
 };
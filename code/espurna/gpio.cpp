@@ -565,6 +565,26 @@ private:
     unsigned char _pin;
 };
 
+// GPIO0...15 are written through the output set & clear registers. GPIO16 is
+// controlled through the RTC registers, and is written separately right after them
+class HardwarePort final : public Port {
+public:
+    const char* id() const override {
+        return "hardware";
+    }
+
+    void write(PortMask mask) override {
+        static constexpr uint32_t Gpio16 { 1 << 16 };
+
+        peripherals::reg_write(peripherals::pin::GpioOutputSet, mask.set & ~Gpio16);
+        peripherals::reg_write(peripherals::pin::GpioOutputClear, mask.clear & ~Gpio16);
+
+        if ((mask.set | mask.clear) & Gpio16) {
+            peripherals::rtc::gpio16_set((mask.set & Gpio16) != 0);
+        }
+    }
+};
+
 class Hardware : public GpioBase {
 public:
     static constexpr size_t Pins { 17 };
@@ -617,9 +637,15 @@ public:
         return std::make_unique<GpioPin>(pin);
     }
 
+    Port* port() override {
+        return &_port;
+    }
+
 private:
     using Mask = std::bitset<Pins>;
 
+    HardwarePort _port;
+
     bool _esp8285 { false };
     Mask _mask;
 };
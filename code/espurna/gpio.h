@@ -9,6 +9,7 @@ Copyright (C) 2017-2019 by Xose Pérez <xose dot perez at gmail dot com>
 #pragma once
 
 #include "settings.h"
+#include "gpio_port.h"
 #include "libs/BasePin.h"
 
 #include <cstddef>
@@ -55,6 +56,11 @@ public:
     virtual void lock(unsigned char index, bool value) = 0;
     virtual bool valid(unsigned char index) const = 0;
     virtual BasePinPtr pin(unsigned char index) = 0;
+
+    // when pins can also be written all at once, through the port register
+    virtual espurna::gpio::Port* port() {
+        return nullptr;
+    }
 };
 
 GpioBase* gpioBase(GpioType);
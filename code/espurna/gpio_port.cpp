@@ -0,0 +1,55 @@
+/*
+
+Part of the GPIO MODULE
+
+Copyright (C) 2021 by Maxim Prokhorov <prokhorov dot max at outlook dot com>
+
+*/
+
+#include <algorithm>
+#include <iterator>
+
+#include "gpio_port.h"
+
+namespace espurna {
+namespace gpio {
+
+Port::~Port() = default;
+
+void PortBatch::write(Port& port, uint8_t pin, bool value) {
+    auto it = std::find_if(_entries.begin(), _entries.end(),
+        [&](const Entry& entry) {
+            return entry.port == &port;
+        });
+
+    if (it == _entries.end()) {
+        _entries.push_back(Entry{
+            .port = &port,
+            .mask = PortMask{
+                .set = 0,
+                .clear = 0,
+            },
+        });
+        it = std::prev(_entries.end());
+    }
+
+    const uint32_t bit = uint32_t{1} << pin;
+    if (value) {
+        it->mask.set |= bit;
+        it->mask.clear &= ~bit;
+    } else {
+        it->mask.clear |= bit;
+        it->mask.set &= ~bit;
+    }
+}
+
+void PortBatch::commit() {
+    for (auto& entry : _entries) {
+        entry.port->write(entry.mask);
+    }
+
+    _entries.clear();
+}
+
+} // namespace gpio
+} // namespace espurna
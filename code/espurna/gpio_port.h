@@ -0,0 +1,63 @@
+/*
+
+Part of the GPIO MODULE
+
+Copyright (C) 2021 by Maxim Prokhorov <prokhorov dot max at outlook dot com>
+
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace espurna {
+namespace gpio {
+
+// Pins that need to be changed at the same time. Bit N is pin N of the port
+struct PortMask {
+    uint32_t set;
+    uint32_t clear;
+};
+
+// Output latch value after the mask is applied
+constexpr uint32_t apply(uint32_t latch, PortMask mask) {
+    return (latch | mask.set) & ~mask.clear;
+}
+
+// Group of pins that can be written all at once, e.g. hardware GPO register or the expander output latch
+class Port {
+public:
+    virtual ~Port();
+
+    virtual const char* id() const = 0;
+
+    // Every pin in the mask is expected to change at the same time
+    virtual void write(PortMask) = 0;
+};
+
+// Collects pin writes until commit(), then writes every touched port exactly once
+// Repeated writes to the same pin replace the previous value
+class PortBatch {
+public:
+    void write(Port&, uint8_t pin, bool value);
+
+    // Port writes happen in the order ports were first touched
+    void commit();
+
+    size_t pending() const {
+        return _entries.size();
+    }
+
+private:
+    struct Entry {
+        Port* port;
+        PortMask mask;
+    };
+
+    std::vector<Entry> _entries;
+};
+
+} // namespace gpio
+} // namespace espurna
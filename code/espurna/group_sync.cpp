@@ -0,0 +1,527 @@
+/*
+
+GROUP SYNC MODULE
+
+Light and relay state is sent to every device in the same group via UDP multicast,
+without the round-trip through the MQTT broker. Every frame includes the time when the
+state should be applied, so that all of the devices (including the sender) switch together
+
+Copyright (C) 2021 by Maxim Prokhorov <prokhorov dot max at outlook dot com>
+
+*/
+
+#include "espurna.h"
+
+#if GROUP_SYNC_SUPPORT
+
+#include <WiFiUdp.h>
+
+#include <limits>
+
+#include "group_sync.h"
+#include "ws.h"
+
+#if LIGHT_PROVIDER != LIGHT_PROVIDER_NONE
+#include "light.h"
+#endif
+
+#if RELAY_SUPPORT
+#include "relay.h"
+#endif
+
+namespace espurna {
+namespace group_sync {
+namespace {
+
+namespace build {
+
+// Frame is applied no later than this, regardless of what the sender asked for
+static constexpr auto DelayMax = duration::Milliseconds { 1000 };
+
+// Except for relays, where the sender waits for the local relay delay which can be a lot longer.
+// Apply time still has to stay within the wrap-safe range of the millisecond timestamps
+static constexpr auto RelayDelayMax = duration::Milliseconds {
+    static_cast<uint32_t>(std::numeric_limits<int32_t>::max()) };
+
+static constexpr auto RepeatsMax = size_t { 5 };
+
+constexpr uint16_t id() {
+    return GROUP_SYNC_ID;
+}
+
+const __FlashStringHelper* address() {
+    return F(GROUP_SYNC_ADDRESS);
+}
+
+constexpr uint16_t port() {
+    return GROUP_SYNC_PORT;
+}
+
+constexpr duration::Milliseconds delay() {
+    return duration::Milliseconds { GROUP_SYNC_DELAY };
+}
+
+constexpr size_t repeats() {
+    return GROUP_SYNC_REPEATS;
+}
+
+} // namespace build
+
+namespace settings {
+
+STRING_VIEW_INLINE(Prefix, "grp");
+
+namespace keys {
+
+STRING_VIEW_INLINE(Id, "grpId");
+STRING_VIEW_INLINE(Address, "grpAddress");
+STRING_VIEW_INLINE(Port, "grpPort");
+STRING_VIEW_INLINE(Delay, "grpDelay");
+STRING_VIEW_INLINE(Repeats, "grpRepeats");
+
+} // namespace keys
+
+uint16_t id() {
+    return getSetting(keys::Id, build::id());
+}
+
+IPAddress address() {
+    IPAddress out;
+    if (!out.fromString(getSetting(keys::Address, build::address()))) {
+        out.fromString(String(build::address()));
+    }
+
+    return out;
+}
+
+uint16_t port() {
+    return getSetting(keys::Port, build::port());
+}
+
+duration::Milliseconds delay() {
+    return std::min(getSetting(keys::Delay, build::delay()), build::DelayMax);
+}
+
+size_t repeats() {
+    return std::min(getSetting(keys::Repeats, build::repeats()), build::RepeatsMax);
+}
+
+} // namespace settings
+
+namespace internal {
+
+WiFiUDP udp;
+bool active { false };
+
+uint16_t id { build::id() };
+IPAddress address;
+uint16_t port { build::port() };
+duration::Milliseconds delay { build::delay() };
+size_t repeats { build::repeats() };
+
+uint32_t sender { 0 };
+uint32_t sequence { 0 };
+uint32_t sent { 0 };
+uint32_t invalid { 0 };
+
+Peers peers;
+
+} // namespace internal
+
+uint32_t now() {
+    return time::millis().time_since_epoch().count();
+}
+
+// -----------------------------------------------------------------------------
+// Sender keeps the last frame of every type and sends it a few more times before it is applied.
+// Every copy has the same sequence number and the updated timestamp, so the receivers that only
+// got one of the later copies still apply it at the same time as everyone else
+
+struct Outgoing {
+    Frame frame{};
+    size_t left { 0 };
+    duration::Milliseconds interval{};
+    timer::SystemTimer timer;
+};
+
+Outgoing outgoing_light;
+Outgoing outgoing_relay;
+
+void send(Frame& frame) {
+    frame.header.timestamp = now();
+
+    uint8_t buffer[FrameSizeMax];
+    const auto size = encode(frame, buffer, sizeof(buffer));
+    if (!size) {
+        return;
+    }
+
+    internal::udp.beginPacketMulticast(internal::address, internal::port, WiFi.localIP());
+    internal::udp.write(buffer, size);
+    if (internal::udp.endPacket()) {
+        ++internal::sent;
+    }
+}
+
+void resend(Outgoing& outgoing) {
+    if (!outgoing.left || !internal::active
+        || (static_cast<int32_t>(outgoing.frame.header.apply - now()) <= 0))
+    {
+        outgoing.left = 0;
+        return;
+    }
+
+    --outgoing.left;
+    send(outgoing.frame);
+
+    if (outgoing.left) {
+        outgoing.timer.schedule_once(outgoing.interval,
+            [&outgoing]() {
+                resend(outgoing);
+            });
+    }
+}
+
+duration::Milliseconds send(Outgoing& outgoing, Type type, duration::Milliseconds delay) {
+    const auto time = now();
+
+    outgoing.frame.header = Header{
+        .type = type,
+        .group = internal::id,
+        .sender = internal::sender,
+        .sequence = ++internal::sequence,
+        .timestamp = time,
+        .apply = time + delay.count(),
+    };
+
+    send(outgoing.frame);
+
+    outgoing.left = internal::repeats;
+    if (!outgoing.left) {
+        outgoing.timer.stop();
+        return delay;
+    }
+
+    // long relay delays do not slow down the repeats, these are still sent within the usual group delay
+    outgoing.interval = std::max(
+        duration::Milliseconds(std::min(delay, build::DelayMax).count() / (outgoing.left + 1)),
+        timer::SystemTimer::DurationMin);
+    outgoing.timer.schedule_once(outgoing.interval,
+        [&outgoing]() {
+            resend(outgoing);
+        });
+
+    return delay;
+}
+
+// -----------------------------------------------------------------------------
+// Receiver only keeps the latest state of every type. Newer light frame replaces the pending one,
+// relay frames are merged instead since every one of them may only include some of the relays
+
+struct Incoming {
+    Frame frame{};
+    timer::SystemTimer timer;
+};
+
+Incoming incoming_light;
+Incoming incoming_relay;
+
+#if LIGHT_PROVIDER != LIGHT_PROVIDER_NONE
+void apply_light(const Light& light) {
+    const auto channels = std::min<size_t>(light.channels, lightChannels());
+    for (size_t index = 0; index < channels; ++index) {
+        lightChannel(index, light.values[index]);
+    }
+
+    lightBrightness(light.brightness);
+    if (light.mireds) {
+        lightTemperature(light::Mireds{ .value = light.mireds });
+    }
+
+    lightState(light.state);
+
+    // notice that group reports are excluded, every other device already received the same frame
+    lightUpdate(
+        LightTransition{
+            .time = duration::Milliseconds(light.time),
+            .step = duration::Milliseconds(light.step),
+            .easing = lightTransitionEasing(),
+        },
+        light::Report::Default & ~(light::Report::Group | light::Report::MqttGroup),
+        lightSave());
+}
+#endif
+
+#if RELAY_SUPPORT
+void apply_relay(const Relay& relay) {
+    const auto relays = std::min<size_t>(relayCount(), 32);
+    for (size_t id = 0; id < relays; ++id) {
+        const uint32_t bit = 1ul << id;
+        if (relay.mask & bit) {
+            relayStatus(id, (relay.status & bit) != 0, true, false);
+        }
+    }
+}
+#endif
+
+void apply(Incoming& incoming) {
+    switch (incoming.frame.header.type) {
+    case Type::Light:
+#if LIGHT_PROVIDER != LIGHT_PROVIDER_NONE
+        apply_light(incoming.frame.light);
+#endif
+        break;
+
+    case Type::Relay:
+#if RELAY_SUPPORT
+        apply_relay(incoming.frame.relay);
+#endif
+        incoming.frame.relay = Relay{};
+        break;
+    }
+}
+
+void schedule(Incoming& incoming, const Frame& frame) {
+    if (frame.header.type == Type::Relay) {
+        auto& relay = incoming.frame.relay;
+        relay.status = (relay.status & ~frame.relay.mask)
+            | (frame.relay.status & frame.relay.mask);
+        relay.mask |= frame.relay.mask;
+        incoming.frame.header = frame.header;
+    } else {
+        incoming.frame = frame;
+    }
+
+    const auto delay = std::min(
+        duration::Milliseconds(frame.header.apply - frame.header.timestamp),
+        (frame.header.type == Type::Relay)
+            ? build::RelayDelayMax
+            : build::DelayMax);
+    if (delay.count()) {
+        incoming.timer.schedule_once(delay,
+            [&incoming]() {
+                apply(incoming);
+            });
+        return;
+    }
+
+    incoming.timer.stop();
+    apply(incoming);
+}
+
+void receive(const uint8_t* data, size_t size) {
+    Frame frame{};
+    if (!decode(data, size, frame)) {
+        ++internal::invalid;
+        return;
+    }
+
+    if ((frame.header.group != internal::id) || (frame.header.sender == internal::sender)) {
+        return;
+    }
+
+    const auto result = internal::peers.accept(
+        frame.header.sender, frame.header.sequence, now());
+    if (result != Peers::Result::Accepted) {
+        return;
+    }
+
+    switch (frame.header.type) {
+    case Type::Light:
+        schedule(incoming_light, frame);
+        break;
+    case Type::Relay:
+        schedule(incoming_relay, frame);
+        break;
+    }
+}
+
+void loop() {
+    if (!internal::active) {
+        return;
+    }
+
+    uint8_t buffer[FrameSizeMax + 1];
+    for (;;) {
+        const auto size = internal::udp.parsePacket();
+        if (size <= 0) {
+            break;
+        }
+
+        const auto length = internal::udp.read(buffer, sizeof(buffer));
+        if (length > 0) {
+            receive(buffer, length);
+        }
+    }
+}
+
+void stop() {
+    if (internal::active) {
+        internal::active = false;
+        internal::udp.stop();
+        DEBUG_MSG_P(PSTR("[GROUP] Stopped\n"));
+    }
+}
+
+void start() {
+    stop();
+    if (!internal::id || !internal::address.isSet() || !wifiConnected()) {
+        return;
+    }
+
+    internal::active = internal::udp.beginMulticast(
+        WiFi.localIP(), internal::address, internal::port) != 0;
+    if (internal::active) {
+        DEBUG_MSG_P(PSTR("[GROUP] Group #%hu at %s:%hu\n"),
+            internal::id, internal::address.toString().c_str(), internal::port);
+    }
+}
+
+void configure() {
+    const auto id = settings::id();
+    const auto address = settings::address();
+    const auto port = settings::port();
+
+    const bool changed = (id != internal::id)
+        || (address != internal::address)
+        || (port != internal::port);
+
+    internal::id = id;
+    internal::address = address;
+    internal::port = port;
+    internal::delay = settings::delay();
+    internal::repeats = settings::repeats();
+
+    if (changed || !internal::active) {
+        start();
+    }
+}
+
+#if WEB_SUPPORT
+namespace web {
+
+bool onKeyCheck(StringView key, const JsonVariant&) {
+    return key.startsWith(settings::Prefix);
+}
+
+void onVisible(JsonObject& root) {
+    wsPayloadModule(root, settings::Prefix);
+}
+
+void onConnected(JsonObject& root) {
+    root[settings::keys::Id] = internal::id;
+    root[settings::keys::Address] = internal::address.toString();
+    root[settings::keys::Port] = internal::port;
+    root[settings::keys::Delay] = internal::delay.count();
+    root[settings::keys::Repeats] = internal::repeats;
+}
+
+} // namespace web
+#endif
+
+#if TERMINAL_SUPPORT
+namespace terminal {
+
+PROGMEM_STRING(Group, "GROUP");
+
+void group(::terminal::CommandContext&& ctx) {
+    const auto& stats = internal::peers.stats();
+    ctx.output.printf_P(
+        PSTR("group #%hu (%s), sequence %u, sent %u\n"
+             "peers %zu, accepted %u, duplicate %u, stale %u, lost %u, restarted %u, invalid %u\n"),
+        internal::id, internal::active ? PSTR("active") : PSTR("inactive"),
+        internal::sequence, internal::sent,
+        internal::peers.size(), stats.accepted, stats.duplicate,
+        stats.stale, stats.lost, stats.restarted, internal::invalid);
+    terminalOK(ctx);
+}
+
+static constexpr ::terminal::Command Commands[] PROGMEM {
+    {Group, group},
+};
+
+void setup() {
+    espurna::terminal::add(Commands);
+}
+
+} // namespace terminal
+#endif
+
+void setup() {
+    internal::sender = ESP.getChipId();
+
+    // Otherwise, receivers would drop the frames after reboot until they are past the old sequence
+    internal::sequence = randomNumber();
+
+    wifiRegister([](wifi::Event event) {
+        switch (event) {
+        case wifi::Event::StationConnected:
+            start();
+            break;
+        case wifi::Event::StationDisconnected:
+            stop();
+            break;
+        default:
+            break;
+        }
+    });
+
+#if TERMINAL_SUPPORT
+    terminal::setup();
+#endif
+#if WEB_SUPPORT
+    wsRegister()
+        .onVisible(web::onVisible)
+        .onConnected(web::onConnected)
+        .onKeyCheck(web::onKeyCheck);
+#endif
+
+    ::espurnaRegisterReload(configure);
+    ::espurnaRegisterLoop(loop);
+    configure();
+}
+
+} // namespace
+} // namespace group_sync
+} // namespace espurna
+
+// -----------------------------------------------------------------------------
+
+espurna::duration::Milliseconds groupSyncLight(const espurna::group_sync::Light& light) {
+    using namespace espurna::group_sync;
+    if (!internal::active) {
+        return espurna::duration::Milliseconds::zero();
+    }
+
+    outgoing_light.frame.light = light;
+    return send(outgoing_light, Type::Light, internal::delay);
+}
+
+espurna::duration::Milliseconds groupSyncRelay(size_t id, bool status, espurna::duration::Milliseconds delay) {
+    using namespace espurna::group_sync;
+    if (!internal::active || (id >= 32)) {
+        return espurna::duration::Milliseconds::zero();
+    }
+
+    // relays that were changed before the last frame was applied are sent together with the new one
+    auto& relay = outgoing_relay.frame.relay;
+    if (static_cast<int32_t>(outgoing_relay.frame.header.apply - now()) <= 0) {
+        relay = Relay{};
+    }
+
+    const uint32_t bit = 1ul << id;
+    relay.mask |= bit;
+    relay.status = status
+        ? (relay.status | bit)
+        : (relay.status & ~bit);
+
+    // receivers wait for the same delay as the local relay, even when it is longer than the group delay
+    return send(outgoing_relay, Type::Relay,
+        std::min(std::max(delay, internal::delay), build::RelayDelayMax));
+}
+
+void groupSyncSetup() {
+    ::espurna::group_sync::setup();
+}
+
+#endif // GROUP_SYNC_SUPPORT
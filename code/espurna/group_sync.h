@@ -0,0 +1,22 @@
+/*
+
+GROUP SYNC MODULE
+
+Copyright (C) 2021 by Maxim Prokhorov <prokhorov dot max at outlook dot com>
+
+*/
+
+#pragma once
+
+#include "group_sync_frame.h"
+#include "types.h"
+
+// Send out the complete light state to the group. Returns the delay after which
+// every device in the group (including this one) is expected to apply it,
+// or zero when synchronization is not active
+espurna::duration::Milliseconds groupSyncLight(const espurna::group_sync::Light&);
+
+// Same as above, but for a single relay. Delay is at least the one requested
+espurna::duration::Milliseconds groupSyncRelay(size_t id, bool status, espurna::duration::Milliseconds);
+
+void groupSyncSetup();
@@ -0,0 +1,231 @@
+/*
+
+Part of the GROUP SYNC MODULE
+
+Copyright (C) 2021 by Maxim Prokhorov <prokhorov dot max at outlook dot com>
+
+*/
+
+#include <algorithm>
+
+#include "group_sync_frame.h"
+
+namespace espurna {
+namespace group_sync {
+namespace {
+
+constexpr uint8_t Magic[] { 'E', 'G' };
+
+struct Writer {
+    void u8(uint8_t value) {
+        if (_cursor < _size) {
+            _data[_cursor] = value;
+        }
+        ++_cursor;
+    }
+
+    void u16(uint16_t value) {
+        u8(value & 0xff);
+        u8(value >> 8);
+    }
+
+    void u32(uint32_t value) {
+        u16(value & 0xffff);
+        u16(value >> 16);
+    }
+
+    bool ok() const {
+        return _cursor <= _size;
+    }
+
+    size_t size() const {
+        return _cursor;
+    }
+
+    uint8_t* _data;
+    size_t _size;
+    size_t _cursor;
+};
+
+struct Reader {
+    uint8_t u8() {
+        uint8_t out { 0 };
+        if (_cursor < _size) {
+            out = _data[_cursor];
+        }
+        ++_cursor;
+        return out;
+    }
+
+    uint16_t u16() {
+        const uint16_t low = u8();
+        const uint16_t high = u8();
+        return low | (high << 8);
+    }
+
+    uint32_t u32() {
+        const uint32_t low = u16();
+        const uint32_t high = u16();
+        return low | (high << 16);
+    }
+
+    bool ok() const {
+        return _cursor <= _size;
+    }
+
+    bool done() const {
+        return _cursor == _size;
+    }
+
+    const uint8_t* _data;
+    size_t _size;
+    size_t _cursor;
+};
+
+} // namespace
+
+size_t encode(const Frame& frame, uint8_t* out, size_t size) {
+    Writer writer{out, size, 0};
+
+    writer.u8(Magic[0]);
+    writer.u8(Magic[1]);
+    writer.u8(Version);
+    writer.u8(static_cast<uint8_t>(frame.header.type));
+    writer.u16(frame.header.group);
+    writer.u32(frame.header.sender);
+    writer.u32(frame.header.sequence);
+    writer.u32(frame.header.timestamp);
+    writer.u32(frame.header.apply);
+
+    switch (frame.header.type) {
+    case Type::Light:
+        writer.u8(frame.light.state ? 1 : 0);
+        writer.u8(frame.light.brightness);
+        writer.u8(std::min<uint8_t>(frame.light.channels, Light::ChannelsMax));
+        for (auto value : frame.light.values) {
+            writer.u8(value);
+        }
+        writer.u16(frame.light.mireds);
+        writer.u32(frame.light.time);
+        writer.u16(frame.light.step);
+        break;
+
+    case Type::Relay:
+        writer.u32(frame.relay.mask);
+        writer.u32(frame.relay.status);
+        break;
+
+    default:
+        return 0;
+    }
+
+    return writer.ok() ? writer.size() : 0;
+}
+
+bool decode(const uint8_t* data, size_t size, Frame& frame) {
+    Reader reader{data, size, 0};
+
+    if ((reader.u8() != Magic[0]) || (reader.u8() != Magic[1])) {
+        return false;
+    }
+
+    if (reader.u8() != Version) {
+        return false;
+    }
+
+    frame.header.type = static_cast<Type>(reader.u8());
+    frame.header.group = reader.u16();
+    frame.header.sender = reader.u32();
+    frame.header.sequence = reader.u32();
+    frame.header.timestamp = reader.u32();
+    frame.header.apply = reader.u32();
+
+    switch (frame.header.type) {
+    case Type::Light:
+        frame.light.state = reader.u8() != 0;
+        frame.light.brightness = reader.u8();
+        frame.light.channels = reader.u8();
+        for (auto& value : frame.light.values) {
+            value = reader.u8();
+        }
+        frame.light.mireds = reader.u16();
+        frame.light.time = reader.u32();
+        frame.light.step = reader.u16();
+
+        if (frame.light.channels > Light::ChannelsMax) {
+            return false;
+        }
+        break;
+
+    case Type::Relay:
+        frame.relay.mask = reader.u32();
+        frame.relay.status = reader.u32();
+        break;
+
+    default:
+        return false;
+    }
+
+    return reader.ok() && reader.done();
+}
+
+Peers::Result Peers::accept(uint32_t sender, uint32_t sequence, uint32_t now) {
+    auto* const begin = _peers.data();
+    auto* const end = begin + _size;
+
+    auto* peer = std::find_if(begin, end,
+        [&](const Peer& entry) {
+            return entry.sender == sender;
+        });
+
+    if (peer == end) {
+        if (_size < Size) {
+            ++_size;
+        } else {
+            peer = std::min_element(begin, end,
+                [&](const Peer& lhs, const Peer& rhs) {
+                    return (now - lhs.seen) > (now - rhs.seen);
+                });
+        }
+
+        *peer = Peer{
+            .sender = sender,
+            .sequence = sequence,
+            .seen = now,
+        };
+
+        ++_stats.accepted;
+        return Result::Accepted;
+    }
+
+    const auto distance = static_cast<int32_t>(sequence - peer->sequence);
+    if (((now - peer->seen) > Expiry) || (distance < -Window)) {
+        peer->sequence = sequence;
+        peer->seen = now;
+
+        ++_stats.restarted;
+        ++_stats.accepted;
+        return Result::Accepted;
+    }
+
+    peer->seen = now;
+
+    if (distance == 0) {
+        ++_stats.duplicate;
+        return Result::Duplicate;
+    }
+
+    if (distance < 0) {
+        ++_stats.stale;
+        return Result::Stale;
+    }
+
+    _stats.lost += static_cast<uint32_t>(distance - 1);
+    ++_stats.accepted;
+
+    peer->sequence = sequence;
+    return Result::Accepted;
+}
+
+} // namespace group_sync
+} // namespace espurna
@@ -0,0 +1,126 @@
+/*
+
+Part of the GROUP SYNC MODULE
+
+Copyright (C) 2021 by Maxim Prokhorov <prokhorov dot max at outlook dot com>
+
+*/
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace espurna {
+namespace group_sync {
+
+// Every frame carries the complete state of either the light or the relays, so it is always
+// safe to drop the older ones. Multi-byte values are little-endian
+//
+// | magic 'E' 'G' | version | type | group (u16) | sender (u32) | sequence (u32) | timestamp (u32) | apply (u32) | payload |
+//
+// Both `timestamp` and `apply` are in the sender milliseconds. Receiver is expected to
+// apply the state after (apply - timestamp) milliseconds, counting from the moment it got the frame
+
+enum class Type : uint8_t {
+    Light = 1,
+    Relay = 2,
+};
+
+struct Header {
+    Type type;
+    uint16_t group;
+    uint32_t sender;
+    uint32_t sequence;
+    uint32_t timestamp;
+    uint32_t apply;
+};
+
+struct Light {
+    static constexpr size_t ChannelsMax { 5 };
+
+    bool state;
+    uint8_t brightness;
+    uint8_t channels;
+    std::array<uint8_t, ChannelsMax> values;
+    uint16_t mireds;
+    uint32_t time;
+    uint16_t step;
+};
+
+// Bit N of the `mask` is set when relay N is included
+struct Relay {
+    uint32_t mask;
+    uint32_t status;
+};
+
+struct Frame {
+    Header header;
+    Light light;
+    Relay relay;
+};
+
+static constexpr uint8_t Version { 1 };
+static constexpr size_t HeaderSize { 2 + 1 + 1 + 2 + 4 + 4 + 4 + 4 };
+static constexpr size_t LightSize { 1 + 1 + 1 + Light::ChannelsMax + 2 + 4 + 2 };
+static constexpr size_t RelaySize { 4 + 4 };
+static constexpr size_t FrameSizeMax { HeaderSize + LightSize };
+
+// Returns the number of bytes written, or 0 when frame does not fit
+size_t encode(const Frame&, uint8_t* out, size_t size);
+
+// Returns `false` when data is not a valid frame
+bool decode(const uint8_t* data, size_t size, Frame&);
+
+// Remembers the last sequence number of every sender. Since every frame is the complete state,
+// there is no need to wait for the missing ones; anything older than the last frame is dropped
+class Peers {
+public:
+    static constexpr size_t Size { 8 };
+
+    // Sender that was not seen for a while, or the one that is too far behind, is assumed to be restarted
+    // and its sequence is reset. Late copies and re-ordered frames are only expected to be a few steps behind
+    static constexpr uint32_t Expiry { 60000 };
+    static constexpr int32_t Window { 64 };
+
+    enum class Result {
+        Accepted,
+        Duplicate,
+        Stale,
+    };
+
+    struct Stats {
+        uint32_t accepted;
+        uint32_t duplicate;
+        uint32_t stale;
+        uint32_t lost;
+        uint32_t restarted;
+    };
+
+    // Sequence numbers are expected to wrap around, only the (signed) distance between them matters
+    // When the table is full, the least recently seen sender is forgotten. `now` is in milliseconds
+    Result accept(uint32_t sender, uint32_t sequence, uint32_t now);
+
+    const Stats& stats() const {
+        return _stats;
+    }
+
+    size_t size() const {
+        return _size;
+    }
+
+private:
+    struct Peer {
+        uint32_t sender;
+        uint32_t sequence;
+        uint32_t seen;
+    };
+
+    std::array<Peer, Size> _peers{};
+    size_t _size { 0 };
+    Stats _stats{};
+};
+
+} // namespace group_sync
+} // namespace espurna
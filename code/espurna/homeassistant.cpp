@@ -801,7 +801,7 @@ void receiveLightJson(StringView payload) {
         }
     }
 
-    lightUpdate({transition, lightTransitionStep()});
+    lightUpdate({transition, lightTransitionStep(), lightTransitionEasing()});
 }
 
 #endif
@@ -76,6 +76,32 @@ namespace types {
 
     using EventHandler = std::function<void(const EventEmitter& self, types::Event event, uint8_t count, unsigned long length)>;
 
+    // Pin level change, as seen by the interrupt handler. Timestamp is in CPU cycles and wraps around,
+    // only the difference between it and a later cycle count is meaningful
+    struct Edge {
+        uint32_t timestamp;
+        bool value;
+    };
+
+    // Single-producer single-consumer ring of edges, written from the ISR and read from loop()
+    // Producer only ever modifies `head`, consumer only ever modifies `tail`
+    // Called from the ISR after an edge is stored, must be placed in the IRAM as well
+    using Notify = void(*)();
+
+    struct Edges {
+        static constexpr size_t Capacity = 16;
+        static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of 2");
+
+        Edge buffer[Capacity];
+
+        volatile uint8_t head { 0 };
+        volatile uint8_t tail { 0 };
+        volatile bool overflow { false };
+
+        Notify notify { nullptr };
+        uint8_t pin;
+    };
+
 }
 
 class EventEmitter {
@@ -85,9 +111,24 @@ class EventEmitter {
         EventEmitter(BasePinPtr&& pin, const types::Config& config = {types::Mode::Pushbutton, types::PinValue::High, types::PinMode::Input}, unsigned long delay = DebounceDelay, unsigned long repeat = RepeatDelay);
         EventEmitter(BasePinPtr&& pin, types::EventHandler callback, const types::Config& = {types::Mode::Pushbutton, types::PinValue::High, types::PinMode::Input}, unsigned long delay = DebounceDelay, unsigned long repeat = RepeatDelay);
 
+        ~EventEmitter();
+
         types::Event loop();
         bool isPressed();
 
+        // Instead of polling the pin every loop(), capture level changes through the GPIO interrupt
+        // Only valid for the hardware GPIO, returns false when pin does not support interrupts
+        bool enableInterrupts(unsigned char gpio, types::Notify notify = nullptr);
+        void disableInterrupts();
+
+        // Time (in ms) until loop() is expected to be called again, so that pending changes are resolved in time
+        // Polled pins are expected to be checked at least once per debounce delay
+        unsigned long deadline() const;
+
+        bool interrupts() const {
+            return static_cast<bool>(_edges);
+        }
+
         const BasePinPtr& pin() const;
         const types::Config& config() const;
 
@@ -95,8 +136,15 @@ class EventEmitter {
         unsigned long getEventCount();
 
     private:
+        static void IRAM_ATTR _isr(void* arg);
+
+        types::Event _pollEdges();
+        types::Event _pollPin();
+        types::Event _change(unsigned long timestamp);
+
         BasePinPtr _pin;
         types::EventHandler _callback;
+        std::unique_ptr<types::Edges> _edges;
 
         const types::Config _config;
 
@@ -108,6 +156,11 @@ class EventEmitter {
         bool _default_value { true };
         bool _value { true };
 
+        // pin value that is waiting for the debounce delay to pass
+        bool _pending { false };
+        bool _pending_value { true };
+        unsigned long _pending_start { 0ul };
+
         bool _ready { false };
         bool _reset_count { true };
 
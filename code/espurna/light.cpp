@@ -12,6 +12,7 @@ Copyright (C) 2019-2021 by Maxim Prokhorov <prokhorov dot max at outlook dot com
 #if LIGHT_PROVIDER != LIGHT_PROVIDER_NONE
 
 #include "api.h"
+#include "light_curve.h"
 #include "mqtt.h"
 #include "relay.h"
 #include "rpc.h"
@@ -26,6 +27,10 @@ Copyright (C) 2019-2021 by Maxim Prokhorov <prokhorov dot max at outlook dot com
 
 #include "libs/fs_math.h"
 
+#if GROUP_SYNC_SUPPORT
+#include "group_sync.h"
+#endif
+
 #if LIGHT_PROVIDER == LIGHT_PROVIDER_MY92XX
 #include <my92xx.h>
 #endif
@@ -97,6 +102,14 @@ constexpr espurna::duration::Milliseconds transitionStep() {
     return espurna::duration::Milliseconds(LIGHT_TRANSITION_STEP);
 }
 
+constexpr Easing transitionEasing() {
+    return LIGHT_TRANSITION_EASING;
+}
+
+constexpr ColorSpace transitionSpace() {
+    return LIGHT_TRANSITION_SPACE;
+}
+
 constexpr bool save() {
     return 1 == LIGHT_SAVE_ENABLED;
 }
@@ -198,6 +211,60 @@ constexpr unsigned char my92xxChannel(size_t channel) {
 
 } // namespace build
 
+namespace settings {
+namespace options {
+
+PROGMEM_STRING(Linear, "linear");
+PROGMEM_STRING(InOut, "in-out");
+PROGMEM_STRING(Exponential, "exp");
+
+static constexpr std::array<espurna::settings::options::Enumeration<Easing>, 3> EasingOptions PROGMEM {
+    {{Easing::Linear, Linear},
+     {Easing::InOut, InOut},
+     {Easing::Exponential, Exponential}}
+};
+
+PROGMEM_STRING(Channels, "channels");
+PROGMEM_STRING(Hsv, "hsv");
+PROGMEM_STRING(Oklab, "oklab");
+
+static constexpr std::array<espurna::settings::options::Enumeration<ColorSpace>, 3> ColorSpaceOptions PROGMEM {
+    {{ColorSpace::Channels, Channels},
+     {ColorSpace::Hsv, Hsv},
+     {ColorSpace::Oklab, Oklab}}
+};
+
+} // namespace options
+} // namespace settings
+} // namespace
+} // namespace light
+
+namespace settings {
+namespace internal {
+
+template <>
+light::Easing convert(const String& value) {
+    return convert(light::settings::options::EasingOptions, value, light::build::transitionEasing());
+}
+
+String serialize(light::Easing value) {
+    return serialize(light::settings::options::EasingOptions, value);
+}
+
+template <>
+light::ColorSpace convert(const String& value) {
+    return convert(light::settings::options::ColorSpaceOptions, value, light::build::transitionSpace());
+}
+
+String serialize(light::ColorSpace value) {
+    return serialize(light::settings::options::ColorSpaceOptions, value);
+}
+
+} // namespace internal
+} // namespace settings
+
+namespace light {
+namespace {
 namespace settings {
 
 unsigned char enablePin() {
@@ -339,6 +406,18 @@ void transitionStep(espurna::duration::Milliseconds value) {
     setSetting("ltStep", value.count());
 }
 
+Easing transitionEasing() {
+    return getSetting("ltEase", build::transitionEasing());
+}
+
+void transitionEasing(Easing value) {
+    setSetting("ltEase", value);
+}
+
+ColorSpace transitionSpace() {
+    return getSetting("ltSpace", build::transitionSpace());
+}
+
 bool save() {
     return getSetting("ltSave", build::save());
 }
@@ -413,8 +492,8 @@ struct LightChannel {
             espurna::light::ValueMin, espurna::light::ValueMax);
     }
 
-    bool inverse { false };                // re-map the value from [ValueMin:ValueMax] to [ValueMax:ValueMin]
-    bool gamma { false };                  // apply gamma correction to the target value
+    bool inverse { false };                // re-map the output value from [min:max] to [max:min]
+    bool gamma { false };                  // apply perceptual correction to the output value
 
     // TODO: remove in favour of global control, since relays are no longer bound to a single channel?
     bool state { true };                   // is the channel ON
@@ -423,7 +502,8 @@ struct LightChannel {
     long value { espurna::light::ValueMin };        // normalized, including brightness
     long target { espurna::light::ValueMin };       // resulting value that will be given to the provider
 
-    float current { espurna::light::ValueMin };     // interim between input and target, used by the transition handler
+    espurna::light::transition::Fixed current {     // interim between the previous and current target, used by the transition handler
+        espurna::light::transition::fixed(espurna::light::ValueMin) };
 };
 
 using LightChannels = std::vector<LightChannel>;
@@ -1566,103 +1646,65 @@ void _lightAdjustMireds(espurna::StringView payload) {
 
 namespace {
 
-// Gamma Correction lookup table (8 bit, ~2.2)
-// TODO: input value modifier, instead of a transition-only thing?
-// TODO: calculate on the fly instead of limiting this to an 8bit value?
-
-static constexpr long LightGammaMin { 0 };
-static constexpr long LightGammaMax { 255 };
-
-long _lightGammaValue(size_t index) {
-    static const std::array<uint8_t, 256> Gamma PROGMEM {
-        0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
-        1,   1,   1,   1,   1,   1,   1,   1,   1,   1,   2,   2,   2,   2,   2,   2,
-        3,   3,   3,   3,   3,   3,   4,   4,   4,   4,   5,   5,   5,   5,   6,   6,
-        6,   7,   7,   7,   7,   8,   8,   8,   9,   9,   9,   10,  10,  11,  11,  11,
-        12,  12,  13,  13,  14,  14,  14,  15,  15,  16,  16,  17,  17,  18,  18,  19,
-        19,  20,  20,  21,  22,  22,  23,  23,  24,  25,  25,  26,  26,  27,  28,  28,
-        29,  30,  30,  31,  32,  33,  33,  34,  35,  35,  36,  37,  38,  39,  39,  40,
-        41,  42,  43,  43,  44,  45,  46,  47,  48,  49,  50,  50,  51,  52,  53,  54,
-        55,  56,  57,  58,  59,  60,  61,  62,  63,  64,  65,  66,  67,  68,  69,  71,
-        72,  73,  74,  75,  76,  77,  78,  80,  81,  82,  83,  84,  86,  87,  88,  89,
-        91,  92,  93,  94,  96,  97,  98,  100, 101, 102, 104, 105, 106, 108, 109, 110,
-        112, 113, 115, 116, 118, 119, 121, 122, 123, 125, 126, 128, 130, 131, 133, 134,
-        136, 137, 139, 140, 142, 144, 145, 147, 149, 150, 152, 154, 155, 157, 159, 160,
-        162, 164, 166, 167, 169, 171, 173, 175, 176, 178, 180, 182, 184, 186, 187, 189,
-        191, 193, 195, 197, 199, 201, 203, 205, 207, 209, 211, 213, 215, 217, 219, 221,
-        223, 225, 227, 229, 231, 233, 235, 238, 240, 242, 244, 246, 248, 251, 253, 255
-    };
+// Transition runs in the linear space of channel values, which are then converted
+// to the native resolution of the provider every step. Perceptual correction is a
+// CIE 1931 lightness curve, so there are no visible steps near the lower end of the
+// output range even when the input changes by less than a single [ValueMin:ValueMax] unit
 
-    if (index < Gamma.size()) {
-        return pgm_read_byte(&Gamma[index]);
-    }
+static_assert((espurna::light::ValueMax - espurna::light::ValueMin) != 0, "");
 
-    return 0;
+uint32_t _lightCurveInput(espurna::light::transition::Fixed value) {
+    using namespace espurna::light::transition;
+    constexpr auto Min = fixed(espurna::light::ValueMin);
+    constexpr auto Max = fixed(espurna::light::ValueMax);
+
+    return static_cast<uint32_t>(
+        (static_cast<int64_t>(std::clamp(value, Min, Max) - Min) * espurna::light::curve::Unit) / (Max - Min));
 }
 
-long _lightGammaMap(long value) {
-    static_assert(espurna::light::ValueMin >= 0, "");
-    static_assert(espurna::light::ValueMax >= 0, "");
+uint32_t _lightOutputValue(const LightChannel& channel, espurna::light::transition::Fixed value, uint32_t min, uint32_t max) {
+    const auto input = _lightCurveInput(value);
+    const auto range = max - min;
 
-    constexpr auto Divisor = (espurna::light::ValueMax - espurna::light::ValueMin);
-    if (Divisor != 0l) {
-        const long Scaled {
-            (value - espurna::light::ValueMin) * (LightGammaMax - LightGammaMin) / Divisor + LightGammaMin };
-        return _lightGammaValue(static_cast<size_t>(Scaled));
+    auto out = channel.gamma
+        ? espurna::light::curve::cie1931(input, range)
+        : espurna::light::curve::linear(input, range);
+
+    if (channel.inverse) {
+        out = range - out;
     }
 
-    return espurna::light::ValueMin;
+    return out + min;
 }
 
 class LightTransitionHandler {
 public:
-    // internal calculations are done in floats, so hard-limit target & step time to a certain value
-    // that can be representend precisely when casting milliseconds times back and forth
+    // every channel uses the same number of steps, calculated from the transition time
+    // limit both times to something reasonable, step counter is not expected to overflow
     static constexpr espurna::duration::Milliseconds TimeMin { 10 };
     static constexpr espurna::duration::Milliseconds TimeMax { 1ul << 24ul };
 
-    struct Transition {
-        float& value;
-        long target;
-        float step;
-        size_t count;
-    };
-
-    using Transitions = std::vector<Transition>;
+    using Engine = espurna::light::transition::Engine;
+    using Paths = std::vector<Engine::Path>;
 
     LightTransitionHandler() = delete;
 
-    LightTransitionHandler(LightChannels& channels, LightTransition transition, bool state) :
+    // When paths are provided, every channel goes through the respective one instead of the straight line
+    LightTransitionHandler(LightChannels& channels, LightTransition transition, bool state, const Paths& paths) :
         _transition(clamp(transition)),
         _state(state)
     {
-        prepare(channels, transition, state);
+        prepare(channels, state, paths);
     }
 
     template <typename StateFunc, typename ValueFunc, typename UpdateFunc>
     bool run(StateFunc&& state, ValueFunc&& value, UpdateFunc&& update) {
-        bool next { false };
-
         if (!_state_notified && _state) {
             _state_notified = true;
             state(_state);
         }
 
-        for (size_t index = 0; index < _prepared.size(); ++index) {
-            auto& transition = _prepared[index];
-            if (!transition.count) {
-                continue;
-            }
-
-            if (--transition.count) {
-                transition.value += transition.step;
-                next = true;
-            } else {
-                transition.value = transition.target;
-            }
-
-            value(index, transition.value);
-        }
+        const auto next = _engine.run(value);
 
         if (!_state_notified && !next && !_state) {
             _state_notified = true;
@@ -1674,8 +1716,8 @@ public:
         return next;
     }
 
-    const Transitions& prepared() const {
-        return _prepared;
+    const Engine& engine() const {
+        return _engine;
     }
 
     bool state() const {
@@ -1696,12 +1738,26 @@ private:
         _transition.step = TimeMin;
     }
 
-    void prepare(LightChannels& channels, LightTransition transition, bool state) {
+    void prepare(LightChannels& channels, bool state, const Paths& paths) {
         // generate a single transitions list for all the channels that had changed
         // after that, provider loop will run() the list and assign intermediate target value(s)
+        _engine.reset(_transition.easing, steps(_transition));
+
+        const bool path { paths.size() == channels.size() };
+
         bool delayed { false };
-        for (auto& channel : channels) {
-            if (prepare(channel, transition, state)) {
+        for (size_t index = 0; index < channels.size(); ++index) {
+            auto& channel = channels[index];
+
+            const long target = (state && channel.state)
+                ? channel.value
+                : espurna::light::ValueMin;
+            channel.target = target;
+
+            const bool added = (path && (target == channel.value))
+                ? _engine.add(channel.current, paths[index])
+                : _engine.add(channel.current, espurna::light::transition::fixed(target));
+            if (added) {
                 delayed = true;
             }
         }
@@ -1712,75 +1768,25 @@ private:
         }
     }
 
-    bool prepare(LightChannel& channel, const LightTransition& transition, bool state) {
-        long target = (state && channel.state)
-            ? channel.value
-            : espurna::light::ValueMin;
-
-        channel.target = target;
-        if (channel.gamma) {
-            target = _lightGammaMap(target);
-        }
-
-        if (channel.inverse) {
-            target = espurna::light::ValueMax - target;
+    static uint32_t steps(const LightTransition& transition) {
+        if (!transition.time.count() || !transition.step.count()
+            || (transition.step >= transition.time))
+        {
+            return 1;
         }
 
-        const float Diff { static_cast<float>(target) - channel.current };
-        if (!isImmediate(transition, Diff)) {
-            pushGradual(transition, channel.current, target, Diff);
-            return true;
-        }
-
-        pushImmediate(channel.current, target, Diff);
-        return false;
-    }
-
-    void push(float& current, long target, float diff, size_t count) {
-        _prepared.push_back(
-            Transition{
-                .value = current,
-                .target = target,
-                .step = diff,
-                .count = count,
-            });
-    }
-
-    void pushImmediate(float& current, long target, float diff) {
-        push(current, target, diff, 1);
-    }
-
-    void pushGradual(const LightTransition& transition, float& current, long target, float diff) {
-        const auto TotalTime = static_cast<float>(transition.time.count());
-        const auto StepTime = static_cast<float>(transition.step.count());
-
-        constexpr float BaseStep { 1.0f };
-        const float Diff { std::abs(diff) };
-        const float Every { TotalTime / Diff };
-
-        float step { (diff > 0.0f) ? BaseStep : -BaseStep };
-        if (Every < StepTime) {
-            step *= (StepTime / Every);
-        }
-
-        const float Count { std::floor(Diff / std::abs(step)) };
-        push(current, target, step, static_cast<size_t>(Count));
-    }
-
-    static bool isImmediate(const LightTransition& transition, float diff) {
-        return !transition.time.count()
-            || (transition.step >= transition.time)
-            || (std::abs(diff) <= std::numeric_limits<float>::epsilon());
+        return transition.time / transition.step;
     }
 
     static LightTransition clamp(LightTransition value) {
         LightTransition out;
         out.time = std::min(value.time, TimeMax);
         out.step = std::min(value.step, TimeMax);
+        out.easing = value.easing;
         return out;
     }
 
-    Transitions _prepared;
+    Engine _engine;
     bool _state_notified { false };
 
     LightTransition _transition;
@@ -1872,23 +1878,51 @@ struct LightProviderHandler {
     void stop() {
         _ready = false;
         _timer.stop();
+        _delay.stop();
     }
 
     void reset() {
         _ready = false;
     }
 
+    // next step is processed in the loop(), which is woken up right away
     void start(Duration duration) {
         _ready = false;
+        _delay.stop();
         _timer.repeat(
             duration,
             [&]() {
                 _ready = true;
+                espurnaLoopWake();
+            });
+    }
+
+    // first step happens after the delay, instead of after the usual step duration
+    void start(Duration duration, Duration delay) {
+        if (!delay.count()) {
+            start(duration);
+            return;
+        }
+
+        _ready = false;
+        _timer.stop();
+        _delay.once(
+            delay,
+            [this, duration]() {
+                _ready = true;
+                espurnaLoopWake();
+                _timer.repeat(
+                    duration,
+                    [&]() {
+                        _ready = true;
+                        espurnaLoopWake();
+                    });
             });
     }
 
 private:
     Timer _timer;
+    Timer _delay;
     bool _ready { false };
 };
 
@@ -1900,13 +1934,92 @@ std::unique_ptr<LightTransitionHandler> _light_transition;
 
 auto _light_transition_time = espurna::light::build::transitionTime();
 auto _light_transition_step = espurna::light::build::transitionStep();
+auto _light_transition_easing = espurna::light::build::transitionEasing();
+auto _light_transition_space = espurna::light::build::transitionSpace();
 bool _light_use_transitions = false;
 
-static_assert((espurna::light::ValueMax - espurna::light::ValueMin) != 0, "");
+// Input values of the last update, which is where the next color transition starts
+struct LightTransitionInputs {
+    espurna::light::transition::Color color;
+    long brightness;
+    long mireds;
+    bool valid;
+};
 
-template <typename T>
-constexpr T _lightValueMap(long value, T min, T max) {
-    return (value - espurna::light::ValueMin) * (max - min) / (espurna::light::ValueMax - espurna::light::ValueMin) + min;
+LightTransitionInputs _light_transition_inputs{};
+
+LightTransitionInputs _lightTransitionInputs() {
+    LightTransitionInputs out{};
+
+    if (_light_state && _light_use_color && (_light_channels.size() >= 3)) {
+        constexpr auto Max = static_cast<float>(espurna::light::ValueMax);
+        out.color.red = static_cast<float>(_light_channels[0].inputValue) / Max;
+        out.color.green = static_cast<float>(_light_channels[1].inputValue) / Max;
+        out.color.blue = static_cast<float>(_light_channels[2].inputValue) / Max;
+    }
+
+    out.brightness = _light_brightness.value();
+    out.mireds = _light_temperature.mireds().value;
+    out.valid = _light_state && (_light_use_color || _light_use_cct);
+
+    return out;
+}
+
+// Instead of ramping every channel separately, interpolate the inputs (color in the selected color space,
+// brightness and temperature linearly) and process them like any other update would, once per every path point.
+// Transition steps simply go through these points, so the step cost remains the same as without the paths
+LightTransitionHandler::Paths _lightTransitionPaths(const LightTransition& transition, const LightTransitionInputs& from, const LightTransitionInputs& to) {
+    using namespace espurna::light::transition;
+
+    LightTransitionHandler::Paths out;
+    if (!from.valid || !to.valid) {
+        return out;
+    }
+
+    if ((_light_transition_space == espurna::light::ColorSpace::Channels)
+        || (transition.step.count() <= 0) || (transition.step >= transition.time))
+    {
+        return out;
+    }
+
+    const auto brightness = _light_brightness;
+    const auto temperature = _light_temperature;
+
+    auto channels = _light_channels;
+    out.resize(channels.size());
+
+    constexpr auto Max = static_cast<float>(espurna::light::ValueMax);
+    constexpr auto Last = Engine::PathPoints - 1;
+
+    // first point is always replaced with the current value
+    for (size_t point = 1; point < Last; ++point) {
+        const auto progress = static_cast<float>(point) / static_cast<float>(Last);
+
+        if (_light_use_color) {
+            const auto color = interpolate(_light_transition_space, from.color, to.color, progress);
+            channels[0] = std::lround(color.red * Max);
+            channels[1] = std::lround(color.green * Max);
+            channels[2] = std::lround(color.blue * Max);
+        }
+
+        _light_brightness = from.brightness + std::lround(static_cast<float>(to.brightness - from.brightness) * progress);
+        _light_temperature = espurna::light::Mireds{
+            .value = from.mireds + std::lround(static_cast<float>(to.mireds - from.mireds) * progress)};
+
+        _light_process_input_values(channels);
+        for (size_t index = 0; index < channels.size(); ++index) {
+            out[index][point] = fixed(channels[index].value);
+        }
+    }
+
+    for (size_t index = 0; index < channels.size(); ++index) {
+        out[index][Last] = fixed(_light_channels[index].value);
+    }
+
+    _light_brightness = brightness;
+    _light_temperature = temperature;
+
+    return out;
 }
 
 #if LIGHT_PROVIDER == LIGHT_PROVIDER_DIMMER
@@ -1919,14 +2032,17 @@ void _lightProviderHandleState(bool) {
 }
 
 // Automatically scale from our value to the internal one used by the PWM
-// Currently, both u32 and float variants are almost the same precision
-// Slight difference would be the amount of generated code; one variant
-// needs to call float division, the other one is to simply truncate it
-// using two external values which are then used in integer divison
-// TODO: actually check call speed?
-// TODO: any difference between __fixsfsi and lround?
-void _lightProviderHandleValue(size_t channel, float value) {
-    pwmDuty(channel, _lightValueMap(value, _light_pwm_min, _light_pwm_max));
+uint32_t _lightProviderOutput(size_t channel, espurna::light::transition::Fixed value) {
+    return _lightOutputValue(
+        _light_channels[channel], value, _light_pwm_min, _light_pwm_max);
+}
+
+void _lightProviderCommit(size_t channel, uint32_t value) {
+    pwmDuty(channel, value);
+}
+
+void _lightProviderHandleValue(size_t channel, espurna::light::transition::Fixed value) {
+    _lightProviderCommit(channel, _lightProviderOutput(channel, value));
 }
 
 void _lightProviderHandleUpdate() {
@@ -1956,10 +2072,17 @@ constexpr unsigned int _my92xx_value_min = 0;
 constexpr unsigned int _my92xx_value_max =
         _lightMy92xxValueMax(espurna::light::build::my92xxCommand());
 
-void _lightProviderHandleValue(size_t channel, float value) {
-    _my92xx->setChannel(
-        _light_my92xx_channel_map[channel],
-        _lightValueMap(value, _my92xx_value_min, _my92xx_value_max));
+uint32_t _lightProviderOutput(size_t channel, espurna::light::transition::Fixed value) {
+    return _lightOutputValue(
+        _light_channels[channel], value, _my92xx_value_min, _my92xx_value_max);
+}
+
+void _lightProviderCommit(size_t channel, uint32_t value) {
+    _my92xx->setChannel(_light_my92xx_channel_map[channel], value);
+}
+
+void _lightProviderHandleValue(size_t channel, espurna::light::transition::Fixed value) {
+    _lightProviderCommit(channel, _lightProviderOutput(channel, value));
 }
 
 void _lightProviderHandleUpdate() {
@@ -1976,8 +2099,13 @@ void _lightProviderHandleState(bool state) {
     _light_provider->state(state);
 }
 
-void _lightProviderHandleValue(size_t channel, float value) {
-    _light_provider->channel(channel, value);
+// custom providers still expect [ValueMin:ValueMax], but it no longer needs to be an integer
+void _lightProviderHandleValue(size_t channel, espurna::light::transition::Fixed value) {
+    constexpr auto Unit = espurna::light::curve::Unit;
+    const auto out = _lightOutputValue(_light_channels[channel], value, 0, Unit);
+    _light_provider->channel(channel,
+        espurna::light::ValueMin
+            + (static_cast<float>(out) * (espurna::light::ValueMax - espurna::light::ValueMin) / Unit));
 }
 
 void _lightProviderHandleUpdate() {
@@ -1986,6 +2114,201 @@ void _lightProviderHandleUpdate() {
 
 #endif
 
+#if LIGHT_OUTPUT_STAGE_SUPPORT
+
+// Transition steps are prepared in the loop() ahead of time, as complete output frames.
+// Frames are sent to the provider from the SDK timer at the transition step rate, so
+// a loop() that is occasionally slower than the step no longer stalls the output.
+// SDK timer callbacks never interrupt the loop(), ring does not need any locking
+class LightOutputStage {
+public:
+    static constexpr size_t Frames { LIGHT_OUTPUT_STAGE_FRAMES };
+
+    using Fixed = espurna::light::transition::Fixed;
+    using Duration = espurna::duration::Milliseconds;
+
+    struct Frame {
+        std::array<Fixed, espurna::light::ChannelsMax> current;
+        std::array<uint32_t, espurna::light::ChannelsMax> values;
+        uint8_t channels;
+        bool state;
+        bool state_changed;
+        bool last;
+    };
+
+    struct Stats {
+        uint32_t committed;
+        uint32_t late;
+        uint32_t late_max;
+        uint32_t dropped;
+    };
+
+    bool full() const {
+        return _frames.full();
+    }
+
+    size_t pending() const {
+        return _frames.size();
+    }
+
+    const Stats& stats() const {
+        return _stats;
+    }
+
+    // Producer fills the frame and then push()es it into the ring. Channel values are carried over
+    // from the previous frame, since transition only reports the ones that are still changing
+    Frame& next() {
+        auto& out = _frames.next();
+        out.state_changed = false;
+        out.last = false;
+        return out;
+    }
+
+    void push() {
+        _frames.push();
+    }
+
+    // Timer keeps running when the step did not change, so that frequent updates do not postpone the output
+    void start(Duration step) {
+        if (_armed && (step == _step)) {
+            return;
+        }
+
+        stop();
+        os_timer_setfn(&_timer, commit, this);
+        os_timer_arm(&_timer, step.count(), true);
+
+        _armed = true;
+        _step = step;
+    }
+
+    // first frame is sent after the delay, instead of after the usual step duration
+    void start(Duration step, Duration delay) {
+        if (!delay.count()) {
+            start(step);
+            return;
+        }
+
+        stop();
+        os_timer_setfn(&_timer, commit_delayed, this);
+        os_timer_arm(&_timer, delay.count(), false);
+
+        _armed = true;
+        _step = step;
+    }
+
+    void stop() {
+        if (_armed) {
+            os_timer_disarm(&_timer);
+            _armed = false;
+        }
+    }
+
+    // Drop everything that was not sent to the provider yet. Transition that replaces
+    // the current one should start from the values that are actually on the output
+    void flush(LightChannels& channels) {
+        _stats.dropped += _frames.clear();
+        _late = 0;
+
+        for (size_t index = 0; index < channels.size(); ++index) {
+            channels[index].current = _committed[index];
+        }
+    }
+
+private:
+    static void commit(void* arg) {
+        reinterpret_cast<LightOutputStage*>(arg)->commit();
+    }
+
+    static void commit_delayed(void* arg) {
+        auto* stage = reinterpret_cast<LightOutputStage*>(arg);
+        os_timer_disarm(&stage->_timer);
+        os_timer_setfn(&stage->_timer, commit, stage);
+        os_timer_arm(&stage->_timer, stage->_step.count(), true);
+        stage->commit();
+    }
+
+    void commit() {
+        if (!_frames.size()) {
+            ++_late;
+            ++_stats.late;
+            _stats.late_max = std::max(_stats.late_max, _late);
+            return;
+        }
+
+        const auto& frame = _frames.pop();
+
+        _late = 0;
+        ++_stats.committed;
+
+        if (frame.state_changed && frame.state) {
+            _lightProviderHandleState(true);
+        }
+
+        for (size_t index = 0; index < frame.channels; ++index) {
+            _lightProviderCommit(index, frame.values[index]);
+            _committed[index] = frame.current[index];
+        }
+
+        _lightProviderHandleUpdate();
+
+        if (frame.state_changed && !frame.state) {
+            _lightProviderHandleState(false);
+        }
+
+        if (frame.last && !_frames.size()) {
+            stop();
+        }
+
+        // loop() refills the ring with the next frames of the transition
+        if (!frame.last) {
+            espurnaLoopWake();
+        }
+    }
+
+    espurna::light::transition::FrameRing<Frame, Frames> _frames;
+
+    std::array<Fixed, espurna::light::ChannelsMax> _committed{};
+    uint32_t _late { 0 };
+    Stats _stats{};
+
+    os_timer_t _timer{};
+    Duration _step{};
+    bool _armed { false };
+};
+
+constexpr size_t LightOutputStage::Frames;
+
+LightOutputStage _light_output_stage;
+
+void _lightProviderUpdate() {
+    while (_light_transition && !_light_output_stage.full()) {
+        auto& frame = _light_output_stage.next();
+        frame.channels = _light_channels.size();
+
+        const auto next = _light_transition->run(
+            [&](bool state) {
+                frame.state = state;
+                frame.state_changed = true;
+            },
+            [&](size_t channel, espurna::light::transition::Fixed value) {
+                frame.current[channel] = value;
+                frame.values[channel] = _lightProviderOutput(channel, value);
+            },
+            []() {
+            });
+
+        frame.last = !next;
+        _light_output_stage.push();
+
+        if (!next) {
+            _light_transition.reset(nullptr);
+        }
+    }
+}
+
+#else
+
 void _lightProviderUpdate() {
     if (!_light_provider_update) {
         return;
@@ -2009,6 +2332,8 @@ void _lightProviderUpdate() {
     _light_provider_update.reset();
 }
 
+#endif
+
 } // namespace
 
 // -----------------------------------------------------------------------------
@@ -2199,12 +2524,35 @@ bool _lightTryParseChannel(espurna::StringView value, size_t& id) {
 
 namespace {
 
+// <TIME>[,<EASING>], where easing is one of the `ltEase` setting values
 bool _lightApiTransition(espurna::StringView payload) {
+    auto easing = _light_transition_easing;
+
+    // unlike settings, unknown easing name does not fall back to the default one
+    const auto split = std::find(payload.begin(), payload.end(), ',');
+    if (split != payload.end()) {
+        const auto name = espurna::StringView(split + 1, payload.end());
+
+        const auto& options = espurna::light::settings::options::EasingOptions;
+        const auto it = std::find_if(std::begin(options), std::end(options),
+            [&](const espurna::settings::options::Enumeration<espurna::light::Easing>& option) {
+                return option == name;
+            });
+        if (it == std::end(options)) {
+            return false;
+        }
+
+        easing = (*it).value();
+        payload = espurna::StringView(payload.begin(), split);
+    }
+
     const auto result = parseUnsigned(payload, 10);
     if (result.ok) {
-        lightTransition(
-                espurna::duration::Milliseconds(result.value),
-                _light_transition_step);
+        lightTransition(LightTransition{
+            .time = espurna::duration::Milliseconds(result.value),
+            .step = _light_transition_step,
+            .easing = easing,
+        });
         return true;
     }
 
@@ -2559,6 +2907,15 @@ void _lightWebSocketStatus(JsonObject& root) {
     light["state"] = _light_state;
 }
 
+void _lightWebSocketBinary(espurna::web::ws::binary::Writer& out) {
+    out.header(espurna::web::ws::binary::Type::Light, _light_channels.size());
+    out.u8(_light_state ? 1 : 0);
+    out.u16(_light_brightness.value());
+    for (auto& channel : _light_channels) {
+        out.u16(channel.inputValue);
+    }
+}
+
 void _lightWebSocketOnVisible(JsonObject& root) {
     wsPayloadModule(root, PrefixLightLong);
 
@@ -2593,6 +2950,8 @@ void _lightWebSocketOnConnected(JsonObject& root) {
     root["ltSaveDelay"] = _light_save_delay.count();
     root["ltTime"] = _light_transition_time.count();
     root["ltStep"] = _light_transition_step.count();
+    root["ltEase"] = espurna::settings::internal::serialize(_light_transition_easing);
+    root["ltSpace"] = espurna::settings::internal::serialize(_light_transition_space);
 }
 
 void _lightWebSocketOnAction(uint32_t client_id, const char* action, JsonObject& data) {
@@ -2650,8 +3009,12 @@ void _lightWebSocketOnAction(uint32_t client_id, const char* action, JsonObject&
         }
     }
 
+    // values could've been adjusted or ignored, and the update does not report anything
+    // when nothing changed. make sure client sees the actual ones
     if (update) {
         lightUpdate();
+        wsResync(client_id, PrefixLightLong);
+        wsPostUpdate(PrefixLightLong, _lightWebSocketStatus);
     }
 }
 
@@ -2792,6 +3155,14 @@ static void _lightCommand(::terminal::CommandContext&& ctx) {
 
     ctx.output.printf_P(PSTR("%s\n"),
         _light_state ? PSTR("ON") : PSTR("OFF"));
+
+#if LIGHT_OUTPUT_STAGE_SUPPORT
+    const auto& stats = _light_output_stage.stats();
+    ctx.output.printf_P(PSTR("frames: %zu queued, %u committed, %u late (max %u in a row), %u dropped\n"),
+        _light_output_stage.pending(), stats.committed,
+        stats.late, stats.late_max, stats.dropped);
+#endif
+
     terminalOK(ctx);
 }
 
@@ -2822,7 +3193,7 @@ static void _lightCommandChannel(::terminal::CommandContext&& ctx) {
                 _light_channels[channel].inputValue,
                 _light_channels[channel].value,
                 _light_channels[channel].target,
-                String(_light_channels[channel].current, 2).c_str());
+                String(espurna::light::transition::to_float(_light_channels[channel].current), 2).c_str());
     };
 
     if (ctx.argv.size() > 2) {
@@ -3001,7 +3372,7 @@ void _lightReport(int report) {
 
 #if WEB_SUPPORT
     if (report & espurna::light::Report::Web) {
-        wsPost(_lightWebSocketStatus);
+        wsPostUpdate(PrefixLightLong, _lightWebSocketStatus);
     }
 #endif
 
@@ -3020,11 +3391,15 @@ void _lightUpdateDebug(const LightTransitionHandler& handler) {
                 Time.count(), Step.count());
     }
 
-    for (auto& transition : handler.prepared()) {
-        if (transition.count > 1) {
-            DEBUG_MSG_P(PSTR("[LIGHT] Transition from %s to %ld (step %s, %u times)\n"),
-                    String(transition.value, 2).c_str(), transition.target,
-                    String(transition.step, 2).c_str(), transition.count);
+    using espurna::light::transition::to_float;
+
+    const auto& engine = handler.engine();
+    for (auto& ramp : engine.ramps()) {
+        if (!ramp.immediate) {
+            DEBUG_MSG_P(PSTR("[LIGHT] Transition from %s to %s (%u steps)\n"),
+                    String(to_float(ramp.from), 2).c_str(),
+                    String(to_float(ramp.target), 2).c_str(),
+                    engine.steps());
         }
     }
 }
@@ -3061,7 +3436,32 @@ private:
     size_t _last_size { 0 };
 };
 
+#if GROUP_SYNC_SUPPORT
+espurna::duration::Milliseconds _lightGroupSync(const LightTransition& transition) {
+    espurna::group_sync::Light out{};
+
+    out.state = _light_state;
+    out.brightness = _light_brightness.value();
+    out.channels = std::min(_light_channels.size(), out.values.size());
+    for (size_t index = 0; index < out.channels; ++index) {
+        out.values[index] = _light_channels[index].inputValue;
+    }
+
+    out.mireds = _light_temperature.mireds().value;
+    out.time = transition.time.count();
+    out.step = transition.step.count();
+
+    return groupSyncLight(out);
+}
+#endif
+
 void _lightSequenceCheck() {
+#if LIGHT_OUTPUT_STAGE_SUPPORT
+    if (_light_output_stage.pending()) {
+        return;
+    }
+#endif
+
     if (!_light_update && !_light_transition) {
         _light_sequence.run();
     }
@@ -3093,10 +3493,30 @@ void _lightUpdate() {
 
     _light_state_changed = false;
     _light_update.run([](LightTransition transition, int report, bool save) {
+#if LIGHT_OUTPUT_STAGE_SUPPORT
+        _light_output_stage.flush(_light_channels);
+#endif
+
+        const auto inputs = _lightTransitionInputs();
+        const auto paths = _lightTransitionPaths(transition, _light_transition_inputs, inputs);
+        _light_transition_inputs = inputs;
+
+        // Devices in the group apply the same state after a short delay, this one waits for them as well
+        auto delay = espurna::duration::Milliseconds::zero();
+#if GROUP_SYNC_SUPPORT
+        if (report & espurna::light::Report::Group) {
+            delay = _lightGroupSync(transition);
+        }
+#endif
+
         // Channel output values will be set by the handler class and the specified provider
         // We either set the values immediately or schedule an ongoing transition
-        _light_transition = std::make_unique<LightTransitionHandler>(_light_channels, transition, _light_state);
-        _light_provider_update.start(_light_transition->step());
+        _light_transition = std::make_unique<LightTransitionHandler>(_light_channels, transition, _light_state, paths);
+#if LIGHT_OUTPUT_STAGE_SUPPORT
+        _light_output_stage.start(_light_transition->step(), delay);
+#else
+        _light_provider_update.start(_light_transition->step(), delay);
+#endif
         _lightUpdateDebug(*_light_transition);
 
         // Send current state to all available 'report' targets
@@ -3337,33 +3757,39 @@ espurna::duration::Milliseconds lightTransitionStep() {
         : espurna::duration::Milliseconds(0);
 }
 
+espurna::light::Easing lightTransitionEasing() {
+    return _light_transition_easing;
+}
+
 LightTransition lightTransition() {
-    return {lightTransitionTime(), lightTransitionStep()};
+    return {lightTransitionTime(), lightTransitionStep(), lightTransitionEasing()};
 }
 
 void lightTransition(espurna::duration::Milliseconds time, espurna::duration::Milliseconds step) {
+    lightTransition({time, step, _light_transition_easing});
+}
+
+void lightTransition(LightTransition transition) {
     bool save { false };
 
-    _light_use_transitions = (time.count() > 0) && (step.count() > 0);
+    _light_use_transitions = (transition.time.count() > 0) && (transition.step.count() > 0);
     if (_light_use_transitions) {
         save = true;
-        _light_transition_time = time;
-        _light_transition_step = step;
+        _light_transition_time = transition.time;
+        _light_transition_step = transition.step;
+        _light_transition_easing = transition.easing;
     }
 
     espurna::light::settings::transition(_light_use_transitions);
     if (save) {
         espurna::light::settings::transitionTime(_light_transition_time);
         espurna::light::settings::transitionStep(_light_transition_step);
+        espurna::light::settings::transitionEasing(_light_transition_easing);
     }
 
     saveSettings();
 }
 
-void lightTransition(LightTransition transition) {
-    lightTransition(transition.time, transition.step);
-}
-
 // -----------------------------------------------------------------------------
 // SETUP
 // -----------------------------------------------------------------------------
@@ -3422,6 +3848,8 @@ void _lightConfigure() {
     _light_use_transitions = espurna::light::settings::transition();
     _light_transition_time = espurna::light::settings::transitionTime();
     _light_transition_step = espurna::light::settings::transitionStep();
+    _light_transition_easing = espurna::light::settings::transitionEasing();
+    _light_transition_space = espurna::light::settings::transitionSpace();
 
     _light_save = espurna::light::settings::save();
     _light_save_delay = espurna::light::settings::saveDelay();
@@ -3458,6 +3886,11 @@ void _lightConfigure() {
 void _lightSleepSetup() {
     systemBeforeSleep(
         []() {
+#if LIGHT_OUTPUT_STAGE_SUPPORT
+            _light_output_stage.stop();
+            _light_output_stage.flush(_light_channels);
+#endif
+
             size_t id = 0;
             for (auto& channel : _light_channels) {
                 _lightProviderHandleValue(id, 0);
@@ -3664,7 +4097,8 @@ void lightSetup() {
             .onConnected(_lightWebSocketOnConnected)
             .onData(_lightWebSocketStatus)
             .onAction(_lightWebSocketOnAction)
-            .onKeyCheck(_lightWebSocketOnKeyCheck);
+            .onKeyCheck(_lightWebSocketOnKeyCheck)
+            .onBinary(PrefixLightLong, _lightWebSocketBinary);
     #endif
 
     #if API_SUPPORT
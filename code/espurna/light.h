@@ -5,6 +5,7 @@
 #pragma once
 
 #include "espurna.h"
+#include "light_transition.h"
 
 #define MQTT_TOPIC_LIGHT            "light"
 #define MQTT_TOPIC_LIGHT_JSON       "light_json"
@@ -43,8 +44,9 @@ struct Report {
     static constexpr int Web = 1 << 0;
     static constexpr int Mqtt = 1 << 1;
     static constexpr int MqttGroup = 1 << 2;
+    static constexpr int Group = 1 << 3;
 
-    static constexpr int Default { Web | Mqtt | MqttGroup };
+    static constexpr int Default { Web | Mqtt | MqttGroup | Group };
 };
 
 struct Hsv {
@@ -182,6 +184,7 @@ public:
 struct LightTransition {
     espurna::duration::Milliseconds time;
     espurna::duration::Milliseconds step;
+    espurna::light::Easing easing { espurna::light::Easing::Linear };
 };
 
 size_t lightChannels();
@@ -190,6 +193,7 @@ LightTransition lightTransition();
 
 espurna::duration::Milliseconds lightTransitionTime();
 espurna::duration::Milliseconds lightTransitionStep();
+espurna::light::Easing lightTransitionEasing();
 
 // Transition from current state to the previously prepared one
 // (using any of functions declared down below which modify global state, channel values or their state)
@@ -0,0 +1,55 @@
+/*
+
+Part of the LIGHT MODULE
+
+Copyright (C) 2021 by Maxim Prokhorov <prokhorov dot max at outlook dot com>
+
+*/
+
+#include <algorithm>
+
+#include "light_curve.h"
+
+namespace espurna {
+namespace light {
+namespace curve {
+namespace {
+
+constexpr uint64_t Half { Unit / 2 };
+
+// L* <= 8 is the linear part of the curve, both parts meet at Y ~= 0.008856
+constexpr uint32_t LinearMax { (Unit * 8) / 100 };
+
+} // namespace
+
+uint32_t linear(uint32_t input, uint32_t max) {
+    input = std::min(input, Unit);
+    return (static_cast<uint64_t>(input) * max + Half) >> UnitBits;
+}
+
+// Y = L* / 903.3, when L* <= 8
+// Y = ((L* + 16) / 116) ^ 3, otherwise
+// (where L* is [0:100] and Y is [0.0:1.0])
+uint32_t cie1931(uint32_t input, uint32_t max) {
+    input = std::min(input, Unit);
+
+    if (input <= LinearMax) {
+        constexpr uint64_t Divisor { uint64_t{ 9033 } << UnitBits };
+        return (static_cast<uint64_t>(input) * max * 1000 + (Divisor / 2)) / Divisor;
+    }
+
+    // t is calculated as Q20, since rounding errors are multiplied when it is cubed
+    // t^3 is Q60 and would not fit, so it is reduced to Q40 and then to Q32
+    constexpr uint32_t Bits { 20 };
+    constexpr uint32_t Shift { Bits - UnitBits };
+
+    const uint64_t t { ((static_cast<uint64_t>(input) << Shift) * 100 + (uint64_t{ 16 } << Bits) + 58) / 116 };
+    const uint64_t t2 { (t * t + (uint64_t{ 1 } << (Bits - 1))) >> Bits };
+    const uint64_t y { ((t2 * t) + (uint64_t{ 1 } << 7)) >> 8 };
+
+    return (y * max + (uint64_t{ 1 } << 31)) >> 32;
+}
+
+} // namespace curve
+} // namespace light
+} // namespace espurna
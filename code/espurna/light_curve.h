@@ -0,0 +1,29 @@
+/*
+
+Part of the LIGHT MODULE
+
+Copyright (C) 2021 by Maxim Prokhorov <prokhorov dot max at outlook dot com>
+
+*/
+
+#pragma once
+
+#include <cstdint>
+
+namespace espurna {
+namespace light {
+namespace curve {
+
+// Curve input is a Q16 fixed point value, [0:Unit] is [0.0:1.0]
+constexpr uint32_t UnitBits { 16 };
+constexpr uint32_t Unit { uint32_t{ 1 } << UnitBits };
+
+// Output is scaled to [0:max], which is expected to be the native resolution of the provider
+uint32_t linear(uint32_t input, uint32_t max);
+
+// Perceived lightness (CIE 1931 L*) to relative luminance (Y)
+uint32_t cie1931(uint32_t input, uint32_t max);
+
+} // namespace curve
+} // namespace light
+} // namespace espurna
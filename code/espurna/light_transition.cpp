@@ -0,0 +1,352 @@
+/*
+
+Part of the LIGHT MODULE
+
+Copyright (C) 2021 by Maxim Prokhorov <prokhorov dot max at outlook dot com>
+
+*/
+
+#include <algorithm>
+
+#include "light_transition.h"
+#include "libs/fs_math.h"
+
+namespace espurna {
+namespace light {
+namespace transition {
+namespace {
+
+constexpr uint32_t Unit { static_cast<uint32_t>(One) };
+
+// 2^(n/16) for n in [0:16], Q16
+constexpr uint32_t Exp2[] {
+    65536, 68438, 71468, 74632, 77936, 81386, 84990, 88752,
+    92682, 96785, 101070, 105545, 110218, 115098, 120194, 125515,
+    131072,
+};
+
+// 2^x for x in [0:10], Q16. Fractional part is interpolated between the table entries
+uint32_t exp2(uint32_t value) {
+    const auto integer = value >> FractionBits;
+    const auto fraction = value & (Unit - 1);
+
+    const auto index = fraction >> 12;
+    const auto rest = fraction & 0xfff;
+
+    const auto lower = Exp2[index];
+    const auto upper = Exp2[index + 1];
+
+    return (lower + (((upper - lower) * rest) >> 12)) << integer;
+}
+
+// p^2 * (3 - 2p)
+uint32_t in_out(uint32_t progress) {
+    const uint64_t square { static_cast<uint64_t>(progress) * progress };
+    return (square * (3 * Unit - 2 * progress)) >> (FractionBits * 2);
+}
+
+// (2^(10p) - 1) / (2^10 - 1)
+uint32_t exponential(uint32_t progress) {
+    return (exp2(progress * 10) - Unit) / 1023;
+}
+
+// Channel values are expected to be gamma-encoded, color spaces below work with linear light
+
+float to_linear(float value) {
+    return (value > 0.0f)
+        ? static_cast<float>(fs_pow(value, 2.2))
+        : 0.0f;
+}
+
+float from_linear(float value) {
+    return (value > 0.0f)
+        ? static_cast<float>(fs_pow(value, 1.0 / 2.2))
+        : 0.0f;
+}
+
+float cbrt(float value) {
+    if (value > 0.0f) {
+        return static_cast<float>(fs_pow(value, 1.0 / 3.0));
+    }
+
+    if (value < 0.0f) {
+        return -static_cast<float>(fs_pow(-value, 1.0 / 3.0));
+    }
+
+    return 0.0f;
+}
+
+float lerp(float from, float to, float progress) {
+    return from + (to - from) * progress;
+}
+
+Color lerp(Color from, Color to, float progress) {
+    return Color{
+        .red = lerp(from.red, to.red, progress),
+        .green = lerp(from.green, to.green, progress),
+        .blue = lerp(from.blue, to.blue, progress),
+    };
+}
+
+float clamp(float value) {
+    return std::clamp(value, 0.0f, 1.0f);
+}
+
+namespace hsv {
+
+// Hue is in [0.0:6.0) sectors instead of degrees
+struct Value {
+    float hue;
+    float saturation;
+    float value;
+};
+
+Value from(Color color) {
+    const auto max = std::max({color.red, color.green, color.blue});
+    const auto min = std::min({color.red, color.green, color.blue});
+    const auto delta = max - min;
+
+    Value out{
+        .hue = 0.0f,
+        .saturation = (max > 0.0f) ? (delta / max) : 0.0f,
+        .value = max,
+    };
+
+    if (delta > 0.0f) {
+        if (max == color.red) {
+            out.hue = (color.green - color.blue) / delta;
+        } else if (max == color.green) {
+            out.hue = 2.0f + (color.blue - color.red) / delta;
+        } else {
+            out.hue = 4.0f + (color.red - color.green) / delta;
+        }
+
+        if (out.hue < 0.0f) {
+            out.hue += 6.0f;
+        }
+    }
+
+    return out;
+}
+
+Color to(Value value) {
+    const auto sector = static_cast<int>(value.hue);
+    const auto fraction = value.hue - static_cast<float>(sector);
+
+    const auto p = value.value * (1.0f - value.saturation);
+    const auto q = value.value * (1.0f - value.saturation * fraction);
+    const auto t = value.value * (1.0f - value.saturation * (1.0f - fraction));
+
+    switch (sector % 6) {
+    case 0:
+        return Color{value.value, t, p};
+    case 1:
+        return Color{q, value.value, p};
+    case 2:
+        return Color{p, value.value, t};
+    case 3:
+        return Color{p, q, value.value};
+    case 4:
+        return Color{t, p, value.value};
+    }
+
+    return Color{value.value, p, q};
+}
+
+// Hue goes through the shortest arc. When either side has no saturation, its hue is meaningless
+// and the other one is used instead, so that fading from white or black does not rotate through the wheel
+Color interpolate(Color from, Color to, float progress) {
+    auto lhs = hsv::from(from);
+    auto rhs = hsv::from(to);
+
+    if (lhs.saturation <= 0.0f) {
+        lhs.hue = rhs.hue;
+    } else if (rhs.saturation <= 0.0f) {
+        rhs.hue = lhs.hue;
+    }
+
+    auto delta = rhs.hue - lhs.hue;
+    if (delta > 3.0f) {
+        delta -= 6.0f;
+    } else if (delta < -3.0f) {
+        delta += 6.0f;
+    }
+
+    auto hue = lhs.hue + delta * progress;
+    if (hue < 0.0f) {
+        hue += 6.0f;
+    } else if (hue >= 6.0f) {
+        hue -= 6.0f;
+    }
+
+    return hsv::to(Value{
+        .hue = hue,
+        .saturation = lerp(lhs.saturation, rhs.saturation, progress),
+        .value = lerp(lhs.value, rhs.value, progress),
+    });
+}
+
+} // namespace hsv
+
+// https://bottosson.github.io/posts/oklab/
+namespace oklab {
+
+struct Value {
+    float l;
+    float a;
+    float b;
+};
+
+Value from(Color color) {
+    const auto red = to_linear(color.red);
+    const auto green = to_linear(color.green);
+    const auto blue = to_linear(color.blue);
+
+    const auto l = cbrt(0.4122214708f * red + 0.5363325363f * green + 0.0514459929f * blue);
+    const auto m = cbrt(0.2119034982f * red + 0.6806995451f * green + 0.1073969566f * blue);
+    const auto s = cbrt(0.0883024619f * red + 0.2817188376f * green + 0.6299787005f * blue);
+
+    return Value{
+        .l = 0.2104542553f * l + 0.7936177850f * m - 0.0040720468f * s,
+        .a = 1.9779984951f * l - 2.4285922050f * m + 0.4505937099f * s,
+        .b = 0.0259040371f * l + 0.7827717662f * m - 0.8086757660f * s,
+    };
+}
+
+Color to(Value value) {
+    const auto l = value.l + 0.3963377774f * value.a + 0.2158037573f * value.b;
+    const auto m = value.l - 0.1055613458f * value.a - 0.0638541728f * value.b;
+    const auto s = value.l - 0.0894841775f * value.a - 1.2914855480f * value.b;
+
+    const auto l3 = l * l * l;
+    const auto m3 = m * m * m;
+    const auto s3 = s * s * s;
+
+    return Color{
+        .red = from_linear(clamp(4.0767416621f * l3 - 3.3077115913f * m3 + 0.2309699292f * s3)),
+        .green = from_linear(clamp(-1.2684380046f * l3 + 2.6097574011f * m3 - 0.3413193965f * s3)),
+        .blue = from_linear(clamp(-0.0041960863f * l3 - 0.7034186147f * m3 + 1.7076147010f * s3)),
+    };
+}
+
+Color interpolate(Color from, Color to, float progress) {
+    const auto lhs = oklab::from(from);
+    const auto rhs = oklab::from(to);
+
+    return oklab::to(Value{
+        .l = lerp(lhs.l, rhs.l, progress),
+        .a = lerp(lhs.a, rhs.a, progress),
+        .b = lerp(lhs.b, rhs.b, progress),
+    });
+}
+
+} // namespace oklab
+
+} // namespace
+
+Color interpolate(ColorSpace space, Color from, Color to, float progress) {
+    if (progress <= 0.0f) {
+        return from;
+    }
+
+    if (progress >= 1.0f) {
+        return to;
+    }
+
+    switch (space) {
+    case ColorSpace::Channels:
+        break;
+    case ColorSpace::Hsv:
+        return hsv::interpolate(from, to, progress);
+    case ColorSpace::Oklab:
+        return oklab::interpolate(from, to, progress);
+    }
+
+    return lerp(from, to, progress);
+}
+
+uint32_t ease(Easing easing, uint32_t progress) {
+    progress = std::min(progress, Unit);
+
+    switch (easing) {
+    case Easing::Linear:
+        break;
+    case Easing::InOut:
+        return in_out(progress);
+    case Easing::Exponential:
+        return exponential(progress);
+    }
+
+    return progress;
+}
+
+void Engine::reset(Easing easing, uint32_t steps) {
+    _ramps.clear();
+    _paths.clear();
+    _gradual = false;
+
+    _easing = easing;
+    _steps = std::max(steps, uint32_t{ 1 });
+    _step = 0;
+
+    _progress = 0;
+    _increment = Unit / _steps;
+    _remainder = Unit % _steps;
+    _error = 0;
+}
+
+bool Engine::add(Fixed& value, Fixed target) {
+    const bool immediate { (_steps <= 1) || (value == target) };
+    _ramps.push_back(
+        Ramp{
+            .value = &value,
+            .from = value,
+            .delta = target - value,
+            .target = target,
+            .path = NoPath,
+            .immediate = immediate,
+            .done = false,
+        });
+
+    if (!immediate) {
+        _gradual = true;
+    }
+
+    return !immediate;
+}
+
+bool Engine::add(Fixed& value, const Path& path) {
+    const auto target = path.back();
+    if ((_steps <= 1) || (_paths.size() >= NoPath)) {
+        return add(value, target);
+    }
+
+    const auto same = std::all_of(path.begin() + 1, path.end(),
+        [&](Fixed point) {
+            return point == value;
+        });
+    if (same) {
+        return add(value, target);
+    }
+
+    _paths.push_back(path);
+    _paths.back().front() = value;
+
+    _ramps.push_back(
+        Ramp{
+            .value = &value,
+            .from = value,
+            .delta = target - value,
+            .target = target,
+            .path = static_cast<uint8_t>(_paths.size() - 1),
+            .immediate = false,
+            .done = false,
+        });
+
+    _gradual = true;
+    return true;
+}
+
+} // namespace transition
+} // namespace light
+} // namespace espurna
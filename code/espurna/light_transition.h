@@ -0,0 +1,232 @@
+/*
+
+Part of the LIGHT MODULE
+
+Copyright (C) 2021 by Maxim Prokhorov <prokhorov dot max at outlook dot com>
+
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace espurna {
+namespace light {
+
+enum class Easing {
+    Linear,
+    InOut,
+    Exponential,
+};
+
+// How color changes are interpolated, independently for each channel
+// or through one of the color spaces and then converted back to channel values
+enum class ColorSpace {
+    Channels,
+    Hsv,
+    Oklab,
+};
+
+namespace transition {
+
+// Channel values are Q16.16 fixed point numbers
+using Fixed = int32_t;
+
+constexpr int32_t FractionBits { 16 };
+constexpr Fixed One { Fixed{ 1 } << FractionBits };
+
+constexpr Fixed fixed(long value) {
+    return static_cast<Fixed>(value * One);
+}
+
+constexpr float to_float(Fixed value) {
+    return static_cast<float>(value) / static_cast<float>(One);
+}
+
+// Progress is a Q16 value, [0:One] is [0.0:1.0]
+uint32_t ease(Easing, uint32_t progress);
+
+// Every component is [0.0:1.0]
+struct Color {
+    float red;
+    float green;
+    float blue;
+};
+
+// Color at the specified progress ([0.0:1.0]) between two colors
+Color interpolate(ColorSpace, Color from, Color to, float progress);
+
+// Every channel shares the same number of steps, which is why all of them
+// finish on the same tick. Progress is advanced once per step and without
+// any division, every channel then only needs a single multiplication.
+class Engine {
+public:
+    static constexpr uint8_t NoPath { 0xff };
+
+    struct Ramp {
+        Fixed* value;
+        Fixed from;
+        Fixed delta;
+        Fixed target;
+        uint8_t path;
+        bool immediate;
+        bool done;
+    };
+
+    using Ramps = std::vector<Ramp>;
+
+    // Instead of a straight line between the current value and the target, ramp can also go through
+    // a number of points evenly spaced over the eased progress. First point is replaced with the current
+    // value, last one is the target. Points are prepared beforehand, so the step cost remains the same
+    static constexpr size_t PathPoints { 9 };
+    using Path = std::array<Fixed, PathPoints>;
+    using Paths = std::vector<Path>;
+
+    Engine() = default;
+    Engine(Easing easing, uint32_t steps) {
+        reset(easing, steps);
+    }
+
+    void reset(Easing easing, uint32_t steps);
+
+    // Returns `true` when value is going to be changed gradually, `false` when target is set on the first step
+    bool add(Fixed& value, Fixed target);
+    bool add(Fixed& value, const Path& path);
+
+    // Advance every ramp and notify about the changed values, `callback(size_t index, Fixed value)`
+    // Returns `true` while there are more steps left
+    template <typename T>
+    bool run(T&& callback) {
+        if (_step >= _steps) {
+            return false;
+        }
+
+        ++_step;
+        const bool last { _step == _steps };
+
+        _progress += _increment;
+        _error += _remainder;
+        if (_error >= _steps) {
+            _error -= _steps;
+            ++_progress;
+        }
+
+        const auto eased = ease(_easing, last ? One : _progress);
+
+        for (size_t index = 0; index < _ramps.size(); ++index) {
+            auto& ramp = _ramps[index];
+            if (ramp.done) {
+                continue;
+            }
+
+            if (ramp.immediate || last) {
+                *ramp.value = ramp.target;
+                ramp.done = true;
+            } else if (ramp.path != NoPath) {
+                *ramp.value = along(_paths[ramp.path], eased);
+            } else {
+                *ramp.value = ramp.from
+                    + static_cast<Fixed>((static_cast<int64_t>(ramp.delta) * eased) / One);
+            }
+
+            callback(index, *ramp.value);
+        }
+
+        return _gradual && !last;
+    }
+
+    const Ramps& ramps() const {
+        return _ramps;
+    }
+
+    Easing easing() const {
+        return _easing;
+    }
+
+    uint32_t steps() const {
+        return _steps;
+    }
+
+    uint32_t step() const {
+        return _step;
+    }
+
+private:
+    static Fixed along(const Path& path, uint32_t progress) {
+        const auto position = static_cast<uint32_t>(progress * (PathPoints - 1));
+        const auto index = std::min<size_t>(position >> FractionBits, PathPoints - 2);
+        const auto rest = static_cast<uint32_t>(position - (index << FractionBits));
+
+        return path[index] + static_cast<Fixed>(
+            (static_cast<int64_t>(path[index + 1] - path[index]) * rest) / One);
+    }
+
+    Ramps _ramps;
+    Paths _paths;
+    bool _gradual { false };
+
+    Easing _easing { Easing::Linear };
+    uint32_t _steps { 0 };
+    uint32_t _step { 0 };
+
+    uint32_t _progress { 0 };
+    uint32_t _increment { 0 };
+    uint32_t _remainder { 0 };
+    uint32_t _error { 0 };
+};
+
+// Output frames prepared ahead of time. Engine only notifies about the values that change,
+// so every new frame starts as a copy of the one before it. When nothing is queued, that is
+// the frame that was popped last, i.e. what is currently on the output
+template <typename T, size_t Size>
+class FrameRing {
+public:
+    static_assert(Size >= 2, "");
+
+    bool full() const {
+        return _size == Size;
+    }
+
+    size_t size() const {
+        return _size;
+    }
+
+    // Producer fills the frame and then push()es it into the ring
+    T& next() {
+        auto& out = _frames[(_head + _size) % Size];
+        out = _frames[(_head + _size + Size - 1) % Size];
+        return out;
+    }
+
+    void push() {
+        ++_size;
+    }
+
+    // Frame is only valid until the next() call
+    const T& pop() {
+        const auto& out = _frames[_head];
+        _head = (_head + 1) % Size;
+        --_size;
+        return out;
+    }
+
+    // Returns the number of dropped frames
+    size_t clear() {
+        const auto out = _size;
+        _size = 0;
+        return out;
+    }
+
+private:
+    std::array<T, Size> _frames{};
+    size_t _head { 0 };
+    size_t _size { 0 };
+};
+
+} // namespace transition
+} // namespace light
+} // namespace espurna
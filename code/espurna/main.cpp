@@ -23,6 +23,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <algorithm>
 #include <utility>
 
+#if LOOP_ADAPTIVE_SUPPORT
+#include <coredecls.h>
+#endif
+
 #include "main.h"
 #include "ota.h"
 #include "rtcmem.h"
@@ -44,8 +48,13 @@ namespace build {
 constexpr espurna::duration::Milliseconds LoopDelayMin { 10 };
 constexpr espurna::duration::Milliseconds LoopDelayMax { 300 };
 
+// With the adaptive loop, this is the longest wait when no module requested an earlier deadline
 constexpr espurna::duration::Milliseconds loopDelay() {
+#if LOOP_ADAPTIVE_SUPPORT
+    return espurna::duration::Milliseconds { LOOP_ADAPTIVE_DELAY_MAX };
+#else
     return espurna::duration::Milliseconds { LOOP_DELAY_TIME };
+#endif
 }
 
 } // namespace build
@@ -75,6 +84,329 @@ std::forward_list<Callback> once_callbacks;
 
 } // namespace internal
 
+namespace profiler {
+
+// reload and once callbacks are measured as a whole,
+// loop callbacks are in the order of registration
+constexpr size_t Reload { 0 };
+constexpr size_t Once { 1 };
+constexpr size_t Loop { 2 };
+
+#if LOOP_PROFILER_SUPPORT
+
+// Every callback gets the number of calls, total and max CPU cycles and a histogram
+// of call durations. Bucket N counts calls that took [2^(N+Shift), 2^(N+Shift+1)) cycles,
+// except for the first and the last one which also include anything below or above.
+struct Stats {
+    static constexpr size_t Buckets { 12 };
+    static constexpr size_t Shift { 11 };
+
+    static constexpr uint32_t lower(size_t bucket) {
+        return (bucket > 0)
+            ? (uint32_t{ 1 } << (bucket + Shift))
+            : 0;
+    }
+
+    static size_t bucket(uint32_t cycles) {
+        const size_t log2 = cycles
+            ? (31 - __builtin_clz(cycles))
+            : 0;
+
+        return (log2 > Shift)
+            ? std::min(log2 - Shift, Buckets - 1)
+            : 0;
+    }
+
+    void add(uint32_t cycles) {
+        ++calls;
+        total += cycles;
+        max = std::max(max, cycles);
+
+        auto& count = histogram[bucket(cycles)];
+        if (count < std::numeric_limits<uint16_t>::max()) {
+            ++count;
+        }
+    }
+
+    uint32_t average() const {
+        return calls ? static_cast<uint32_t>(total / calls) : 0;
+    }
+
+    uint32_t calls { 0 };
+    uint64_t total { 0 };
+    uint32_t max { 0 };
+    uint16_t histogram[Buckets] {};
+};
+
+namespace internal {
+
+std::vector<Stats> stats(Loop);
+
+} // namespace internal
+
+void push_loop() {
+    internal::stats.emplace_back();
+}
+
+void add(size_t index, time::CpuClock::duration duration) {
+    internal::stats[index].add(duration.count());
+}
+
+void reset() {
+    for (auto& stats : internal::stats) {
+        stats = Stats();
+    }
+}
+
+// loop callbacks are only identified by their address, use `addr2line -f -e firmware.elf <address>`
+String name(size_t index) {
+    switch (index) {
+    case Reload:
+        return F("reload");
+    case Once:
+        return F("once");
+    }
+
+    char buffer[16];
+    snprintf_P(buffer, sizeof(buffer), PSTR("0x%08x"),
+        reinterpret_cast<uintptr_t>(main::internal::loop_callbacks[index - Loop]));
+
+    return buffer;
+}
+
+#if TERMINAL_SUPPORT
+namespace terminal {
+
+PROGMEM_STRING(LoopProfile, "LOOP.PROFILE");
+
+void loop_profile(::terminal::CommandContext&& ctx) {
+    if ((ctx.argv.size() == 2) && (ctx.argv[1] == F("reset"))) {
+        reset();
+        terminalOK(ctx);
+        return;
+    }
+
+    ctx.output.printf_P(PSTR("cpu: %hhuMHz, histogram from %u cycles\n"),
+        system_get_cpu_freq(), Stats::lower(1));
+
+    for (size_t index = 0; index < internal::stats.size(); ++index) {
+        const auto& stats = internal::stats[index];
+
+        ctx.output.printf_P(PSTR("%10s calls %u avg %u max %u |"),
+            name(index).c_str(), stats.calls, stats.average(), stats.max);
+        for (const auto count : stats.histogram) {
+            ctx.output.printf_P(PSTR(" %u"), count);
+        }
+        ctx.output.print('\n');
+    }
+
+    terminalOK(ctx);
+}
+
+static constexpr ::terminal::Command Commands[] PROGMEM {
+    {LoopProfile, loop_profile},
+};
+
+void setup() {
+    espurna::terminal::add(Commands);
+}
+
+} // namespace terminal
+#endif
+
+#if API_SUPPORT
+namespace api {
+
+bool get(ApiRequest&, JsonObject& root) {
+    root["cpu"] = static_cast<unsigned int>(system_get_cpu_freq());
+
+    JsonArray& buckets = root.createNestedArray("buckets");
+    for (size_t bucket = 0; bucket < Stats::Buckets; ++bucket) {
+        buckets.add(Stats::lower(bucket));
+    }
+
+    JsonArray& callbacks = root.createNestedArray("callbacks");
+    for (size_t index = 0; index < internal::stats.size(); ++index) {
+        const auto& stats = internal::stats[index];
+
+        JsonObject& callback = callbacks.createNestedObject();
+        callback["name"] = name(index);
+        callback["calls"] = stats.calls;
+        callback["avg"] = stats.average();
+        callback["max"] = stats.max;
+
+        JsonArray& histogram = callback.createNestedArray("histogram");
+        for (const auto count : stats.histogram) {
+            histogram.add(count);
+        }
+    }
+
+    return true;
+}
+
+bool put(ApiRequest&, JsonObject&) {
+    reset();
+    return true;
+}
+
+void setup() {
+    apiRegister(F("profile"), get, put);
+}
+
+} // namespace api
+#endif
+
+void setup() {
+#if TERMINAL_SUPPORT
+    terminal::setup();
+#endif
+#if API_SUPPORT
+    api::setup();
+#endif
+}
+
+#endif
+
+} // namespace profiler
+
+// Time spent waiting at the end of the loop(), instead of running the callbacks.
+// With the adaptive loop, delay is not fixed and modules can either request an earlier
+// wake up (deadline) or ask for the next loop() to start right away (wake).
+// Modules that can only poll for input register a wake source, checked during the wait
+namespace idle {
+namespace build {
+
+#if LOOP_ADAPTIVE_SUPPORT
+constexpr duration::Milliseconds WakeInterval { LOOP_ADAPTIVE_WAKE_INTERVAL };
+static_assert(WakeInterval.count() > 0, "");
+#endif
+
+} // namespace build
+
+namespace internal {
+
+duration::Microseconds total { 0 };
+
+#if LOOP_ADAPTIVE_SUPPORT
+// both can be modified from the SYS context or the ISR
+volatile bool wake { false };
+volatile bool sleeping { false };
+
+duration::Milliseconds deadline { duration::Milliseconds::max() };
+
+std::vector<LoopWakeCallback> sources;
+#endif
+
+} // namespace internal
+
+duration::Microseconds total() {
+    return internal::total;
+}
+
+#if LOOP_ADAPTIVE_SUPPORT
+void IRAM_ATTR wake() {
+    internal::wake = true;
+    if (internal::sleeping) {
+        esp_schedule();
+    }
+}
+
+void deadline(duration::Milliseconds value) {
+    internal::deadline = std::min(internal::deadline, value);
+}
+
+void source(LoopWakeCallback callback) {
+    internal::sources.push_back(callback);
+}
+
+// Input that does not have any way to notify us, e.g. UART RX buffer
+bool pending() {
+    for (auto& source : internal::sources) {
+        if (source()) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Until 3.0.0, delay() would return as soon as anything calls esp_schedule()
+// Newer Core versions would continue the delay, unless the blocking check says otherwise
+// Loop delay is the upper bound, modules can only ask for an earlier wake up
+void delay(duration::Milliseconds value) {
+    const auto timeout = std::min(
+        std::exchange(internal::deadline, duration::Milliseconds::max()), value);
+    const auto start = time::SystemClock::now();
+
+    internal::sleeping = true;
+    if (internal::wake || !timeout.count() || pending()) {
+        // still allow SYS tasks to run, but do not wait for anything
+        ::delay(0);
+    } else {
+#if defined(ARDUINO_ESP8266_RELEASE_2_7_2) \
+    || defined(ARDUINO_ESP8266_RELEASE_2_7_3) \
+    || defined(ARDUINO_ESP8266_RELEASE_2_7_4)
+        if (internal::sources.size()) {
+            time::blockingDelay(timeout, build::WakeInterval,
+                []() {
+                    return !internal::wake && !pending();
+                });
+        } else {
+            time::delay(timeout);
+        }
+#else
+        if (internal::sources.size()) {
+            // wake sources are only checked, no loop callbacks are called in between
+            esp_delay(timeout.count(),
+                []() {
+                    return !internal::wake && !pending();
+                },
+                build::WakeInterval.count());
+        } else {
+            esp_delay(timeout.count(),
+                []() {
+                    return !internal::wake;
+                });
+        }
+#endif
+    }
+
+    internal::sleeping = false;
+    internal::wake = false;
+
+    internal::total += time::SystemClock::now() - start;
+}
+#else
+void wake() {
+}
+
+void deadline(duration::Milliseconds) {
+}
+
+void source(LoopWakeCallback) {
+}
+
+void delay(duration::Milliseconds value) {
+    const auto start = time::SystemClock::now();
+    time::delay(value);
+    internal::total += time::SystemClock::now() - start;
+}
+#endif
+
+} // namespace idle
+
+template <typename T>
+void measure(size_t index, T&& callback) {
+#if LOOP_PROFILER_SUPPORT
+    const auto start = time::CpuClock::now();
+    callback();
+    profiler::add(index, time::CpuClock::now() - start);
+#else
+    (void)index;
+    callback();
+#endif
+}
+
 void flag_reload() {
     internal::reload_flag = true;
 }
@@ -94,6 +426,9 @@ void push_reload(ReloadCallback callback) {
 
 void push_loop(LoopCallback callback) {
     internal::loop_callbacks.push_back(callback);
+#if LOOP_PROFILER_SUPPORT
+    profiler::push_loop();
+#endif
 }
 
 duration::Milliseconds loop_delay() {
@@ -106,6 +441,7 @@ void loop_delay(duration::Milliseconds value) {
 
 void push_once(Callback callback) {
     internal::once_callbacks.push_front(std::move(callback));
+    idle::wake();
 }
 
 void push_once_unique(Callback::Type callback) {
@@ -129,15 +465,17 @@ void push_once_unique(Callback::Type callback) {
 void loop() {
     // Reload config before running any callbacks
     if (check_reload()) {
-        for (const auto& callback : internal::reload_callbacks) {
-            callback();
-        }
+        measure(profiler::Reload, []() {
+            for (const auto& callback : internal::reload_callbacks) {
+                callback();
+            }
+        });
     }
 
     // Loop callbacks, registered some time in setup()
     // Notice that everything is in order of registration
-    for (const auto& callback : internal::loop_callbacks) {
-        callback();
+    for (size_t index = 0; index < internal::loop_callbacks.size(); ++index) {
+        measure(profiler::Loop + index, internal::loop_callbacks[index]);
     }
 
     // One-time callbacks, registered some time during runtime
@@ -147,12 +485,14 @@ void loop() {
         decltype(internal::once_callbacks) once_callbacks;
         once_callbacks.swap(internal::once_callbacks);
 
-        for (const auto& callback : once_callbacks) {
-            callback();
-        }
+        measure(profiler::Once, [&]() {
+            for (const auto& callback : once_callbacks) {
+                callback();
+            }
+        });
     }
 
-    espurna::time::delay(internal::loop_delay);
+    idle::delay(internal::loop_delay);
 }
 
 void setup() {
@@ -304,6 +644,9 @@ void setup() {
     #if NTP_SUPPORT
         ntpSetup();
     #endif
+    #if GROUP_SYNC_SUPPORT
+        groupSyncSetup();
+    #endif
     #if I2C_SUPPORT
         i2cSetup();
     #endif
@@ -372,6 +715,10 @@ void setup() {
         extraSetup();
     #endif
 
+#if LOOP_PROFILER_SUPPORT
+    profiler::setup();
+#endif
+
     // Update `cfg` version
     migrate();
 
@@ -413,6 +760,22 @@ void espurnaLoopDelay(espurna::duration::Milliseconds value) {
     espurna::main::loop_delay(value);
 }
 
+void IRAM_ATTR espurnaLoopWake() {
+    espurna::main::idle::wake();
+}
+
+void espurnaLoopDeadline(espurna::duration::Milliseconds value) {
+    espurna::main::idle::deadline(value);
+}
+
+void espurnaRegisterLoopWake(LoopWakeCallback callback) {
+    espurna::main::idle::source(callback);
+}
+
+espurna::duration::Microseconds espurnaLoopIdleTime() {
+    return espurna::main::idle::total();
+}
+
 void setup() {
     espurna::main::setup();
 }
@@ -64,6 +64,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "garland.h"
 #endif
 
+#if GROUP_SYNC_SUPPORT
+#include "group_sync.h"
+#endif
+
 #if I2C_SUPPORT
 #include "i2c.h"
 #endif
@@ -46,6 +46,29 @@ static uint8_t  _mcp23s08RxData[16]  __attribute__((aligned(4)));
 
 namespace {
 
+// Output latch is updated in a single SPI transaction, instead of one per pin.
+// Every OLAT write goes through here, so the cached value is the one the expander has
+class Mcp23s08Port final : public espurna::gpio::Port {
+public:
+    const char* id() const override {
+        return "mcp23s08";
+    }
+
+    void begin() {
+        _latch = MCP23S08ReadRegister(OLAT);
+    }
+
+    void write(espurna::gpio::PortMask mask) override {
+        _latch = espurna::gpio::apply(_latch, mask);
+        MCP23S08WriteRegister(OLAT, _latch);
+    }
+
+private:
+    uint8_t _latch { 0 };
+};
+
+Mcp23s08Port _mcp23s08Port;
+
 class GpioMcp23s08 : public GpioBase {
 public:
     constexpr static size_t Pins { 8ul };
@@ -77,6 +100,10 @@ public:
         return std::make_unique<McpGpioPin>(index);
     }
 
+    espurna::gpio::Port* port() override {
+        return &_mcp23s08Port;
+    }
+
 private:
     Mask _lock;
 };
@@ -95,6 +122,8 @@ void MCP23S08Setup()
 
     pinMode(MCP23S08_CS_PIN, OUTPUT);
     digitalWrite(MCP23S08_CS_PIN, HIGH);
+
+    _mcp23s08Port.begin();
 }
 
 /**
@@ -169,18 +198,11 @@ void MCP23S08WriteRegister(uint8_t address, uint8_t data)
  */
 void MCP23S08SetPin(uint8_t pinNumber, bool state)
 {
-    uint8_t registerData = MCP23S08ReadRegister(OLAT);
-
-    if (state)
-    {
-        registerData |= (1 << pinNumber);
-    }
-    else
-    {
-        registerData &= ~(1 << pinNumber);
-    }
+    const uint32_t bit = 1ul << pinNumber;
 
-    MCP23S08WriteRegister(OLAT, registerData);
+    _mcp23s08Port.write(state
+        ? espurna::gpio::PortMask{ .set = bit, .clear = 0 }
+        : espurna::gpio::PortMask{ .set = 0, .clear = bit });
 }
 
 /**
@@ -23,6 +23,10 @@ Copyright (C) 2019-2021 by Maxim Prokhorov <prokhorov dot max at outlook dot com
 #include "ws.h"
 #endif
 
+#if GROUP_SYNC_SUPPORT
+#include "group_sync.h"
+#endif
+
 #include "mqtt.h"
 #include "relay.h"
 #include "fan.h"
@@ -808,6 +812,14 @@ struct RelayMaskHelper {
         return _mask[id];
     }
 
+    bool any() const {
+        return _mask.any();
+    }
+
+    size_t count() const {
+        return _mask.count();
+    }
+
 private:
     RelayMask _mask {};
 };
@@ -1297,6 +1309,7 @@ struct RelayDelayedTimer {
                 duration,
                 [&]() {
                     _ready = true;
+                    espurnaLoopWake();
                 });
         } else {
             _ready = true;
@@ -1362,6 +1375,22 @@ RelaySaveTimer _relay_save_timer;
 std::forward_list<RelayStatusCallback> _relay_status_notify;
 std::forward_list<RelayStatusCallback> _relay_status_change;
 
+// Relays with target status different from the current one, waiting for the loop to process them
+RelayMaskHelper _relay_pending;
+
+// Relays that were changed by the last loop pass, reported all at once at the end of it
+RelayMaskHelper _relay_changed;
+
+void _relayUpdatePending(size_t id) {
+    const bool pending { _relays[id].target_status != _relays[id].current_status };
+    _relay_pending.set(id, pending);
+
+    // status can also be changed from the SYS context, e.g. by the pulse timer
+    if (pending) {
+        espurnaLoopWake();
+    }
+}
+
 #if WEB_SUPPORT
 
 bool _relay_report_ws { false };
@@ -1416,12 +1445,16 @@ void relayOnStatusChange(RelayStatusCallback callback) {
 
 namespace {
 
+// Pin changes of a single loop pass are applied all at once, see `_relayProcess()`
+espurna::gpio::PortBatch _relay_port_batch;
+
 // Real GPIO provider, using BasePin interface to implement writers
 struct GpioProvider : public RelayProviderBase {
-    GpioProvider(RelayType type, std::unique_ptr<BasePin>&& pin, std::unique_ptr<BasePin>&& reset_pin) :
+    GpioProvider(RelayType type, std::unique_ptr<BasePin>&& pin, std::unique_ptr<BasePin>&& reset_pin, espurna::gpio::Port* port) :
         _type(type),
         _pin(std::move(pin)),
-        _reset_pin(std::move(reset_pin))
+        _reset_pin(std::move(reset_pin)),
+        _port(port)
     {}
 
     espurna::StringView id() const override {
@@ -1444,10 +1477,10 @@ struct GpioProvider : public RelayProviderBase {
     void change(bool status) override {
         switch (_type) {
         case RelayType::Normal:
-            _pin->digitalWrite(status);
+            write(status);
             break;
         case RelayType::Inverse:
-            _pin->digitalWrite(!status);
+            write(!status);
             break;
         case RelayType::Latched:
         case RelayType::LatchedInverse: {
@@ -1475,9 +1508,20 @@ struct GpioProvider : public RelayProviderBase {
     }
 
 private:
+    // latched relays still need the pulse sequence, so only the normal ones are batched
+    void write(bool value) {
+        if (_port) {
+            _relay_port_batch.write(*_port, _pin->pin(), value);
+            return;
+        }
+
+        _pin->digitalWrite(value);
+    }
+
     RelayType _type { RelayType::Normal };
     std::unique_ptr<BasePin> _pin;
     std::unique_ptr<BasePin> _reset_pin;
+    espurna::gpio::Port* _port { nullptr };
 };
 
 #if RELAY_PROVIDER_DUAL_SUPPORT
@@ -1876,12 +1920,14 @@ void _relaySyncLockAll() {
         });
 }
 
-bool _relayStatusCheckLock(Relay& relay, bool status) {
+bool _relayStatusCheckLock(size_t id, bool status) {
+    auto& relay = _relays[id];
     if (relay.lock != RelayLock::None) {
         bool lock = relay.lock == RelayLock::On;
         if ((lock != status) || (lock != relay.target_status)) {
             relay.target_status = lock;
             relay.change_delay = Relay::Delay::zero();
+            _relayUpdatePending(id);
             return false;
         }
     }
@@ -2034,7 +2080,7 @@ void _relaySync(size_t target) {
 bool _relayStatus(size_t id, bool status, bool report, bool group_report) {
     auto& relay = _relays[id];
 
-    if (!_relayStatusCheckLock(relay, status)) {
+    if (!_relayStatusCheckLock(id, status)) {
         relay.report = true;
         relay.group_report = true;
         DEBUG_MSG_P(PSTR("[RELAY] #%u is locked to %s\n"),
@@ -2046,10 +2092,17 @@ bool _relayStatus(size_t id, bool status, bool report, bool group_report) {
 
     if (relay.current_status == status) {
         if (relay.target_status != status) {
+#if GROUP_SYNC_SUPPORT
+            // Devices in the group already scheduled the cancelled change, restore the current status there as well
+            if (group_report && relay.group_report) {
+                groupSyncRelay(id, status, Relay::Delay::zero());
+            }
+#endif
             relay.target_status = status;
             relay.report = false;
             relay.group_report = false;
             relay.change_delay = Relay::Delay::zero();
+            _relayUpdatePending(id);
             changed = true;
         }
 
@@ -2091,9 +2144,18 @@ bool _relayStatus(size_t id, bool status, bool report, bool group_report) {
             // relay.fw_start = current_time;
         }
 
+#if GROUP_SYNC_SUPPORT
+        // Devices in the group change the relay after a short delay, this one waits for them as well
+        if (group_report) {
+            relay.change_delay = std::max(relay.change_delay,
+                groupSyncRelay(id, status, relay.change_delay));
+        }
+#endif
+
         relay.target_status = status;
         relay.report = report;
         relay.group_report = group_report;
+        _relayUpdatePending(id);
 
         _relaySync(id);
         changed = true;
@@ -2322,6 +2384,7 @@ void _relayBoot(size_t index, const RelayMaskHelper& mask) {
         : relay.delay_off;
 
     relay.provider->boot(status);
+    _relayUpdatePending(index);
 }
 
 void _relayBootAll() {
@@ -2402,6 +2465,15 @@ void _relayWebSocketUpdate(JsonObject& root) {
     });
 }
 
+void _relayWebSocketBinary(espurna::web::ws::binary::Writer& out) {
+    out.header(espurna::web::ws::binary::Type::Relays, _relays.size());
+    for (size_t index = 0; index < _relays.size(); ++index) {
+        out.u8(index);
+        out.u8(_relays[index].target_status ? 1 : 0);
+        out.u8(static_cast<uint8_t>(_relays[index].lock));
+    }
+}
+
 void _relayWebSocketSendRelays(JsonObject& root) {
     if (!_relays.size()) {
         return;
@@ -2438,7 +2510,7 @@ void _relayWebSocketOnConnected(JsonObject& root) {
     _relayWebSocketSendRelays(root);
 }
 
-void _relayWebSocketOnAction(uint32_t, const char* action, JsonObject& data) {
+void _relayWebSocketOnAction(uint32_t client_id, const char* action, JsonObject& data) {
     if (strncmp_P(action, PSTR("relay"), 5) == 0) {
         if (!data.is<size_t>(F("id")) || !data.is<String>(F("status"))) {
             return;
@@ -2447,12 +2519,16 @@ void _relayWebSocketOnAction(uint32_t, const char* action, JsonObject& data) {
         const auto id = data[F("id")].as<size_t>();
         const auto status = data[F("status")].as<String>();
         _relayHandlePayload(id, status);
+
+        // change could've been rejected (e.g. locked relay), make sure client sees the actual status
+        wsResync(client_id, RelayPrefix);
+        wsPostUpdate(RelayPrefix, _relayWebSocketUpdate);
     }
 }
 
 void _relayWsReport() {
     if (_relay_report_ws) {
-        wsPost(_relayWebSocketUpdate);
+        wsPostUpdate(RelayPrefix, _relayWebSocketUpdate);
         _relay_report_ws = false;
     }
 }
@@ -2465,7 +2541,8 @@ void relaySetupWS() {
         .onConnected(_relayWebSocketOnConnected)
         .onData(_relayWebSocketUpdate)
         .onAction(_relayWebSocketOnAction)
-        .onKeyCheck(_relayWebSocketOnKeyCheck);
+        .onKeyCheck(_relayWebSocketOnKeyCheck)
+        .onBinary(RelayPrefix, _relayWebSocketBinary);
 }
 
 #endif // WEB_SUPPORT
@@ -2745,6 +2822,21 @@ void _relayMqttReport(size_t id) {
     }
 }
 
+// When JSON payload is enabled, relays changed at the same time are sent as a single message
+void _relayMqttReport(const RelayMaskHelper& changed) {
+    size_t reported { 0 };
+    for (size_t id = 0; id < _relays.size(); ++id) {
+        if (changed[id]) {
+            reported += _relays[id].report ? 1 : 0;
+            _relayMqttReport(id);
+        }
+    }
+
+    if (reported > 1) {
+        mqttFlush();
+    }
+}
+
 void _relayMqttReportAll() {
     for (unsigned int id=0; id < _relays.size(); id++) {
         mqttSend(MQTT_TOPIC_RELAY, id, relayPayload(_relayPayloadStatus(id)).c_str()); // TODO FIXED LENGTH
@@ -3165,12 +3257,19 @@ void _relayCommandsSetup() {
 
 namespace {
 
-void _relayReport(size_t id [[gnu::unused]], bool status [[gnu::unused]]) {
-    for (auto& change : _relay_status_change) {
-        change(id, status);
+void _relayReport(const RelayMaskHelper& changed) {
+    const auto relays = _relays.size();
+    for (size_t id = 0; id < relays; ++id) {
+        if (changed[id]) {
+            const bool status { _relays[id].current_status };
+            for (auto& change : _relay_status_change) {
+                change(id, status);
+            }
+        }
     }
+
 #if MQTT_SUPPORT
-    _relayMqttReport(id);
+    _relayMqttReport(changed);
 #endif
 #if WEB_SUPPORT
     _relayScheduleWsReport();
@@ -3178,29 +3277,35 @@ void _relayReport(size_t id [[gnu::unused]], bool status [[gnu::unused]]) {
 }
 
 void _relayReport() {
+    if (_relay_changed.any()) {
+        _relayReport(_relay_changed);
+        _relay_changed.reset();
+    }
+
 #if WEB_SUPPORT
     _relayWsReport();
 #endif
 }
 
 /**
- * Walks the relay vector processing only those relays
+ * Walks the pending relays, processing only those
  * that have to change to the requested mode
  * @bool mode Requested mode
  */
 bool _relayProcess(bool mode) {
-    const auto relays = _relays.size();
     bool changed { false };
 
-    for (size_t id = 0; id < relays; ++id) {
+    auto pending = _relay_pending.toUnsigned();
+    while (pending) {
+        const size_t id = __builtin_ctz(pending);
+        pending &= pending - 1;
+
         // Only process the relays:
         // - target mode in the one requested by the arg
-        // - target status is different from the current one
         // - change delay has expired
         const bool target { _relays[id].target_status };
 
-        if ((target != _relays[id].current_status)
-            && (target == mode)
+        if ((target == mode)
             && ((!_relays[id].change_delay.count())
                 || (Relay::TimeSource::now() - _relays[id].change_start > _relays[id].change_delay)))
         {
@@ -3209,7 +3314,8 @@ bool _relayProcess(bool mode) {
             _relays[id].current_status = target;
             _relays[id].provider->change(target);
 
-            _relayReport(id, target);
+            _relay_pending.set(id, false);
+            _relay_changed.set(id, true);
 
             // try to immediately schedule 'normal' state
             _relayProcessPulse(_relays[id], id, target);
@@ -3222,6 +3328,9 @@ bool _relayProcess(bool mode) {
         }
     }
 
+    // every relay sharing the same port is switched at the same time
+    _relay_port_batch.commit();
+
     return changed;
 }
 
@@ -3233,15 +3342,40 @@ bool _relayProcess(bool mode) {
 
 namespace {
 
+// Relays that are still waiting for their change delay to expire
+void _relayPendingDeadline() {
+    auto out = espurna::duration::Milliseconds::max();
+
+    const auto now = Relay::TimeSource::now();
+
+    auto pending = _relay_pending.toUnsigned();
+    while (pending) {
+        const size_t id = __builtin_ctz(pending);
+        pending &= pending - 1;
+
+        const auto elapsed = std::chrono::duration_cast<Relay::Delay>(
+            now - _relays[id].change_start);
+        out = std::min(out, (elapsed < _relays[id].change_delay)
+            ? (_relays[id].change_delay - elapsed)
+            : Relay::Delay::zero());
+    }
+
+    espurnaLoopDeadline(out);
+}
+
 void _relayLoop() {
-    const bool changed[] {
-        _relayProcess(false),
-        _relayProcess(true),
-    };
+    if (_relay_pending.any()) {
+        const bool changed[] {
+            _relayProcess(false),
+            _relayProcess(true),
+        };
+
+        if (changed[0] || changed[1]) {
+            _relayRemoveCompletedPulse();
+            _relayPrepareUnlock();
+        }
 
-    if (changed[0] || changed[1]) {
-        _relayRemoveCompletedPulse();
-        _relayPrepareUnlock();
+        _relayPendingDeadline();
     }
 
     _relayProcessUnlock();
@@ -3264,6 +3398,11 @@ void relaySetupDummy(size_t size, bool reconfigure) {
         return;
     }
 
+    for (size_t id = new_size; id < _relays.size(); ++id) {
+        _relay_pending.set(id, false);
+        _relay_changed.set(id, false);
+    }
+
     _relayDummy = size;
     _relays.resize(new_size);
 
@@ -3339,7 +3478,7 @@ std::unique_ptr<GpioProvider> _relayGpioProvider(size_t index, RelayType type) {
     }
 
     return std::make_unique<GpioProvider>(
-        type, std::move(main), std::move(reset));
+        type, std::move(main), std::move(reset), base->port());
 }
 
 RelayProviderBasePtr _relaySetupProvider(size_t index) {
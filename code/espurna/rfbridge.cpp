@@ -23,6 +23,7 @@ Copyright (C) 2016-2019 by Xose Pérez <xose dot perez at gmail dot com>
 #include <cstring>
 #include <list>
 #include <memory>
+#include <vector>
 
 // -----------------------------------------------------------------------------
 // GLOBALS TO THE MODULE
@@ -471,6 +472,21 @@ bool _rfbWebSocketOnKeyCheck(espurna::StringView key, const JsonVariant& value)
 // RELAY <-> CODE MATCHING
 // -----------------------------------------------------------------------------
 
+// Fowler–Noll–Vo hash function (FNV-1a) for the received codes
+// ref: https://en.wikipedia.org/wiki/Fowler%E2%80%93Noll%E2%80%93Vo_hash_function
+
+constexpr uint32_t RfbFnvBasis { 2166136261u };
+constexpr uint32_t RfbFnvPrime { 16777619u };
+
+uint32_t _rfbFnv1Hash(uint32_t hash, const void* data, size_t length) {
+    const auto* ptr = reinterpret_cast<const uint8_t*>(data);
+    for (const auto* end = ptr + length; ptr != end; ++ptr) {
+        hash = (hash ^ static_cast<uint32_t>(*ptr)) * RfbFnvPrime;
+    }
+
+    return hash;
+}
+
 #if RFB_PROVIDER == RFB_PROVIDER_EFM8BB1
 
 // we only care about last 6 chars (3 bytes in hex),
@@ -479,6 +495,16 @@ bool _rfbCompare(const char* lhs, const char* rhs, size_t length) {
     return (0 == std::memcmp((lhs + length - 6), (rhs + length - 6), 6));
 }
 
+// same as above, only hash the part that is compared
+bool _rfbHashable(size_t length) {
+    return length >= 6;
+}
+
+uint32_t _rfbHash(const char* code, size_t length) {
+    return _rfbFnv1Hash(_rfbFnv1Hash(RfbFnvBasis, &length, sizeof(length)),
+        code + length - 6, 6);
+}
+
 #elif RFB_PROVIDER == RFB_PROVIDER_RCSWITCH
 
 // protocol is [2:3), actual payload is [10:), as bit length may vary
@@ -488,10 +514,85 @@ bool _rfbCompare(const char* lhs, const char* rhs, size_t length) {
         && (0 == std::memcmp((lhs + 10), (rhs + 10), length - 10));
 }
 
+// same as above, only hash the parts that are compared
+bool _rfbHashable(size_t length) {
+    return length >= 10;
+}
+
+uint32_t _rfbHash(const char* code, size_t length) {
+    auto hash = _rfbFnv1Hash(RfbFnvBasis, &length, sizeof(length));
+    hash = _rfbFnv1Hash(hash, code + 2, 2);
+    return _rfbFnv1Hash(hash, code + 10, length - 10);
+}
+
 #endif // RFB_PROVIDER == RFB_PROVIDER_EFM8BB1
 
 #if RELAY_SUPPORT
 
+// Instead of scanning the kvs on every received code, keep the hashes of every stored rfbON# and rfbOFF#
+// sorted in RAM. Settings are only accessed when the hash matches, to verify the code is the same.
+// Index is rebuilt every time codes are learned, forgotten or when settings are reloaded.
+
+struct RfbIndexEntry {
+    uint32_t hash;
+    uint8_t id;
+    bool status;
+};
+
+struct RfbMatchStats {
+    using TimeSource = espurna::time::CpuClock;
+    using Duration = std::chrono::duration<uint32_t, std::micro>;
+
+    void update(TimeSource::duration duration) {
+        last = std::chrono::duration_cast<Duration>(duration);
+        max = std::max(max, last);
+        ++count;
+    }
+
+    uint32_t count { 0 };
+    Duration last{};
+    Duration max{};
+};
+
+static std::vector<RfbIndexEntry> _rfb_index;
+static size_t _rfb_index_relays { 0 };
+static RfbMatchStats _rfb_match_stats;
+
+uint32_t _rfbHash(espurna::StringView code) {
+    return _rfbHash(code.begin(), code.length());
+}
+
+void _rfbIndexRebuild() {
+    _rfb_index.clear();
+
+    String code;
+
+    const auto relays = relayCount();
+    _rfb_index_relays = relays;
+
+    for (size_t id = 0; id < relays; ++id) {
+        for (const bool status : {true, false}) {
+            code = _rfbRetrieve(id, status);
+            if (!_rfbHashable(code.length())) {
+                continue;
+            }
+
+            _rfb_index.push_back(
+                RfbIndexEntry{
+                    .hash = _rfbHash(code),
+                    .id = static_cast<uint8_t>(id),
+                    .status = status,
+                });
+        }
+    }
+
+    std::sort(_rfb_index.begin(), _rfb_index.end(),
+        [](const RfbIndexEntry& lhs, const RfbIndexEntry& rhs) {
+            return lhs.hash < rhs.hash;
+        });
+    _rfb_index.shrink_to_fit();
+}
+
 // try to find the 'code' saves as either rfbON# or rfbOFF#
 //
 // **always** expect full length code as input to simplify comparison
@@ -499,53 +600,50 @@ bool _rfbCompare(const char* lhs, const char* rhs, size_t length) {
 // thus requiring us to 'return' value from settings as the real code, replacing input
 RfbRelayMatch _rfbMatch(espurna::StringView code) {
     RfbRelayMatch matched;
-    if (!relayCount()) {
+
+    const auto relays = relayCount();
+    if (!relays || !_rfbHashable(code.length())) {
         return matched;
     }
 
-    // we gather all available options, as the kv store might be defined in any order
-    // scan kvs only once, since we want both ON and OFF options and don't want to depend on the relayCount()
-    espurna::settings::foreach_prefix(
-        [code, &matched](espurna::StringView prefix, String key, const espurna::settings::kvs_type::ReadResult& value) {
-            if (code.length() != value.length()) {
-                return;
-            }
+    // relays could be added at any time through `relayAdd()`
+    if (relays != _rfb_index_relays) {
+        _rfbIndexRebuild();
+    }
 
-            PayloadStatus status {
-                (prefix.c_str() == &rfbridge::settings::keys::On[0]) ? PayloadStatus::On :
-                (prefix.c_str() == &rfbridge::settings::keys::Off[0]) ? PayloadStatus::Off :
-                PayloadStatus::Unknown };
+    const auto start = RfbMatchStats::TimeSource::now();
+    const auto hash = _rfbHash(code);
 
-            if (PayloadStatus::Unknown == status) {
-                return;
-            }
+    auto it = std::lower_bound(_rfb_index.begin(), _rfb_index.end(), hash,
+        [](const RfbIndexEntry& entry, uint32_t hash) {
+            return entry.hash < hash;
+        });
 
-            if (!_rfbCompare(code.begin(), value.read().begin(), code.length())) {
-                return;
-            }
+    String value;
+    for (; (it != _rfb_index.end()) && ((*it).hash == hash); ++it) {
+        // hashes may collide, make sure stored code is the same one
+        value = _rfbRetrieve((*it).id, (*it).status);
+        if ((code.length() != value.length())
+         || !_rfbCompare(code.begin(), value.begin(), code.length()))
+        {
+            continue;
+        }
 
-            espurna::StringView id_view(key.begin() + prefix.length(), key.end());
-            if (!id_view.length() || (*id_view.begin()) == '\0') {
-                return;
-            }
+        const size_t id = (*it).id;
+        const auto status = (*it).status
+            ? PayloadStatus::On
+            : PayloadStatus::Off;
 
-            size_t id;
-            if (!tryParseId(id_view, relayCount(), id)) {
-                return;
-            }
+        // when we see the same id twice, we match the opposite statuses
+        if (matched && (id == matched.id())) {
+            matched.reset(matched.id(), PayloadStatus::Toggle);
+            continue;
+        }
 
-            // when we see the same id twice, we match the opposite statuses
-            if (matched && (id == matched.id())) {
-                matched.reset(matched.id(), PayloadStatus::Toggle);
-                return;
-            }
+        matched.reset(matched ? std::min(id, matched.id()) : id, status);
+    }
 
-            matched.reset(matched ? std::min(id, matched.id()) : id, status);
-        },
-        {
-            rfbridge::settings::keys::On,
-            rfbridge::settings::keys::Off
-        });
+    _rfb_match_stats.update(RfbMatchStats::TimeSource::now() - start);
 
     return matched;
 }
@@ -557,6 +655,7 @@ void _rfbLearnFromString(std::unique_ptr<RfbLearn>& learn, espurna::StringView b
 
     DEBUG_MSG_P(PSTR("[RF] Learned relay ID %u after %u ms\n"), learn->id, millis() - learn->ts);
     _rfbStore(learn->id, learn->status, buffer.toString());
+    _rfbIndexRebuild();
 
     // Websocket update needs to happen right here, since the only time
     // we send these in bulk is at the very start of the connection
@@ -575,7 +674,8 @@ bool _rfbRelayHandler(espurna::StringView payload, bool locked = false) {
 
     const auto match = _rfbMatch(payload);
     if (match) {
-        DEBUG_MSG_P(PSTR("[RF] Matched with the relay ID %u\n"), match.id());
+        DEBUG_MSG_P(PSTR("[RF] Matched with the relay ID %u (%u us)\n"),
+            match.id(), _rfb_match_stats.last.count());
         _rfb_relay_status_lock.set(match.id(), locked);
 
         switch (match.status()) {
@@ -1004,7 +1104,11 @@ void _rfbSendQueued() {
     if (_rfb_message_queue.empty()) return;
 
     static unsigned long last = 0;
-    if (millis() - last < RFB_SEND_DELAY) return;
+    const auto elapsed = millis() - last;
+    if (elapsed < RFB_SEND_DELAY) {
+        espurnaLoopDeadline(espurna::duration::Milliseconds(RFB_SEND_DELAY - elapsed));
+        return;
+    }
     last = millis();
 
     auto message = _rfb_message_queue.front();
@@ -1018,6 +1122,10 @@ void _rfbSendQueued() {
         _rfb_message_queue.push_back(std::move(message));
     }
 
+    if (!_rfb_message_queue.empty()) {
+        espurnaLoopDeadline(espurna::duration::Milliseconds(RFB_SEND_DELAY));
+    }
+
     yield();
 
 }
@@ -1234,6 +1342,22 @@ static void _rfbCommandForget(::terminal::CommandContext&& ctx) {
 
     terminalOK(ctx);
 }
+
+PROGMEM_STRING(RfbCommandIndex, "RFB.INDEX");
+
+static void _rfbCommandIndex(::terminal::CommandContext&& ctx) {
+    for (const auto& entry : _rfb_index) {
+        ctx.output.printf_P(PSTR("%08x => relay %u %s\n"),
+            entry.hash, entry.id, entry.status ? "ON" : "OFF");
+    }
+
+    ctx.output.printf_P(PSTR("matched %u codes, last %u us, max %u us\n"),
+        _rfb_match_stats.count,
+        _rfb_match_stats.last.count(),
+        _rfb_match_stats.max.count());
+
+    terminalOK(ctx);
+}
 #endif // if RELAY_SUPPORT
 
 #if RFB_PROVIDER == RFB_PROVIDER_EFM8BB1
@@ -1254,6 +1378,7 @@ static constexpr ::terminal::Command RfbCommands[] PROGMEM {
 #if RELAY_SUPPORT
     {RfbCommandLearn, _rfbCommandLearn},
     {RfbCommandForget, _rfbCommandForget},
+    {RfbCommandIndex, _rfbCommandIndex},
 #endif
 #if RFB_PROVIDER == RFB_PROVIDER_EFM8BB1
     {RfbCommandWrite, _rfbCommandWrite},
@@ -1274,6 +1399,7 @@ void _rfbCommandsSetup() {
 
 void rfbStore(size_t id, bool status, String code) {
     _rfbStore(id, status, std::move(code));
+    _rfbIndexRebuild();
 }
 
 String rfbRetrieve(size_t id, bool status) {
@@ -1301,6 +1427,7 @@ void rfbLearn(size_t id, bool status) {
 void rfbForget(size_t id, bool status) {
 
     delSetting({status ? F("rfbON") : F("rfbOFF"), id});
+    _rfbIndexRebuild();
 
     // Websocket update needs to happen right here, since the only time
     // we send these in bulk is at the very start of the connection
@@ -1375,6 +1502,10 @@ void rfbSetup() {
 
     _rfb_port = port->stream;
     _rfb_parser.reserve(RfbParser::MessageSizeBasic);
+
+    espurnaRegisterLoopWake([]() {
+        return _rfb_port->available() > 0;
+    });
 #elif RFB_PROVIDER == RFB_PROVIDER_RCSWITCH
 
 #if RELAY_SUPPORT
@@ -1395,6 +1526,11 @@ void rfbSetup() {
             _rfb_receive = true;
             _rfb_modem->enableReceive(rx);
             DEBUG_MSG_P(PSTR("[RF] RF receiver on GPIO %u\n"), rx);
+
+            // code is decoded in the ISR, loop() only needs to pick it up
+            espurnaRegisterLoopWake([]() {
+                return _rfb_modem->available();
+            });
         }
         if (gpioLock(tx)) {
             auto transmit = getSetting("rfbTransmit", RFB_TRANSMIT_REPEATS);
@@ -1410,6 +1546,9 @@ void rfbSetup() {
 #if RELAY_SUPPORT
     relayOnStatusNotify(rfbStatus);
     relayOnStatusChange(rfbStatus);
+
+    _rfbIndexRebuild();
+    espurnaRegisterReload(_rfbIndexRebuild);
 #endif
 
 #if MQTT_SUPPORT
@@ -29,6 +29,7 @@ Copyright (C) 2019 by Xose Pérez <xose dot perez at gmail dot com>
 
 #include <forward_list>
 #include <list>
+#include <numeric>
 #include <type_traits>
 #include <vector>
 
@@ -155,6 +156,10 @@ unsigned long run_last = 0;
 using Runners = std::forward_list<Runner>;
 Runners runners;
 
+// operators that depend on something other than the stack contents,
+// e.g. time, runners, received codes or the current device state
+std::vector<rpn_operator::callback_type> inputs;
+
 } // namespace internal
 
 void schedule() {
@@ -224,6 +229,473 @@ private:
 
 // -----------------------------------------------------------------------------
 
+// Rules are compiled on configure() into a token array, so we no longer need to
+// query settings & re-parse every rule text on every run. Operators are resolved
+// by name only once into a shared table, and literal values are pre-parsed into the value pool.
+// Variables are kept as slots shared by every rule. Each slot remembers the value object
+// owned by the context, so the stack reference is pushed without looking up the name.
+// When something in the rule is not understood by the compiler (e.g. nested stacks),
+// rule text is stored as-is and processed by the library on every run.
+//
+// Compiled rules also record which variables they read, so the next run would only
+// process rules which inputs were changed since the last run. Rules using input
+// operators, rules without any variables and text rules are always processed.
+
+namespace program {
+
+struct Token {
+    enum class Type : uint8_t {
+        Value,
+        Operator,
+        Variable,
+    };
+
+    Type type;
+    uint16_t index;
+};
+
+struct Operator {
+    rpn_operator::callback_type callback;
+    size_t argc;
+
+    bool operator==(const Operator& other) const {
+        return callback == other.callback;
+    }
+};
+
+struct Stats {
+    using TimeSource = espurna::time::CpuClock;
+    using Duration = std::chrono::duration<uint32_t, std::micro>;
+
+    void update(TimeSource::duration duration) {
+        const auto value = std::chrono::duration_cast<Duration>(duration);
+        last = value;
+        max = std::max(max, value);
+        total += value.count();
+        ++count;
+    }
+
+    Duration average() const {
+        return count
+            ? Duration(total / count)
+            : Duration::zero();
+    }
+
+    uint32_t count { 0 };
+    uint64_t total { 0 };
+    Duration last{};
+    Duration max{};
+};
+
+struct Rule {
+    std::vector<Token> tokens;
+    std::vector<uint16_t> inputs;
+    std::vector<uint16_t> outputs;
+    String text;
+    bool compiled { false };
+    bool always { false };
+    uint32_t skipped { 0 };
+    Stats stats;
+};
+
+struct Program {
+    std::vector<rpn_value> values;
+    std::vector<Operator> operators;
+    std::vector<String> variables;
+    std::vector<std::shared_ptr<rpn_value>> references;
+    std::vector<bool> dirty;
+    std::vector<uint16_t> changes;
+    std::vector<uint16_t> names;
+    std::vector<Rule> rules;
+    bool force { true };
+};
+
+// slots retain the '$' or '&' prefix, but both refer to the same variable
+StringView slot_name(const String& slot) {
+    return StringView(slot).slice(1);
+}
+
+bool name_less(StringView lhs, StringView rhs) {
+    return std::lexicographical_compare(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());
+}
+
+// Every variable write goes through `variable_set()` or the rule outputs, both mark the slots using
+// that name. Slots are sorted by name once when compiling, so only the matching ones are visited
+void changed(Program& program, StringView name) {
+    auto it = std::lower_bound(program.names.begin(), program.names.end(), name,
+        [&](uint16_t index, StringView value) {
+            return name_less(slot_name(program.variables[index]), value);
+        });
+
+    for (; (it != program.names.end()) && (slot_name(program.variables[*it]) == name); ++it) {
+        if (!program.dirty[*it]) {
+            program.dirty[*it] = true;
+            program.changes.push_back(*it);
+        }
+    }
+}
+
+bool dirty(const Program& program, const Rule& rule) {
+    for (const auto& input : rule.inputs) {
+        if (program.dirty[input]) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+template <typename T, typename Value>
+uint16_t slot(std::vector<T>& container, Value&& value) {
+    auto it = std::find(container.begin(), container.end(), value);
+    if (it == container.end()) {
+        container.push_back(std::forward<Value>(value));
+        return container.size() - 1;
+    }
+
+    return std::distance(container.begin(), it);
+}
+
+struct Compiler {
+    Compiler(rpn_context& context, Program& program) :
+        _context(context),
+        _program(program),
+        _scratch(std::make_unique<rpn_context>())
+    {}
+
+    bool compile(Rule& rule, StringView text);
+    void references(Rule& rule, StringView text);
+
+private:
+    bool token(Rule& rule, StringView word);
+    bool value(Rule& rule, StringView word);
+    bool op(Rule& rule, StringView word);
+
+    rpn_context& _context;
+    Program& _program;
+    std::unique_ptr<rpn_context> _scratch;
+};
+
+bool Compiler::value(Rule& rule, StringView word) {
+    // literals are parsed by the library, exactly as they would've been when processing the rule text
+    const auto tmp = word.toString();
+    rpn_stack_clear(*_scratch);
+
+    bool out = rpn_process(*_scratch, tmp.c_str())
+        && (rpn_stack_size(*_scratch) == 1);
+    if (out) {
+        rule.tokens.push_back(
+            Token{
+                .type = Token::Type::Value,
+                .index = static_cast<uint16_t>(_program.values.size()),
+            });
+        _program.values.push_back(rpn_stack_pop(*_scratch));
+    }
+
+    rpn_stack_clear(*_scratch);
+    return out;
+}
+
+bool Compiler::op(Rule& rule, StringView word) {
+    bool out { false };
+
+    rpn_operators_foreach(_context,
+        [&](const String& name, size_t argc, rpn_operator::callback_type callback) {
+            if (!out && (word == name)) {
+                if (std::find(internal::inputs.begin(), internal::inputs.end(), callback)
+                        != internal::inputs.end())
+                {
+                    rule.always = true;
+                }
+
+                const auto index = slot(_program.operators,
+                    Operator{
+                        .callback = callback,
+                        .argc = argc,
+                    });
+                rule.tokens.push_back(
+                    Token{
+                        .type = Token::Type::Operator,
+                        .index = static_cast<uint16_t>(index),
+                    });
+                out = true;
+            }
+        });
+
+    return out;
+}
+
+void dependency(std::vector<uint16_t>& deps, uint16_t index) {
+    if (std::find(deps.begin(), deps.end(), index) == deps.end()) {
+        deps.push_back(index);
+    }
+}
+
+bool Compiler::token(Rule& rule, StringView word) {
+    switch (word[0]) {
+    case '$':
+    case '&':
+    {
+        const auto index = slot(_program.variables, word.toString());
+        rule.tokens.push_back(
+            Token{
+                .type = Token::Type::Variable,
+                .index = index,
+            });
+
+        dependency((word[0] == '$')
+            ? rule.inputs
+            : rule.outputs, index);
+
+        return true;
+    }
+
+    case '[':
+    case ']':
+        return false;
+    }
+
+    return op(rule, word) || value(rule, word);
+}
+
+// Quoted strings are kept as a single word
+template <typename T>
+bool words(StringView text, T&& callback) {
+    const char* it = text.begin();
+    const char* end = text.end();
+
+    while (it != end) {
+        if (isspace(*it)) {
+            ++it;
+            continue;
+        }
+
+        const char* start = it;
+        if (*it == '"') {
+            for (++it; (it != end) && (*it != '"'); ++it) {
+                if ((*it == '\\') && (std::next(it) != end)) {
+                    ++it;
+                }
+            }
+
+            if (it == end) {
+                return false;
+            }
+
+            ++it;
+        } else {
+            while ((it != end) && !isspace(*it)) {
+                ++it;
+            }
+        }
+
+        if (!callback(StringView(start, it))) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool Compiler::compile(Rule& rule, StringView text) {
+    if (!words(text, [&](StringView word) { return token(rule, word); })) {
+        return false;
+    }
+
+    rule.tokens.shrink_to_fit();
+    rule.inputs.shrink_to_fit();
+    rule.outputs.shrink_to_fit();
+
+    if (rule.inputs.empty()) {
+        rule.always = true;
+    }
+
+    return true;
+}
+
+// Text rule is processed by the library, any variable mentioned in it could be either read or written
+void Compiler::references(Rule& rule, StringView text) {
+    words(text, [&](StringView word) {
+        if ((word[0] == '$') || (word[0] == '&')) {
+            const auto index = slot(_program.variables, word.toString());
+            dependency(rule.inputs, index);
+            dependency(rule.outputs, index);
+        }
+
+        return true;
+    });
+
+    rule.inputs.shrink_to_fit();
+    rule.outputs.shrink_to_fit();
+}
+
+// Context and the slot are the only owners of the variable value. When the slot is the last one left,
+// variable was removed from the context (e.g. not sticky, or through `unset`) and is looked up again.
+// Missing variables are handled by the library, which either creates them or reports the error
+bool push_variable(rpn_context& context, Program& program, uint16_t index) {
+    auto& reference = program.references[index];
+    if (!reference || (reference.use_count() == 1)) {
+        reference = nullptr;
+
+        const auto name = slot_name(program.variables[index]);
+        for (auto& variable : context.variables) {
+            if (name == variable.name) {
+                reference = variable.value;
+                break;
+            }
+        }
+
+        if (!reference) {
+            return rpn_process(context, program.variables[index].c_str());
+        }
+    }
+
+    context.stack.get().emplace_back(rpn_stack_value::Type::Variable, reference);
+    return true;
+}
+
+bool execute(rpn_context& context, Program& program, const Rule& rule) {
+    if (!rule.compiled) {
+        return rpn_process(context, rule.text.c_str());
+    }
+
+    for (const auto& token : rule.tokens) {
+        switch (token.type) {
+        case Token::Type::Value:
+            rpn_stack_push(context, program.values[token.index]);
+            break;
+
+        case Token::Type::Operator:
+        {
+            const auto& op = program.operators[token.index];
+            if (rpn_stack_size(context) < op.argc) {
+                return false;
+            }
+
+            const rpn_error result = op.callback(context);
+            if (result.code != 0) {
+                return false;
+            }
+            break;
+        }
+
+        case Token::Type::Variable:
+            if (!push_variable(context, program, token.index)) {
+                return false;
+            }
+            break;
+        }
+    }
+
+    return true;
+}
+
+void run(rpn_context& context, Program& program) {
+    for (auto& rule : program.rules) {
+        if (!program.force && !rule.always && !dirty(program, rule)) {
+            ++rule.skipped;
+            continue;
+        }
+
+        const auto start = Stats::TimeSource::now();
+        execute(context, program, rule);
+        rule.stats.update(Stats::TimeSource::now() - start);
+
+        rpn_stack_clear(context);
+
+        // assignments are only propagated to the rules that follow this one,
+        // rules that were already processed would have to wait for the next run
+        for (const auto& output : rule.outputs) {
+            changed(program, slot_name(program.variables[output]));
+        }
+    }
+
+    for (const auto& index : program.changes) {
+        program.dirty[index] = false;
+    }
+
+    program.changes.clear();
+    program.force = false;
+}
+
+Program compile(rpn_context& context) {
+    Program out;
+    Compiler compiler(context, out);
+
+    size_t index { 0 };
+    String text;
+    for (;;) {
+        text = settings::rule(index);
+        if (!text.length()) {
+            break;
+        }
+
+        out.rules.emplace_back();
+        auto& rule = out.rules.back();
+
+        const auto values = out.values.size();
+        const auto operators = out.operators.size();
+        const auto variables = out.variables.size();
+
+        rule.compiled = compiler.compile(rule, text);
+        if (!rule.compiled) {
+            out.values.resize(values);
+            out.operators.resize(operators);
+            out.variables.resize(variables);
+
+            rule.tokens.clear();
+            rule.tokens.shrink_to_fit();
+            rule.inputs.clear();
+            rule.inputs.shrink_to_fit();
+            rule.outputs.clear();
+            rule.outputs.shrink_to_fit();
+            compiler.references(rule, text);
+
+            rule.always = true;
+            rule.text = std::move(text);
+            DEBUG_MSG_P(PSTR("[RPN] Rule #%zu will be processed as text\n"), index);
+        }
+
+        ++index;
+    }
+
+    out.values.shrink_to_fit();
+    out.operators.shrink_to_fit();
+    out.variables.shrink_to_fit();
+    out.references.resize(out.variables.size());
+    out.dirty.resize(out.variables.size(), false);
+    out.rules.shrink_to_fit();
+
+    out.names.resize(out.variables.size());
+    std::iota(out.names.begin(), out.names.end(), 0);
+    std::sort(out.names.begin(), out.names.end(),
+        [&](uint16_t lhs, uint16_t rhs) {
+            return name_less(slot_name(out.variables[lhs]), slot_name(out.variables[rhs]));
+        });
+
+    return out;
+}
+
+} // namespace program
+
+namespace internal {
+
+program::Program program;
+
+} // namespace internal
+
+void variable_set(const String& name, const rpn_value& value) {
+    rpn_variable_set(internal::context, name, value);
+    program::changed(internal::program, name);
+}
+
+void input_operator_set(rpn_context& context, const char* name, size_t argc, rpn_operator::callback_type callback) {
+    rpn_operator_set(context, name, argc, callback);
+    internal::inputs.push_back(callback);
+}
+
+// -----------------------------------------------------------------------------
+
 #if TERMINAL_SUPPORT
 namespace terminal {
 
@@ -352,10 +824,48 @@ void test(::terminal::CommandContext&& ctx) {
     showStack(ctx.output);
     rpn_stack_clear(internal::context);
 
+    // expression could've assigned any of the variables, process every rule on the next run
+    internal::program.force = true;
+
+    terminalOK(ctx);
+}
+
+PROGMEM_STRING(Rules, "RPN.RULES");
+
+void rules(::terminal::CommandContext&& ctx) {
+    if (internal::program.rules.empty()) {
+        terminalError(ctx, F("No rules"));
+        return;
+    }
+
+    size_t index { 0 };
+    for (const auto& rule : internal::program.rules) {
+        char buffer[192] = {0};
+        snprintf_P(buffer, sizeof(buffer),
+            PSTR("#%zu %s (%zu tokens, %zu inputs%s) runs %u, skipped %u, last %u us, avg %u us, max %u us\n"),
+            index++,
+            rule.compiled ? "compiled" : "text",
+            rule.tokens.size(),
+            rule.inputs.size(),
+            rule.always ? ", always" : "",
+            rule.stats.count,
+            rule.skipped,
+            rule.stats.last.count(),
+            rule.stats.average().count(),
+            rule.stats.max.count());
+        ctx.output.print(buffer);
+    }
+
+    ctx.output.printf_P(PSTR("values %zu, operators %zu, variables %zu\n"),
+        internal::program.values.size(),
+        internal::program.operators.size(),
+        internal::program.variables.size());
+
     terminalOK(ctx);
 }
 
 static constexpr ::terminal::Command Commands[] PROGMEM {
+    {Rules, rules},
     {Runners, runners},
     {Variables, variables},
     {Operators, operators},
@@ -559,12 +1069,12 @@ rpn_operator_error handle(rpn_context& ctxt, Runner::Policy policy, unsigned lon
 }
 
 void init(rpn_context& context) {
-    rpn_operator_set(context, "oneshot_ms", 1, [](rpn_context& ctxt) -> rpn_error {
+    input_operator_set(context, "oneshot_ms", 1, [](rpn_context& ctxt) -> rpn_error {
         auto every = rpn_stack_pop(ctxt);
         return handle(ctxt, Runner::Policy::OneShot, every.toUint());
     });
 
-    rpn_operator_set(context, "every_ms", 1, [](rpn_context & ctxt) -> rpn_error {
+    input_operator_set(context, "every_ms", 1, [](rpn_context & ctxt) -> rpn_error {
         auto every = rpn_stack_pop(ctxt);
         return handle(ctxt, Runner::Policy::Periodic, every.toUint());
     });
@@ -700,11 +1210,11 @@ void init(rpn_context& context) {
         schedule();
     });
 
-    rpn_operator_set(context, "tick_1h", 0, tickHour);
-    rpn_operator_set(context, "tick_1m", 0, tickMinute);
+    input_operator_set(context, "tick_1h", 0, tickHour);
+    input_operator_set(context, "tick_1m", 0, tickMinute);
 
-    rpn_operator_set(context, "utc", 0, now);
-    rpn_operator_set(context, "now", 0, now);
+    input_operator_set(context, "utc", 0, now);
+    input_operator_set(context, "now", 0, now);
 
     registerGenericTimestampOperator(context, "utc_month", ::utc_month);
     registerGenericTimestampOperator(context, "month", ::month);
@@ -736,7 +1246,7 @@ void updateVariables(size_t id, bool status) {
     char name[32] = {0};
     snprintf(name, sizeof(name), "relay%zu", id);
 
-    rpn_variable_set(internal::context, name, rpn_value(status));
+    variable_set(name, rpn_value(status));
     schedule();
 }
 
@@ -787,7 +1297,7 @@ void updateVariables() {
     for (decltype(channels) channel = 0; channel < channels; ++channel) {
         auto value = rpn_value(static_cast<rpn_int>(lightChannel(channel)));
         snprintf(name, sizeof(name), "channel%u", channel);
-        rpn_variable_set(internal::context, name, std::move(value));
+        variable_set(name, value);
     }
 
     schedule();
@@ -801,7 +1311,7 @@ void init(rpn_context& context) {
         return 0;
     });
 
-    rpn_operator_set(context, "brightness", 0, [](rpn_context& ctxt) -> rpn_error {
+    input_operator_set(context, "brightness", 0, [](rpn_context& ctxt) -> rpn_error {
         rpn_value value { static_cast<rpn_int>(::lightBrightness()) };
         rpn_stack_push(ctxt, value);
         return 0;
@@ -1090,11 +1600,11 @@ void init(rpn_context& context) {
 
     // And codes can later be accessed by operators
     rpn_operator_set(context, "rfb_send", 1, sendCode);
-    rpn_operator_set(context, "rfb_pop", 2, popCode);
-    rpn_operator_set(context, "rfb_info", 2, codeInfo);
-    rpn_operator_set(context, "rfb_sequence", 4, sequence);
-    rpn_operator_set(context, "rfb_match", 3, match);
-    rpn_operator_set(context, "rfb_match_wait", 4, matchAndWait);
+    input_operator_set(context, "rfb_pop", 2, popCode);
+    input_operator_set(context, "rfb_info", 2, codeInfo);
+    input_operator_set(context, "rfb_sequence", 4, sequence);
+    input_operator_set(context, "rfb_match", 3, match);
+    input_operator_set(context, "rfb_match_wait", 4, matchAndWait);
 }
 
 } // namespace rfbridge
@@ -1109,8 +1619,7 @@ void updateVariables(const espurna::sensor::Value& value) {
     auto topic = value.topic;
     topic.replace("/", "");
 
-    rpn_variable_set(internal::context,
-            topic, rpn_value(static_cast<rpn_float>(value.value)));
+    variable_set(topic, rpn_value(static_cast<rpn_float>(value.value)));
 }
 
 void init(rpn_context&) {
@@ -1176,7 +1685,7 @@ void init(rpn_context& context) {
             : rpn_operator_error::Ok;
     });
 
-    rpn_operator_set(internal::context, "millis", 0, [](rpn_context & ctxt) -> rpn_error {
+    input_operator_set(context, "millis", 0, [](rpn_context & ctxt) -> rpn_error {
         rpn_stack_push(ctxt, rpn_value(static_cast<uint32_t>(millis())));
         return 0;
     });
@@ -1191,7 +1700,7 @@ void init(rpn_context& context) {
         return with_sleep_duration(ctxt, instantDeepSleep);
     });
 
-    rpn_operator_set(context, "mem?", 0, [](rpn_context& ctxt) -> rpn_error {
+    input_operator_set(context, "mem?", 0, [](rpn_context& ctxt) -> rpn_error {
         rpn_stack_push(ctxt, rpn_value(::rtcmemStatus()));
         return 0;
     });
@@ -1209,7 +1718,7 @@ void init(rpn_context& context) {
         return rpn_operator_error::InvalidArgument;
     });
 
-    rpn_operator_set(context, "mem_read", 1, [](rpn_context& ctxt) -> rpn_error {
+    input_operator_set(context, "mem_read", 1, [](rpn_context& ctxt) -> rpn_error {
         auto addr = rpn_stack_pop(ctxt).toUint();
 
         if (addr < RTCMEM_BLOCKS) {
@@ -1228,7 +1737,7 @@ void init(rpn_context& context) {
 namespace wifi {
 
 void init(rpn_context& context) {
-    rpn_operator_set(context, "stations", 0, [](rpn_context& ctxt) -> rpn_error {
+    input_operator_set(context, "stations", 0, [](rpn_context& ctxt) -> rpn_error {
         rpn_stack_push(ctxt, rpn_value {
             static_cast<rpn_uint>(wifiApStations()) });
         return 0;
@@ -1240,7 +1749,7 @@ void init(rpn_context& context) {
         return 0;
     });
 
-    rpn_operator_set(context, "rssi", 0, [](rpn_context& ctxt) -> rpn_error {
+    input_operator_set(context, "rssi", 0, [](rpn_context& ctxt) -> rpn_error {
         const rpn_int rssi = wifiConnected()
             ? wifi_station_get_rssi()
             : -127;
@@ -1299,7 +1808,7 @@ void run() {
     }
 
     for (auto& variable : mqtt::variables) {
-        rpn_variable_set(internal::context, variable.name, variable.value);
+        variable_set(variable.name, variable.value);
     }
     mqtt::variables.clear();
 #endif
@@ -1308,17 +1817,7 @@ void run() {
         return;
     }
 
-    size_t index { 0 };
-    String rule;
-    for (;;) {
-        rule = settings::rule(index++);
-        if (!rule.length()) {
-            break;
-        }
-
-        rpn_process(internal::context, rule.c_str());
-        rpn_stack_clear(internal::context);
-    }
+    program::run(internal::context, internal::program);
 
     if (!settings::sticky()) {
         rpn_variables_clear(internal::context);
@@ -1337,6 +1836,7 @@ void configure() {
     }
 #endif
     internal::run_delay = rpnrules::settings::delay();
+    internal::program = program::compile(internal::context);
 }
 
 void setup() {
@@ -883,6 +883,9 @@ constexpr espurna::duration::Seconds readInterval() {
     return espurna::duration::Seconds(SENSOR_READ_INTERVAL);
 }
 
+// Same as the default loop delay, when idle time is not adaptive
+constexpr espurna::duration::Milliseconds TickInterval { LOOP_DELAY_TIME };
+
 constexpr size_t ReportEveryMin PROGMEM { SENSOR_REPORT_MIN_EVERY };
 constexpr size_t ReportEveryMax PROGMEM { SENSOR_REPORT_MAX_EVERY };
 
@@ -3581,6 +3584,22 @@ void magnitudes(JsonObject& root) {
     });
 }
 
+STRING_VIEW_INLINE(Module, "sns");
+
+void binary(espurna::web::ws::binary::Writer& out) {
+    const auto count = magnitude::count();
+    out.header(espurna::web::ws::binary::Type::Magnitudes, count);
+
+    for (size_t index = 0; index < count; ++index) {
+        const auto& magnitude = magnitude::get(index);
+        out.u8(index);
+        out.u8(static_cast<uint8_t>(magnitude.last.units));
+        out.u8(magnitude::error(index));
+        out.u8(magnitude.decimals);
+        out.f32(magnitude.last.value);
+    }
+}
+
 void onData(JsonObject& root) {
     if (magnitude::count()) {
         magnitudes(root);
@@ -3621,7 +3640,7 @@ void onAction(uint32_t client_id, const char* action, JsonObject& data) {
 }
 
 void onVisible(JsonObject& root) {
-    wsPayloadModule(root, STRING_VIEW("sns"));
+    wsPayloadModule(root, Module);
     for (auto sensor : internal::sensors) {
         if (isEmon(sensor)) {
             wsPayloadModule(root, STRING_VIEW("emon"));
@@ -3682,7 +3701,8 @@ void setup() {
         .onVisible(onVisible)
         .onData(onData)
         .onAction(onAction)
-        .onKeyCheck(onKeyCheck);
+        .onKeyCheck(onKeyCheck)
+        .onBinary(Module, binary);
 }
 
 } // namespace web
@@ -4179,9 +4199,17 @@ void notify() {
         });
 }
 
+// Reading and notifications are scheduled through the timers, which already wake up the loop.
+// Sensors that poll in tick() need the loop to run at the usual rate
 void tick() {
+    bool ticking { false };
     for (auto sensor : internal::sensors) {
         sensor->tick();
+        ticking = ticking || sensor->ticking();
+    }
+
+    if (ticking) {
+        espurnaLoopDeadline(build::TickInterval);
     }
 }
 
@@ -4435,7 +4463,7 @@ void loop() {
         sensor::post();
 
 #if WEB_SUPPORT
-        wsPost(web::onData);
+        wsPostUpdate(web::Module, web::onData);
 #endif
     }
 }
@@ -184,6 +184,11 @@ class BME680Sensor : public I2CSensor<> {
             return MAGNITUDE_NONE;
         }
 
+        // BSEC run() has its own seconds-long sample interval
+        bool ticking() const override {
+            return false;
+        }
+
         // The maximum allowed time between two `bsec_sensor_control` calls depends on
         // configuration profile `bsec_config_iaq` below.
         void tick() override {
@@ -150,6 +150,13 @@ public:
 
     // Loop-like method, call it in your main loop
     virtual void tick() {
+        _ticking = false;
+    }
+
+    // Whether tick() should be called as often as the loop() without the adaptive idle delay,
+    // e.g. when sensor polls its serial port. Only true when the sensor has its own tick()
+    virtual bool ticking() const {
+        return _ticking;
     }
 
     // Pre-read hook (usually to populate registers with up-to-date data)
@@ -271,6 +278,9 @@ protected:
     int _error = SENSOR_ERROR_OK;
     bool _dirty = true;
     bool _ready = false;
+
+private:
+    bool _ticking = true;
 };
 
 int BaseSensor::ClassKind::_last { 0 };
@@ -491,6 +491,11 @@ public:
         return MAGNITUDE_NONE;
     }
 
+    // tick() only applies the updated ratios
+    bool ticking() const override {
+        return false;
+    }
+
     void tick() override {
         if (_ratios_changed) {
             _calibration = Calibration{
@@ -66,6 +66,11 @@ class MAX6675Sensor : public BaseSensor {
 
         }
 
+        // tick() only reads once per ReadInterval
+        bool ticking() const override {
+            return false;
+        }
+
         // Loop-like method, call it in your main loop
         void tick() override {
             const auto now = TimeSource::now();
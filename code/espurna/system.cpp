@@ -19,6 +19,7 @@ Copyright (C) 2019 by Xose Pérez <xose dot perez at gmail dot com>
 #include <cstring>
 #include <forward_list>
 #include <random>
+#include <utility>
 #include <vector>
 
 extern "C" {
@@ -642,8 +643,144 @@ namespace timer {
 constexpr SystemTimer::Duration SystemTimer::DurationMin;
 constexpr SystemTimer::Duration SystemTimer::DurationMax;
 
+#if SYSTEM_TIMER_WHEEL_SUPPORT
+namespace wheel {
+namespace {
+namespace build {
+
+constexpr duration::Milliseconds tick() {
+    return duration::Milliseconds(SYSTEM_TIMER_WHEEL_TICK);
+}
+
+} // namespace build
+
+// Wheel itself only counts ticks. It is advanced from the main loop, using the elapsed CoreClock time.
+
+namespace internal {
+
+time::CoreClock::time_point last;
+
+} // namespace internal
+
+uint32_t ticks(duration::Milliseconds duration) {
+    const auto tick = build::tick().count();
+    return std::max(uint32_t{ 1 }, (duration.count() + tick - 1) / tick);
+}
+
+void start(Timer& timer, duration::Milliseconds duration, Callback callback, bool repeat) {
+    if (idle()) {
+        internal::last = time::CoreClock::now();
+    }
+
+    timer.start(ticks(duration), std::move(callback), repeat);
+}
+
+#if LOOP_ADAPTIVE_SUPPORT
+void deadline(time::CoreClock::time_point now) {
+    const auto expires = build::tick() * (pending() + 1);
+    const auto elapsed = now - internal::last;
+    espurnaLoopDeadline((expires > elapsed)
+        ? (expires - elapsed)
+        : duration::Milliseconds::zero());
+}
+#endif
+
+void loop() {
+    const auto now = time::CoreClock::now();
+    if (!stats().active) {
+        internal::last = now;
+        return;
+    }
+
+    const auto elapsed = (now - internal::last) / build::tick();
+    if (elapsed) {
+        internal::last += build::tick() * elapsed;
+        advance(elapsed);
+    }
+
+#if LOOP_ADAPTIVE_SUPPORT
+    if (stats().active) {
+        deadline(now);
+    }
+#endif
+}
+
+#if TERMINAL_SUPPORT
+namespace terminal {
+
+PROGMEM_STRING(TimerWheel, "TIMER.WHEEL");
+
+void timer_wheel(::terminal::CommandContext&& ctx) {
+    const auto& stats = wheel::stats();
+    ctx.output.printf_P(PSTR("tick: %u (ms), active: %u, fired: %u, late: %u (max %u ms)\n"),
+        build::tick().count(),
+        stats.active,
+        stats.fired,
+        stats.late,
+        (build::tick() * stats.late_max).count());
+    terminalOK(ctx);
+}
+
+static constexpr ::terminal::Command Commands[] PROGMEM {
+    {TimerWheel, timer_wheel},
+};
+
+void setup() {
+    espurna::terminal::add(Commands);
+}
+
+} // namespace terminal
+#endif
+
+void setup() {
+#if TERMINAL_SUPPORT
+    terminal::setup();
+#endif
+}
+
+} // namespace
+} // namespace wheel
+
 SystemTimer::SystemTimer() = default;
 
+SystemTimer& SystemTimer::operator=(SystemTimer&& other) noexcept {
+    if (this != &other) {
+        stop();
+        _wheel = std::move(other._wheel);
+    }
+
+    return *this;
+}
+
+void SystemTimer::start(duration::Milliseconds duration, Callback callback, bool repeat) {
+    stop();
+    if (!duration.count()) {
+        return;
+    }
+
+    wheel::start(_wheel, duration, std::move(callback), repeat);
+}
+
+void SystemTimer::stop() {
+    _wheel.stop();
+}
+#else
+SystemTimer::SystemTimer() = default;
+
+// SDK timer is disarmed before its storage is replaced
+SystemTimer& SystemTimer::operator=(SystemTimer&& other) noexcept {
+    if (this != &other) {
+        stop();
+        _callback = std::move(other._callback);
+        _armed = std::exchange(other._armed, nullptr);
+        _repeat = other._repeat;
+        _tick = std::move(other._tick);
+        _timer = std::move(other._timer);
+    }
+
+    return *this;
+}
+
 void SystemTimer::start(duration::Milliseconds duration, Callback callback, bool repeat) {
     stop();
     if (!duration.count()) {
@@ -713,6 +850,7 @@ void SystemTimer::callback() {
 
     stop();
 }
+#endif
 
 void SystemTimer::schedule_once(Duration duration, Callback callback) {
     once(duration, [callback]() {
@@ -1148,6 +1286,7 @@ using Type = unsigned long;
 
 struct Counter {
     TimeSource::time_point last;
+    TimeSource::duration idle;
     Type count;
     Type value;
     Type max;
@@ -1156,6 +1295,7 @@ struct Counter {
 namespace internal {
 
 Type load_average { 0 };
+Type idle_ratio { 0 };
 
 } // namespace internal
 
@@ -1163,9 +1303,14 @@ Type value() {
     return internal::load_average;
 }
 
+Type idle() {
+    return internal::idle_ratio;
+}
+
 void loop() {
     static Counter counter {
         .last = (TimeSource::now() - build::Interval),
+        .idle = espurnaLoopIdleTime(),
         .count = 0,
         .value = 0,
         .max = 0
@@ -1178,6 +1323,15 @@ void loop() {
         return;
     }
 
+    // fraction of the interval spent waiting between loop() calls
+    const auto idle = espurnaLoopIdleTime();
+    const auto elapsed = timestamp - counter.last;
+    internal::idle_ratio = elapsed.count()
+        ? std::min<Type>(build::ValueMax, static_cast<Type>(
+            (build::ValueMax * (idle - counter.idle).count()) / elapsed.count()))
+        : 0;
+    counter.idle = idle;
+
     counter.last = timestamp;
     counter.value = counter.count;
     counter.count = 0;
@@ -1553,6 +1707,9 @@ void loop() {
     pending_reset_loop();
     load_average::loop();
     heartbeat::loop();
+#if SYSTEM_TIMER_WHEEL_SUPPORT
+    timer::wheel::loop();
+#endif
 }
 
 void setup() {
@@ -1573,6 +1730,10 @@ void setup() {
 
     system::settings::query::setup();
 
+#if SYSTEM_TIMER_WHEEL_SUPPORT
+    timer::wheel::setup();
+#endif
+
     espurnaRegisterLoop(loop);
     heartbeat::init();
 }
@@ -1620,6 +1781,10 @@ unsigned long systemLoadAverage() {
     return espurna::load_average::value();
 }
 
+unsigned long systemIdleRatio() {
+    return espurna::load_average::idle();
+}
+
 void reset() {
     espurna::reset();
 }
@@ -9,6 +9,7 @@ Copyright (C) 2019 by Xose Pérez <xose dot perez at gmail dot com>
 #pragma once
 
 #include "settings.h"
+#include "system_timer_wheel.h"
 #include "types.h"
 
 #include <chrono>
@@ -212,11 +213,16 @@ struct SystemTimer {
     SystemTimer(const SystemTimer&) = delete;
     SystemTimer& operator=(const SystemTimer&) = delete;
 
+    // Timer that is replaced is always stopped first
     SystemTimer(SystemTimer&&) = default;
-    SystemTimer& operator=(SystemTimer&&) = default;
+    SystemTimer& operator=(SystemTimer&&) noexcept;
 
     bool armed() const {
+#if SYSTEM_TIMER_WHEEL_SUPPORT
+        return _wheel.armed();
+#else
         return _armed != nullptr;
+#endif
     }
 
     explicit operator bool() const {
@@ -242,8 +248,12 @@ private:
     // with current implementation we use division by 2 until we reach value less than this one
     static constexpr Duration DurationMax = Duration(6870947);
 
-    void reset();
     void start(Duration, Callback, bool repeat);
+
+#if SYSTEM_TIMER_WHEEL_SUPPORT
+    wheel::Timer _wheel;
+#else
+    void reset();
     void callback();
 
     struct Tick {
@@ -258,6 +268,7 @@ private:
 
     std::unique_ptr<Tick> _tick;
     std::unique_ptr<os_timer_t> _timer;
+#endif
 };
 
 } // namespace timer
@@ -468,6 +479,7 @@ bool instantLightSleep(uint8_t pin, espurna::sleep::Interrupt);
 bool instantDeepSleep(espurna::sleep::Microseconds);
 
 unsigned long systemLoadAverage();
+unsigned long systemIdleRatio();
 
 espurna::duration::Seconds systemHeartbeatInterval();
 void systemScheduleHeartbeat();
@@ -0,0 +1,272 @@
+/*
+
+Part of the SYSTEM MODULE
+
+Copyright (C) 2019-2021 by Maxim Prokhorov <prokhorov dot max at outlook dot com>
+
+*/
+
+#include <algorithm>
+
+#include "system_timer_wheel.h"
+
+namespace espurna {
+namespace timer {
+namespace wheel {
+namespace {
+
+// Hierarchical timer wheel, every timer is linked into one of the slots.
+// First level slots are one tick apart, every other level slot covers the whole
+// previous level. When the first level wraps around, the next slot of the upper
+// level is re-distributed into the lower ones. Inserting and removing is O(1).
+
+constexpr size_t RootBits { 6 };
+constexpr size_t RootSize { 1 << RootBits };
+constexpr size_t RootMask { RootSize - 1 };
+
+constexpr size_t LevelBits { 6 };
+constexpr size_t LevelSize { 1 << LevelBits };
+constexpr size_t LevelMask { LevelSize - 1 };
+
+constexpr size_t Levels { 3 };
+
+// anything longer than that is split into multiple runs
+constexpr uint32_t MaxTicks { (uint32_t{ 1 } << (RootBits + (Levels * LevelBits))) - 1 };
+
+// every slot is a circular list, sentinel node is never removed
+struct Slot {
+    Slot() {
+        head.prev = &head;
+        head.next = &head;
+    }
+
+    bool empty() const {
+        return head.next == &head;
+    }
+
+    void push_back(Link* node) {
+        node->prev = head.prev;
+        node->next = &head;
+        head.prev->next = node;
+        head.prev = node;
+    }
+
+    void take(Slot& other) {
+        if (other.empty()) {
+            return;
+        }
+
+        head.prev->next = other.head.next;
+        other.head.next->prev = head.prev;
+        other.head.prev->next = &head;
+        head.prev = other.head.prev;
+
+        other.head.prev = &other.head;
+        other.head.next = &other.head;
+    }
+
+    Link head;
+};
+
+namespace internal {
+
+Slot root[RootSize];
+Slot levels[Levels][LevelSize];
+
+uint32_t now { 0 };
+
+Node* running { nullptr };
+Stats stats;
+
+} // namespace internal
+
+void link(Node* node) {
+    const uint32_t delta = node->expires - internal::now;
+
+    Slot* slot;
+    if (static_cast<int32_t>(delta) < 0) {
+        slot = &internal::root[internal::now & RootMask];
+    } else if (delta < RootSize) {
+        slot = &internal::root[node->expires & RootMask];
+    } else {
+        size_t level = 0;
+        size_t shift = RootBits;
+        while ((level < (Levels - 1)) && (delta >= (uint32_t{ 1 } << (shift + LevelBits)))) {
+            ++level;
+            shift += LevelBits;
+        }
+
+        slot = &internal::levels[level][(node->expires >> shift) & LevelMask];
+    }
+
+    slot->push_back(node);
+    ++internal::stats.active;
+}
+
+// current slot is the next one to expire, which happens after exactly one tick
+void schedule(Node* node, uint32_t ticks) {
+    node->remaining = ticks - std::min(ticks, MaxTicks);
+    node->expires = internal::now + std::min(ticks, MaxTicks) - 1;
+    link(node);
+}
+
+// move every node of the upper level slot back into the wheel, returns the slot index
+size_t cascade(size_t level) {
+    const size_t shift = RootBits + (level * LevelBits);
+    const size_t index = (internal::now >> shift) & LevelMask;
+
+    Slot pending;
+    pending.take(internal::levels[level][index]);
+
+    while (!pending.empty()) {
+        auto* node = static_cast<Node*>(pending.head.next);
+        node->prev->next = node->next;
+        node->next->prev = node->prev;
+        --internal::stats.active;
+        link(node);
+    }
+
+    return index;
+}
+
+void fire(Node* node, uint32_t target) {
+    if (node->remaining) {
+        schedule(node, node->remaining);
+        return;
+    }
+
+    const auto late = target - node->expires;
+    if (late > 1) {
+        ++internal::stats.late;
+        internal::stats.late_max = std::max(internal::stats.late_max, late);
+    }
+    ++internal::stats.fired;
+
+    // callback could stop, restart or even destroy the timer,
+    // which is why it is never called from the node itself
+    Callback callback;
+    callback.swap(node->callback);
+
+    if (node->period) {
+        // skip the missed runs, instead of calling the callback again and again
+        node->expires += node->period;
+        if (static_cast<int32_t>(node->expires - target) < 0) {
+            node->expires = target;
+        }
+        link(node);
+    }
+
+    internal::running = node;
+    callback();
+
+    // still the same repeating timer, and not changed by the callback
+    if ((internal::running == node) && node->period && node->linked()) {
+        node->callback.swap(callback);
+    }
+
+    internal::running = nullptr;
+}
+
+void tick(uint32_t target) {
+    const size_t index = internal::now & RootMask;
+    if (!index) {
+        for (size_t level = 0; (level < Levels) && !cascade(level); ++level) {
+        }
+    }
+
+    Slot expired;
+    expired.take(internal::root[index]);
+    ++internal::now;
+
+    while (!expired.empty()) {
+        auto* node = static_cast<Node*>(expired.head.next);
+        node->prev->next = node->next;
+        node->next->prev = node->prev;
+        node->prev = nullptr;
+        node->next = nullptr;
+        --internal::stats.active;
+
+        fire(node, target);
+    }
+}
+
+} // namespace
+
+void add(Node* node, uint32_t ticks, bool repeat) {
+    ticks = std::max(uint32_t{ 1 }, ticks);
+    node->period = repeat ? ticks : 0;
+    schedule(node, ticks);
+}
+
+void unlink(Node* node) {
+    if (node->linked()) {
+        node->prev->next = node->next;
+        node->next->prev = node->prev;
+        node->prev = nullptr;
+        node->next = nullptr;
+        --internal::stats.active;
+    }
+
+    if (internal::running == node) {
+        internal::running = nullptr;
+    }
+}
+
+void advance(uint32_t ticks) {
+    const uint32_t target = internal::now + ticks;
+    while ((internal::now != target) && internal::stats.active) {
+        tick(target);
+    }
+
+    internal::now = target;
+}
+
+uint32_t pending() {
+    uint32_t out = 0;
+    for (; out < RootSize; ++out) {
+        const auto index = (internal::now + out) & RootMask;
+        if (!index || !internal::root[index].empty()) {
+            break;
+        }
+    }
+
+    return out;
+}
+
+bool idle() {
+    return !internal::stats.active && !internal::running;
+}
+
+const Stats& stats() {
+    return internal::stats;
+}
+
+Timer& Timer::operator=(Timer&& other) noexcept {
+    if (this != &other) {
+        stop();
+        _node = std::move(other._node);
+    }
+
+    return *this;
+}
+
+void Timer::start(uint32_t ticks, Callback callback, bool repeat) {
+    stop();
+    if (!_node) {
+        _node.reset(new Node{});
+    }
+
+    _node->callback = std::move(callback);
+    add(_node.get(), ticks, repeat);
+}
+
+void Timer::stop() {
+    if (_node) {
+        unlink(_node.get());
+        _node->callback = Callback();
+    }
+}
+
+} // namespace wheel
+} // namespace timer
+} // namespace espurna
@@ -0,0 +1,89 @@
+/*
+
+Part of the SYSTEM MODULE
+
+Copyright (C) 2019-2021 by Maxim Prokhorov <prokhorov dot max at outlook dot com>
+
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+#include "types.h"
+
+namespace espurna {
+namespace timer {
+namespace wheel {
+
+struct Link {
+    Link* prev { nullptr };
+    Link* next { nullptr };
+};
+
+// Timer wheel entry, intrusive list node
+struct Node : public Link {
+    Callback callback;
+
+    uint32_t expires { 0 };
+    uint32_t remaining { 0 };
+    uint32_t period { 0 };
+
+    bool linked() const {
+        return prev != nullptr;
+    }
+};
+
+struct Stats {
+    size_t active { 0 };
+    uint32_t fired { 0 };
+    uint32_t late { 0 };
+    uint32_t late_max { 0 };
+};
+
+// Wheel only counts ticks, it is up to the caller to convert time into ticks
+// and to advance the wheel when these ticks have elapsed
+void add(Node*, uint32_t ticks, bool repeat);
+void unlink(Node*);
+
+// runs every callback that expires within the next N ticks
+void advance(uint32_t ticks);
+
+// number of ticks until either the closest non-empty slot or the next cascade
+uint32_t pending();
+
+// nothing is linked and no callback is running
+bool idle();
+
+const Stats& stats();
+
+// Owns the wheel node. Node is kept on heap, so the timer object itself can be moved around
+// while the node remains linked. Timer that is replaced or destroyed is always unlinked first
+class Timer {
+public:
+    Timer() = default;
+    ~Timer() {
+        stop();
+    }
+
+    Timer(const Timer&) = delete;
+    Timer& operator=(const Timer&) = delete;
+
+    Timer(Timer&&) noexcept = default;
+    Timer& operator=(Timer&&) noexcept;
+
+    bool armed() const {
+        return _node && _node->linked();
+    }
+
+    void start(uint32_t ticks, Callback, bool repeat);
+    void stop();
+
+private:
+    std::unique_ptr<Node> _node;
+};
+
+} // namespace wheel
+} // namespace timer
+} // namespace espurna
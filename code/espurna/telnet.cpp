@@ -785,6 +785,16 @@ struct Clients {
         return write(reinterpret_cast<const uint8_t*>(data.c_str()), data.length());
     }
 
+    bool writeable() {
+        for (auto& client : _clients) {
+            if (client && client->connected() && !client->writeable()) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
     void process() {
         for (auto& client : _clients) {
             if (client) {
@@ -842,6 +852,14 @@ struct Clients<1> {
         return write(reinterpret_cast<const uint8_t*>(data.c_str()), data.length());
     }
 
+    bool writeable() {
+        if (_client && _client->connected()) {
+            return _client->writeable();
+        }
+
+        return true;
+    }
+
     void process() {
         if (_client) {
             _client->process();
@@ -895,6 +913,10 @@ bool write(StringView data) {
     return internal::clients.write(data);
 }
 
+bool writeable() {
+    return internal::clients.writeable();
+}
+
 void flush() {
     internal::clients.flush();
 }
@@ -1170,6 +1192,10 @@ bool telnetDebugSend(const char* prefix, const char* data) {
     return out > 0;
 }
 
+bool telnetDebugWriteable() {
+    return espurna::telnet::writeable();
+}
+
 void telnetSetup() {
     espurna::telnet::setup();
 }
@@ -13,5 +13,6 @@ Copyright (C) 2017-2019 by Xose Pérez <xose dot perez at gmail dot com>
 uint16_t telnetPort();
 bool telnetConnected();
 bool telnetDebugSend(const char* prefix, const char* data);
+bool telnetDebugWriteable();
 void telnetSetup();
 
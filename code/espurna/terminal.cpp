@@ -463,6 +463,7 @@ void processing_loop() {
     // in a 1second wait (by default)
     std::array<char, build::serialBufferSize()> tmp;
     const auto available = port.available();
+
     port.readBytes(tmp.data(), available);
     buffer.append(tmp.data(), available);
 #else
@@ -508,6 +509,11 @@ void setup() {
 
     internal::stream = port->stream;
     internal::loop = processing_loop;
+
+    // adaptive loop could otherwise wait for much longer than it takes to fill the RX buffer
+    espurnaRegisterLoopWake([]() {
+        return internal::stream->available() > 0;
+    });
 }
 
 } // namespace serial
@@ -16,6 +16,7 @@ Heavily inspired by the Embedis design:
 
 #include <algorithm>
 #include <memory>
+#include <vector>
 
 namespace espurna {
 namespace terminal {
@@ -29,7 +30,44 @@ namespace internal {
 using CommandsView = std::forward_list<Commands>;
 CommandsView commands;
 
+// lookup table sorted by the name hash, built on demand after new commands were added
+// entries with the same hash keep the registration order, most recent ones first
+struct IndexEntry {
+    uint32_t hash;
+    const Command* command;
+};
+
+using Index = std::vector<IndexEntry>;
+Index index;
+
+bool index_stale { true };
+
 } // namespace internal
+
+void build_index() {
+    internal::index.clear();
+    internal::index.reserve(size());
+
+    for (const auto commands : internal::commands) {
+        for (auto it = commands.begin; it != commands.end; ++it) {
+            internal::index.push_back(
+                internal::IndexEntry{
+                    .hash = parser::lowercase_fnv1_hash((*it).name),
+                    .command = it,
+                });
+        }
+    }
+
+    std::stable_sort(
+        internal::index.begin(),
+        internal::index.end(),
+        [](const internal::IndexEntry& lhs, const internal::IndexEntry& rhs) {
+            return lhs.hash < rhs.hash;
+        });
+
+    internal::index_stale = false;
+}
+
 } // namespace
 
 size_t size() {
@@ -56,6 +94,7 @@ CommandNames names() {
 
 void add(Commands commands) {
     internal::commands.emplace_front(std::move(commands));
+    internal::index_stale = true;
 }
 
 void add(StringView name, CommandFunc func) {
@@ -71,16 +110,24 @@ void add(StringView name, CommandFunc func) {
 }
 
 const Command* find(StringView name) {
-    for (const auto commands : internal::commands) {
-        const auto found = std::find_if(
-            commands.begin,
-            commands.end,
-            [&](const Command& command) {
-                return name.equalsIgnoreCase(command.name);
-            });
+    if (internal::index_stale) {
+        build_index();
+    }
+
+    const auto hash = parser::lowercase_fnv1_hash(name);
+
+    auto it = std::lower_bound(
+        internal::index.begin(),
+        internal::index.end(),
+        hash,
+        [](const internal::IndexEntry& entry, uint32_t hash) {
+            return entry.hash < hash;
+        });
 
-        if (found != commands.end) {
-            return found;
+    // hash is only a hint, names still need to be compared in case of a collision
+    for (; (it != internal::index.end()) && ((*it).hash == hash); ++it) {
+        if (name.equalsIgnoreCase((*it).command->name)) {
+            return (*it).command;
         }
     }
 
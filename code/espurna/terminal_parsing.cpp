@@ -478,9 +478,8 @@ CommandLine parse_line(StringView line) {
 // Fowler–Noll–Vo hash function to hash command strings that treats input as lowercase
 // ref: https://en.wikipedia.org/wiki/Fowler%E2%80%93Noll%E2%80%93Vo_hash_function
 //
-// This is here in case `std::unordered_map` becomes viable
-// TODO: afaik, map implementation should handle collisions (however rare they are in our case)
-// if not, we can always roll static commands allocation and just match strings with strcmp_P
+// Used by the commands lookup table. Collisions are rare, but still possible.
+// Lookup is expected to compare names when hashes are equal.
 
 uint32_t lowercase_fnv1_hash(StringView value) {
     constexpr uint32_t fnv_prime = 16777619u;
@@ -36,6 +36,9 @@ enum class Error {
 
 String error(Error);
 
+// case-insensitive FNV-1a hash of the command name
+uint32_t lowercase_fnv1_hash(StringView);
+
 } // namespace parser
 
 struct CommandLine {
@@ -665,6 +665,12 @@ error:
         // Install main loop method and WiFiStatus ping (only works with specific mode)
 
         ::espurnaRegisterLoop(loop);
+
+        // only one output frame is sent per loop(), the rest are sent right after
+        ::espurnaRegisterLoopWake([]() {
+            return (tuyaSerial->available() > 0) || !outputFrames.empty();
+        });
+
         ::wifiRegister([](espurna::wifi::Event event) {
             switch (event) {
             case espurna::wifi::Event::StationConnected:
@@ -230,6 +230,16 @@ void loop() {
     write(*internal::port,
         build::TerminateOut,
         build::Decode);
+
+    // unterminated input is sent after the read interval, even when nothing else arrives
+    if (internal::cursor != internal::buffer.begin()) {
+        espurnaLoopDeadline(build::ReadInterval);
+    }
+}
+
+// either more input or the output queue did not fit into the write window
+bool pending() {
+    return (internal::port->available() > 0) || !internal::queue.empty();
 }
 
 void setup() {
@@ -242,6 +252,7 @@ void setup() {
 
     mqttRegister(mqtt_callback);
     espurnaRegisterLoop(loop);
+    espurnaRegisterLoopWake(pending);
 }
 
 } // namespace
@@ -10,7 +10,13 @@ Copyright (C) 2016-2019 by Xose Pérez <xose dot perez at gmail dot com>
 
 #if WEB_SUPPORT
 
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
 #include <queue>
+#include <utility>
 #include <vector>
 
 #include "datetime.h"
@@ -158,6 +164,7 @@ void _wsUpdateStats(JsonObject& root) {
     root[F("uptime")] = prettyDuration(systemUptime());
     root[F("rssi")] = WiFi.RSSI();
     root[F("loadaverage")] = systemLoadAverage();
+    root[F("idleratio")] = systemIdleRatio();
 #if ADC_MODE_VALUE == ADC_VCC
     root[F("vcc")] = ESP.getVcc();
 #else
@@ -178,6 +185,10 @@ void _wsUpdateTime(JsonObject& root) {
 }
 #endif
 
+STRING_VIEW_INLINE(WsStatusModule, "status");
+
+void _wsSendUpdate(espurna::StringView module, JsonObject& root);
+
 void _wsUpdate(JsonObject& root) {
     _wsUpdateAp(root);
     _wsUpdateSta(root);
@@ -202,7 +213,11 @@ void _wsDoUpdate(const bool connected) {
     auto ts = decltype(_ws_last_update)::clock::now();
     if (ts - _ws_last_update > WsUpdateInterval) {
         _ws_last_update = ts;
-        wsSend(_wsUpdate);
+
+        DynamicJsonBuffer jsonBuffer(512);
+        JsonObject& root = jsonBuffer.createObject();
+        _wsUpdate(root);
+        _wsSendUpdate(WsStatusModule, root);
     }
 }
 
@@ -277,6 +292,1125 @@ void wsPostSequence(const ws_on_send_callback_list_t& cbs) {
     wsPostSequence(0, cbs);
 }
 
+// -----------------------------------------------------------------------------
+// Message buffers
+// -----------------------------------------------------------------------------
+
+// Every outgoing message, JSON, delta updates and binary frames, is written once into a list of fixed-size
+// blocks taken from a small pool. The same list is then queued for one or more clients. Messages larger than
+// one block span several of them and are sent as the websocket text or binary frame followed by continuation frames.
+
+namespace espurna {
+namespace web {
+namespace ws {
+namespace {
+namespace message {
+
+constexpr size_t BlockSize { WS_MESSAGE_BLOCK_SIZE };
+constexpr size_t PoolSize { WS_MESSAGE_POOL_SIZE };
+
+static_assert(BlockSize > 0, "");
+static_assert(PoolSize > 0, "");
+
+struct Stats {
+    size_t hits { 0 };
+    size_t misses { 0 };
+    size_t failed { 0 };
+    size_t chunked { 0 };
+    size_t largest { 0 };
+};
+
+// Only the first block of the message keeps the total length and the reference count
+struct Block {
+    Block* next;
+    size_t length;
+    size_t total;
+    size_t refs;
+    bool pooled;
+    uint8_t data[BlockSize];
+};
+
+// Blocks are allocated when needed and are never freed, up to the pool size. When every pooled block
+// is in use, temporary ones are allocated instead and freed as soon as the message is sent.
+// Blocks are released from the TCP ack callback, which never runs in the middle of the loop() code
+class Pool {
+public:
+    Pool() = default;
+
+    Pool(const Pool&) = delete;
+    Pool& operator=(const Pool&) = delete;
+
+    Block* acquire() {
+        Block* out { nullptr };
+
+        if (_free) {
+            out = _free;
+            _free = out->next;
+            ++_stats.hits;
+        } else if (_allocated < PoolSize) {
+            out = new (std::nothrow) Block;
+            if (out) {
+                out->pooled = true;
+                ++_allocated;
+            }
+        } else {
+            out = new (std::nothrow) Block;
+            if (out) {
+                out->pooled = false;
+                ++_stats.misses;
+            }
+        }
+
+        if (!out) {
+            ++_stats.failed;
+            return nullptr;
+        }
+
+        out->next = nullptr;
+        out->length = 0;
+        out->total = 0;
+        out->refs = 0;
+
+        return out;
+    }
+
+    // Every block of the list is released
+    void release(Block* block) {
+        while (block) {
+            auto* next = block->next;
+            if (block->pooled) {
+                block->next = _free;
+                _free = block;
+            } else {
+                delete block;
+            }
+            block = next;
+        }
+    }
+
+    void record(size_t length) {
+        _stats.largest = std::max(_stats.largest, length);
+        if (length > BlockSize) {
+            ++_stats.chunked;
+        }
+    }
+
+    size_t allocated() const {
+        return _allocated;
+    }
+
+    size_t free() const {
+        size_t out { 0 };
+        for (auto* block = _free; block; block = block->next) {
+            ++out;
+        }
+
+        return out;
+    }
+
+    const Stats& stats() const {
+        return _stats;
+    }
+
+private:
+    Block* _free { nullptr };
+    size_t _allocated { 0 };
+    Stats _stats;
+};
+
+// Postponed callbacks are sent one per loop() and every one of them needs about the same amount of memory.
+// Instead of allocating the first buffer block for every callback, it is kept until the queue is empty
+class BlockCache {
+public:
+    BlockCache() = default;
+
+    BlockCache(const BlockCache&) = delete;
+    BlockCache& operator=(const BlockCache&) = delete;
+
+    void* allocate(size_t size) {
+        if (_block && !_lent && (size <= _size)) {
+            _lent = true;
+            return _block;
+        }
+
+        void* out = std::malloc(size);
+        if (out && !_block) {
+            _block = out;
+            _size = size;
+            _lent = true;
+        }
+
+        return out;
+    }
+
+    void deallocate(void* ptr) {
+        if (ptr && (ptr == _block)) {
+            _lent = false;
+            return;
+        }
+
+        std::free(ptr);
+    }
+
+    void release() {
+        if (_block && !_lent) {
+            std::free(_block);
+            _block = nullptr;
+            _size = 0;
+        }
+    }
+
+private:
+    void* _block { nullptr };
+    size_t _size { 0 };
+    bool _lent { false };
+};
+
+namespace internal {
+
+Pool pool;
+BlockCache cache;
+
+} // namespace internal
+
+struct CachedAllocator {
+    void* allocate(size_t size) {
+        return internal::cache.allocate(size);
+    }
+
+    void deallocate(void* ptr) {
+        internal::cache.deallocate(ptr);
+    }
+};
+
+using JsonBuffer = ArduinoJson::Internals::DynamicJsonBufferBase<CachedAllocator>;
+
+// Shared reference to the message blocks. Blocks go back to the pool when the last reference is gone
+class Payload {
+public:
+    Payload() = default;
+
+    explicit Payload(Block* head) :
+        _head(head)
+    {
+        if (_head) {
+            ++_head->refs;
+        }
+    }
+
+    Payload(const Payload& other) :
+        Payload(other._head)
+    {}
+
+    Payload(Payload&& other) noexcept :
+        _head(std::exchange(other._head, nullptr))
+    {}
+
+    Payload& operator=(Payload other) noexcept {
+        std::swap(_head, other._head);
+        return *this;
+    }
+
+    ~Payload() {
+        if (_head && !--_head->refs) {
+            internal::pool.release(_head);
+        }
+    }
+
+    explicit operator bool() const {
+        return _head != nullptr;
+    }
+
+    const Block* head() const {
+        return _head;
+    }
+
+    size_t length() const {
+        return _head ? _head->total : 0;
+    }
+
+private:
+    Block* _head { nullptr };
+};
+
+// Appends to the last block and takes a new one from the pool when it is full.
+// When any of the blocks could not be allocated, the whole message is discarded
+class Writer final : public Print {
+public:
+    struct Mark {
+        Block* block;
+        size_t length;
+        size_t total;
+    };
+
+    Writer() = default;
+
+    Writer(const Writer&) = delete;
+    Writer& operator=(const Writer&) = delete;
+
+    ~Writer() {
+        internal::pool.release(_head);
+    }
+
+    size_t write(const uint8_t* data, size_t size) override {
+        if (_failed) {
+            return 0;
+        }
+
+        size_t out { 0 };
+        while (out < size) {
+            if (!_tail || (_tail->length == BlockSize)) {
+                if (!next()) {
+                    return 0;
+                }
+            }
+
+            const auto chunk = std::min(size - out, BlockSize - _tail->length);
+            std::memcpy(_tail->data + _tail->length, data + out, chunk);
+            _tail->length += chunk;
+            _total += chunk;
+            out += chunk;
+        }
+
+        return out;
+    }
+
+    size_t write(uint8_t ch) override {
+        return write(&ch, 1);
+    }
+
+    size_t length() const {
+        return _total;
+    }
+
+    bool failed() const {
+        return _failed;
+    }
+
+    // Everything written after the mark can be discarded
+    Mark mark() const {
+        return Mark{
+            .block = _tail,
+            .length = _tail ? _tail->length : 0,
+            .total = _total,
+        };
+    }
+
+    void rollback(const Mark& mark) {
+        if (_failed) {
+            return;
+        }
+
+        if (!mark.block) {
+            internal::pool.release(_head);
+            _head = nullptr;
+            _tail = nullptr;
+        } else {
+            internal::pool.release(mark.block->next);
+            mark.block->next = nullptr;
+            mark.block->length = mark.length;
+            _tail = mark.block;
+        }
+
+        _total = mark.total;
+    }
+
+    // Writer is empty afterwards
+    Payload payload() {
+        Payload out;
+
+        if (!_failed && _total) {
+            _head->total = _total;
+            internal::pool.record(_total);
+            out = Payload(_head);
+        } else {
+            internal::pool.release(_head);
+        }
+
+        _head = nullptr;
+        _tail = nullptr;
+        _total = 0;
+        _failed = false;
+
+        return out;
+    }
+
+private:
+    bool next() {
+        auto* block = internal::pool.acquire();
+        if (!block) {
+            internal::pool.release(_head);
+            _head = nullptr;
+            _tail = nullptr;
+            _failed = true;
+            return false;
+        }
+
+        if (_tail) {
+            _tail->next = block;
+        } else {
+            _head = block;
+        }
+
+        _tail = block;
+        return true;
+    }
+
+    Block* _head { nullptr };
+    Block* _tail { nullptr };
+    size_t _total { 0 };
+    bool _failed { false };
+};
+
+Payload make_payload(JsonObject& root) {
+    Writer writer;
+    root.printTo(writer);
+    return writer.payload();
+}
+
+Payload make_payload(ws_callbacks_t::on_binary_f callback) {
+    Writer out;
+    binary::Writer writer(out);
+    callback(writer);
+    return out.payload();
+}
+
+// Works the same way as the library AsyncWebSocketMultiMessage, sending as much as the TCP window allows and waiting
+// for the ack before sending the next frame. First frame has the message opcode, the rest are continuation frames.
+// Frames are not limited by the block size, data of the adjacent blocks is copied into the same frame
+class Message final : public AsyncWebSocketMessage {
+public:
+    Message(Payload payload, uint8_t opcode) :
+        _payload(std::move(payload)),
+        _block(_payload.head())
+    {
+        _opcode = opcode;
+        _mask = false;
+        _status = _payload
+            ? WS_MSG_SENDING
+            : WS_MSG_ERROR;
+    }
+
+    bool betweenFrames() const override {
+        return _acked == _ack;
+    }
+
+    void ack(size_t length, uint32_t) override {
+        _acked += length;
+        if ((_sent >= _payload.length()) && (_acked >= _ack)) {
+            _status = WS_MSG_SENT;
+        }
+    }
+
+    size_t send(AsyncClient* client) override;
+
+private:
+    // Same as the library, TCP window has to fit the largest header with the mask
+    static constexpr size_t HeaderMax { 8 };
+
+    Payload _payload;
+    const Block* _block;
+    size_t _offset { 0 };
+
+    size_t _sent { 0 };
+    size_t _ack { 0 };
+    size_t _acked { 0 };
+};
+
+size_t Message::send(AsyncClient* client) {
+    if (_status != WS_MSG_SENDING) {
+        return 0;
+    }
+
+    if (_acked < _ack) {
+        return 0;
+    }
+
+    const auto total = _payload.length();
+    if (_sent >= total) {
+        _status = WS_MSG_SENT;
+        return 0;
+    }
+
+    if (!client->canSend()) {
+        return 0;
+    }
+
+    const auto space = client->space();
+    if (space <= HeaderMax) {
+        return 0;
+    }
+
+    const auto length = std::min(total - _sent, space - HeaderMax);
+    const bool first = (_sent == 0);
+    const bool last = (_sent + length) == total;
+
+    uint8_t header[4];
+    size_t header_length { 2 };
+
+    header[0] = (first ? _opcode : static_cast<uint8_t>(WS_CONTINUATION)) & 0x0f;
+    if (last) {
+        header[0] |= 0x80;
+    }
+
+    if (length < 126) {
+        header[1] = static_cast<uint8_t>(length);
+    } else {
+        header[1] = 126;
+        header[2] = (length >> 8) & 0xff;
+        header[3] = length & 0xff;
+        header_length = 4;
+    }
+
+    if (client->add(reinterpret_cast<const char*>(&header[0]), header_length) != header_length) {
+        return 0;
+    }
+
+    // window was checked beforehand. but, if the data still does not fit, frame header is already
+    // queued and there is no way to take it back. same as the library, message is abandoned
+    size_t left { length };
+    while (left) {
+        const auto chunk = std::min(left, _block->length - _offset);
+        if (client->add(reinterpret_cast<const char*>(_block->data + _offset), chunk) != chunk) {
+            _status = WS_MSG_ERROR;
+            return 0;
+        }
+
+        left -= chunk;
+        _offset += chunk;
+        if (_offset == _block->length) {
+            _block = _block->next;
+            _offset = 0;
+        }
+    }
+
+    if (!client->send()) {
+        _status = WS_MSG_ERROR;
+        return 0;
+    }
+
+    _sent += length;
+    _ack += length + header_length;
+
+    return length;
+}
+
+// Library deletes the message when it is sent, or right away when the client is no longer connected
+void send(AsyncWebSocketClient& client, const Payload& payload, uint8_t opcode) {
+    client.message(new (std::nothrow) Message(payload, opcode));
+}
+
+void text(AsyncWebSocketClient& client, const Payload& payload) {
+    send(client, payload, WS_TEXT);
+}
+
+void binary(AsyncWebSocketClient& client, const Payload& payload) {
+    send(client, payload, WS_BINARY);
+}
+
+} // namespace message
+} // namespace
+} // namespace ws
+} // namespace web
+} // namespace espurna
+
+// -----------------------------------------------------------------------------
+// State updates
+// -----------------------------------------------------------------------------
+
+// Updates are compared with what the specific client received last time, using hashes of the serialized values
+// - top-level keys are omitted when the value did not change
+// - for nested objects, only changed members are sent. 'schema' is always sent together with the object,
+//   since webui expects to see it alongside the 'values'
+// - for nested arrays of arrays (i.e. EnumerablePayload 'values'), rows that did not change are replaced with `null`
+//
+// Clients may restrict the list of modules they receive updates for by sending
+// `{"action": "subscribe", "data": {"modules": ["relay", "light"]}}`. Empty list means every module.
+
+namespace espurna {
+namespace web {
+namespace ws {
+namespace {
+namespace update {
+
+constexpr uint32_t FnvBasis { 2166136261ul };
+constexpr uint32_t FnvPrime { 16777619ul };
+
+uint32_t fnv1a(uint32_t hash, const uint8_t* data, size_t size) {
+    for (auto* it = data; it != data + size; ++it) {
+        hash = (hash ^ *it) * FnvPrime;
+    }
+
+    return hash;
+}
+
+// module names and some keys are expected to be in flash
+uint32_t fnv1a(uint32_t hash, StringView value) {
+    for (auto it = value.begin(); it != value.end(); ++it) {
+        hash = (hash ^ static_cast<uint8_t>(pgm_read_byte(it))) * FnvPrime;
+    }
+
+    return hash;
+}
+
+uint32_t fnv1a(StringView value) {
+    return fnv1a(FnvBasis, value);
+}
+
+uint32_t child(uint32_t path, StringView name) {
+    return fnv1a(fnv1a(path, STRING_VIEW("/")), name);
+}
+
+uint32_t child(uint32_t path, size_t index) {
+    const auto value = static_cast<uint32_t>(index);
+    return fnv1a(path, reinterpret_cast<const uint8_t*>(&value), sizeof(value));
+}
+
+struct HashPrint final : public Print {
+    size_t write(const uint8_t* data, size_t size) override {
+        _hash = fnv1a(_hash, data, size);
+        _size += size;
+        return size;
+    }
+
+    size_t write(uint8_t ch) override {
+        return write(&ch, 1);
+    }
+
+    uint32_t hash() const {
+        return _hash;
+    }
+
+    size_t size() const {
+        return _size;
+    }
+
+private:
+    uint32_t _hash { FnvBasis };
+    size_t _size { 0 };
+};
+
+// Hash of the value at the specific path of the payload
+struct Entry {
+    uint32_t path;
+    uint32_t value;
+};
+
+using Entries = std::vector<Entry>;
+
+// What was sent for the specific module, sorted by path
+struct Sent {
+    uint32_t module;
+    Entries entries;
+};
+
+struct Client {
+    uint32_t id;
+
+    // binary frames instead of JSON, when module supports it
+    bool binary;
+
+    // hashed module names, empty list means every module
+    std::vector<uint32_t> modules;
+
+    std::vector<Sent> sent;
+
+    size_t messages;
+    size_t bytes;
+};
+
+struct Stats {
+    size_t updates { 0 };
+    size_t skipped { 0 };
+    size_t full { 0 };
+    size_t sent { 0 };
+};
+
+namespace internal {
+
+std::vector<Client> clients;
+Stats stats;
+
+} // namespace internal
+
+Client* find(uint32_t id) {
+    auto it = std::find_if(
+        internal::clients.begin(), internal::clients.end(),
+        [&](const Client& client) {
+            return client.id == id;
+        });
+
+    if (it != internal::clients.end()) {
+        return &(*it);
+    }
+
+    return nullptr;
+}
+
+void add(uint32_t id) {
+    internal::clients.push_back(
+        Client{
+            .id = id,
+            .binary = false,
+            .modules = {},
+            .sent = {},
+            .messages = 0,
+            .bytes = 0,
+        });
+}
+
+void remove(uint32_t id) {
+    internal::clients.erase(
+        std::remove_if(
+            internal::clients.begin(), internal::clients.end(),
+            [&](const Client& client) {
+                return client.id == id;
+            }),
+        internal::clients.end());
+}
+
+void subscribe(uint32_t id, JsonArray& modules) {
+    auto* client = find(id);
+    if (!client) {
+        return;
+    }
+
+    client->modules.clear();
+    for (auto& module : modules) {
+        if (module.is<const char*>()) {
+            client->modules.push_back(
+                fnv1a(module.as<const char*>()));
+        }
+    }
+
+    // newly subscribed modules need to be sent in full
+    client->sent.clear();
+}
+
+void negotiate(uint32_t id, JsonObject& data) {
+    auto* client = find(id);
+    if (!client) {
+        return;
+    }
+
+    client->binary = (data["version"].as<uint8_t>() == binary::Version);
+    client->sent.clear();
+}
+
+bool subscribed(const Client& client, uint32_t module) {
+    return client.modules.empty()
+        || (std::find(client.modules.begin(), client.modules.end(), module)
+            != client.modules.end());
+}
+
+// Next update of the module is sent to the client in full
+void resync(uint32_t id, uint32_t module) {
+    auto* client = find(id);
+    if (!client) {
+        return;
+    }
+
+    client->sent.erase(
+        std::remove_if(
+            client->sent.begin(), client->sent.end(),
+            [&](const Sent& sent) {
+                return sent.module == module;
+            }),
+        client->sent.end());
+}
+
+Entries& sent(Client& client, uint32_t module) {
+    for (auto& sent : client.sent) {
+        if (sent.module == module) {
+            return sent.entries;
+        }
+    }
+
+    client.sent.push_back(
+        Sent{
+            .module = module,
+            .entries = {},
+        });
+
+    return client.sent.back().entries;
+}
+
+size_t sent_entries(const Client& client) {
+    size_t out { 0 };
+    for (const auto& sent : client.sent) {
+        out += sent.entries.size();
+    }
+
+    return out;
+}
+
+Entries::iterator find(Entries& entries, uint32_t path) {
+    return std::lower_bound(
+        entries.begin(), entries.end(), path,
+        [](const Entry& lhs, uint32_t rhs) {
+            return lhs.path < rhs;
+        });
+}
+
+// Returns true when the value is different from the stored one. When it is, entry is added to the
+// list of changes, which is only stored after the message is actually queued for the client
+bool changed(Entries& entries, Entry entry, Entries& changes) {
+    const auto it = find(entries, entry.path);
+    if ((it != entries.end()) && ((*it).path == entry.path) && ((*it).value == entry.value)) {
+        return false;
+    }
+
+    changes.push_back(entry);
+    return true;
+}
+
+void commit(Entries& entries, const Entries& changes) {
+    for (const auto& entry : changes) {
+        auto it = find(entries, entry.path);
+        if ((it != entries.end()) && ((*it).path == entry.path)) {
+            (*it).value = entry.value;
+            continue;
+        }
+
+        entries.insert(it, entry);
+    }
+}
+
+bool is_rows(JsonVariant& value) {
+    if (!value.is<JsonArray>()) {
+        return false;
+    }
+
+    JsonArray& rows = value.as<JsonArray>();
+    return rows.size() && rows[0].is<JsonArray>();
+}
+
+bool is_schema(const char* key) {
+    return STRING_VIEW("schema") == key;
+}
+
+template <typename T>
+Entry make_entry(uint32_t path, const T& value, size_t& size) {
+    HashPrint out;
+    value.printTo(out);
+    size += out.size();
+
+    return Entry{
+        .path = path,
+        .value = out.hash(),
+    };
+}
+
+// Hashes are gathered once per message, in the same order payload() would visit the values.
+// Also returns the approximate size of the full payload, for the stats
+size_t collect(Entries& out, JsonObject& root) {
+    size_t size { 2 };
+
+    for (auto& kv : root) {
+        const auto path = fnv1a(kv.key);
+        size += strlen(kv.key) + 4;
+
+        if (!kv.value.is<JsonObject>()) {
+            out.push_back(make_entry(path, kv.value, size));
+            continue;
+        }
+
+        JsonObject& object = kv.value.as<JsonObject>();
+        for (auto& member : object) {
+            const auto member_path = child(path, member.key);
+            size += strlen(member.key) + 4;
+
+            if (!is_rows(member.value)) {
+                out.push_back(make_entry(member_path, member.value, size));
+                continue;
+            }
+
+            size_t index { 0 };
+            for (auto& row : member.value.as<JsonArray>()) {
+                out.push_back(make_entry(child(member_path, index++), row, size));
+                size += 1;
+            }
+        }
+    }
+
+    return size;
+}
+
+void append_key(Print& out, bool& first, const char* key) {
+    if (!first) {
+        out.write(',');
+    }
+
+    first = false;
+    out.write('"');
+    out.print(key);
+    out.write('"');
+    out.write(':');
+}
+
+// Objects and rows are written optimistically and discarded when none of the values changed
+// Returns false when nothing was written, or when the message could not be allocated
+bool payload(message::Writer& out, Entries& sent, JsonObject& root, const Entries& entries, Entries& changes) {
+    bool first { true };
+    out.write('{');
+
+    auto entry = entries.begin();
+    for (auto& kv : root) {
+        if (!kv.value.is<JsonObject>()) {
+            if (changed(sent, *entry, changes)) {
+                append_key(out, first, kv.key);
+                kv.value.printTo(out);
+            }
+            ++entry;
+            continue;
+        }
+
+        const auto object_mark = out.mark();
+        const auto object_first = first;
+
+        append_key(out, first, kv.key);
+        out.write('{');
+
+        bool members_first { true };
+        bool any { false };
+
+        JsonObject& object = kv.value.as<JsonObject>();
+        for (auto& member : object) {
+            if (!is_rows(member.value)) {
+                const bool result = changed(sent, *entry, changes);
+                if (result || is_schema(member.key)) {
+                    append_key(out, members_first, member.key);
+                    member.value.printTo(out);
+                }
+                any = any || result;
+                ++entry;
+                continue;
+            }
+
+            const auto rows_mark = out.mark();
+            const auto rows_first = members_first;
+
+            append_key(out, members_first, member.key);
+
+            bool rows_changed { false };
+            bool row_first { true };
+
+            for (auto& row : member.value.as<JsonArray>()) {
+                out.write(row_first ? '[' : ',');
+                row_first = false;
+
+                if (changed(sent, *entry, changes)) {
+                    row.printTo(out);
+                    rows_changed = true;
+                } else {
+                    out.print(F("null"));
+                }
+                ++entry;
+            }
+
+            if (rows_changed) {
+                out.write(']');
+                any = true;
+            } else {
+                out.rollback(rows_mark);
+                members_first = rows_first;
+            }
+        }
+
+        if (any) {
+            out.write('}');
+        } else {
+            out.rollback(object_mark);
+            first = object_first;
+        }
+    }
+
+    out.write('}');
+
+    return !first && !out.failed();
+}
+
+} // namespace update
+} // namespace
+} // namespace ws
+} // namespace web
+} // namespace espurna
+
+void wsPostUpdate(espurna::StringView module, ws_on_send_callback_f&& cb) {
+    _ws_queue.emplace(
+        WsPostponedCallbacks::Update{
+            .module = espurna::web::ws::update::fnv1a(module),
+        },
+        std::move(cb));
+}
+
+void wsPostUpdate(espurna::StringView module, const ws_on_send_callback_f& cb) {
+    _ws_queue.emplace(
+        WsPostponedCallbacks::Update{
+            .module = espurna::web::ws::update::fnv1a(module),
+        },
+        cb);
+}
+
+void wsResync(uint32_t client_id, espurna::StringView module) {
+    espurna::web::ws::update::resync(client_id, espurna::web::ws::update::fnv1a(module));
+}
+
+namespace {
+
+ws_callbacks_t::on_binary_f _wsBinaryCallback(uint32_t module) {
+    for (const auto& entry : _ws_callbacks.on_binary) {
+        if (espurna::web::ws::update::fnv1a(entry.module) == module) {
+            return entry.callback;
+        }
+    }
+
+    return nullptr;
+}
+
+// Binary frame is created once and shared between every client that requested it.
+// Returns true when some of the subscribed clients still expect JSON payload
+bool _wsSendBinaryUpdate(uint32_t module) {
+    using namespace espurna::web::ws;
+
+    const auto callback = _wsBinaryCallback(module);
+
+    bool json { false };
+    message::Payload payload;
+
+    for (auto& client : update::internal::clients) {
+        if (!update::subscribed(client, module)) {
+            continue;
+        }
+
+        if (!client.binary || !callback) {
+            json = true;
+            continue;
+        }
+
+        auto* ws_client = _ws.client(client.id);
+        if (!ws_client || ws_client->queueIsFull()) {
+            continue;
+        }
+
+        if (!payload) {
+            payload = message::make_payload(callback);
+            if (!payload) {
+                break;
+            }
+        }
+
+        ++update::internal::stats.updates;
+        ++client.messages;
+        client.bytes += payload.length();
+        update::internal::stats.sent += payload.length();
+
+        message::binary(*ws_client, payload);
+    }
+
+    return json;
+}
+
+void _wsSendUpdate(uint32_t module, JsonObject& root) {
+    using namespace espurna::web::ws;
+    if (update::internal::clients.empty()) {
+        return;
+    }
+
+    const bool binary = _wsBinaryCallback(module) != nullptr;
+
+    update::Entries entries;
+    const auto full = update::collect(entries, root);
+
+    update::Entries changes;
+
+    for (auto& client : update::internal::clients) {
+        if (!update::subscribed(client, module)) {
+            continue;
+        }
+
+        if (binary && client.binary) {
+            continue;
+        }
+
+        // keep the stored state as-is when message can't be sent, changes will be sent with the next update
+        auto* ws_client = _ws.client(client.id);
+        if (!ws_client || ws_client->queueIsFull()) {
+            continue;
+        }
+
+        ++update::internal::stats.updates;
+        update::internal::stats.full += full;
+
+        auto& sent = update::sent(client, module);
+
+        changes.clear();
+
+        message::Writer writer;
+        if (!update::payload(writer, sent, root, entries, changes)) {
+            ++update::internal::stats.skipped;
+            continue;
+        }
+
+        const auto payload = writer.payload();
+        ++client.messages;
+        client.bytes += payload.length();
+        update::internal::stats.sent += payload.length();
+
+        // connected client with the free queue slot always accepts the message
+        message::text(*ws_client, payload);
+        update::commit(sent, changes);
+    }
+}
+
+void _wsSendUpdate(espurna::StringView module, JsonObject& root) {
+    _wsSendUpdate(espurna::web::ws::update::fnv1a(module), root);
+}
+
+#if TERMINAL_SUPPORT
+PROGMEM_STRING(WsCommandUpdates, "WS.UPDATES");
+
+void _wsCommandUpdates(::terminal::CommandContext&& ctx) {
+    using namespace espurna::web::ws;
+
+    for (const auto& client : update::internal::clients) {
+        ctx.output.printf_P(PSTR("#%u %s modules %u entries %u messages %u bytes %u\n"),
+            client.id, client.binary ? PSTR("binary") : PSTR("json"),
+            client.modules.size(), update::sent_entries(client),
+            client.messages, client.bytes);
+    }
+
+    const auto& stats = update::internal::stats;
+    ctx.output.printf_P(PSTR("updates %u (%u skipped), full ~%u bytes, sent %u bytes\n"),
+        stats.updates, stats.skipped, stats.full, stats.sent);
+
+    terminalOK(ctx);
+}
+
+PROGMEM_STRING(WsCommandPool, "WS.POOL");
+
+void _wsCommandPool(::terminal::CommandContext&& ctx) {
+    using namespace espurna::web::ws;
+
+    const auto& pool = message::internal::pool;
+    ctx.output.printf_P(PSTR("blocks %u of %u bytes (%u allocated, %u free)\n"),
+        message::PoolSize, message::BlockSize, pool.allocated(), pool.free());
+
+    const auto& stats = pool.stats();
+    ctx.output.printf_P(PSTR("hits %u misses %u failed %u chunked %u largest %u bytes\n"),
+        stats.hits, stats.misses, stats.failed, stats.chunked, stats.largest);
+
+    terminalOK(ctx);
+}
+
+static constexpr ::terminal::Command WsCommands[] PROGMEM {
+    {WsCommandUpdates, _wsCommandUpdates},
+    {WsCommandPool, _wsCommandPool},
+};
+#endif
+
+} // namespace
+
 // -----------------------------------------------------------------------------
 
 ws_callbacks_t& ws_callbacks_t::onVisible(ws_callbacks_t::on_send_f cb) {
@@ -304,6 +1438,15 @@ ws_callbacks_t& ws_callbacks_t::onKeyCheck(ws_callbacks_t::on_keycheck_f cb) {
     return *this;
 }
 
+ws_callbacks_t& ws_callbacks_t::onBinary(espurna::StringView module, ws_callbacks_t::on_binary_f cb) {
+    on_binary.push_back(
+        on_binary_t{
+            .module = module,
+            .callback = cb,
+        });
+    return *this;
+}
+
 // -----------------------------------------------------------------------------
 // WS authentication
 // -----------------------------------------------------------------------------
@@ -587,6 +1730,17 @@ void _wsParse(AsyncWebSocketClient* client, uint8_t* payload, size_t length) {
                 return;
             }
 
+            if (strcmp(action, "binary") == 0) {
+                espurna::web::ws::update::negotiate(client_id, data);
+                return;
+            }
+
+            if (strcmp(action, "subscribe") == 0) {
+                JsonArray& modules = data["modules"];
+                espurna::web::ws::update::subscribe(client_id, modules);
+                return;
+            }
+
             for (auto& callback : _ws_callbacks.on_action) {
                 callback(client_id, action, data);
             }
@@ -655,6 +1809,7 @@ void _wsOnConnected(JsonObject& root) {
 
     root[F("webPort")] = getSetting(F("webPort"), espurna::web::ws::build::port());
     root[F("wsAuth")] = getSetting(F("wsAuth"), espurna::web::ws::build::authentication());
+    root[F("wsBinary")] = espurna::web::ws::binary::Version;
 }
 
 void _wsConnected(uint32_t client_id) {
@@ -693,6 +1848,7 @@ void _wsEvent(AsyncWebSocket* server, AsyncWebSocketClient* client, AwsEventType
         DEBUG_MSG_P(PSTR("[WEBSOCKET] #%u connected, ip: %s, url: %s\n"),
             client->id(), ip.c_str(), server->url());
 
+        espurna::web::ws::update::add(client->id());
         _wsConnected(client->id());
         _wsResetUpdateTimer();
 
@@ -702,6 +1858,7 @@ void _wsEvent(AsyncWebSocket* server, AsyncWebSocketClient* client, AwsEventType
 
     case WS_EVT_DISCONNECT:
         DEBUG_MSG_P(PSTR("[WEBSOCKET] #%u disconnected\n"), client->id());
+        espurna::web::ws::update::remove(client->id());
         if (client->_tempObject) {
             auto* ptr = reinterpret_cast<WebSocketIncomingBuffer*>(client->_tempObject);
             delete ptr;
@@ -741,7 +1898,11 @@ void _wsHandlePostponedCallbacks(bool connected) {
         return;
     }
 
-    if (_ws_queue.empty()) return;
+    if (_ws_queue.empty()) {
+        espurna::web::ws::message::internal::cache.release();
+        return;
+    }
+
     auto& callbacks = _ws_queue.front();
 
     // avoid stalling forever when can't send anything
@@ -771,15 +1932,23 @@ void _wsHandlePostponedCallbacks(bool connected) {
         }
     }
 
+    // module updates may not need any JSON payload, when every subscribed client receives binary frames
+    if (callbacks.module() && !_wsSendBinaryUpdate(callbacks.module())) {
+        _ws_queue.pop();
+        return;
+    }
+
     // XXX: block allocation will try to create *2 next time,
     // likely failing and causing wsSend to reference empty objects
     // XXX: arduinojson6 will not do this, but we may need to use per-callback buffers
     constexpr size_t WsQueueJsonBufferSize = 3192;
-    DynamicJsonBuffer jsonBuffer(WsQueueJsonBufferSize);
+    espurna::web::ws::message::JsonBuffer jsonBuffer(WsQueueJsonBufferSize);
     JsonObject& root = jsonBuffer.createObject();
 
     callbacks.send(root);
-    if (callbacks.id()) {
+    if (callbacks.module()) {
+        _wsSendUpdate(callbacks.module(), root);
+    } else if (callbacks.id()) {
         wsSend(callbacks.id(), root);
     } else {
         wsSend(root);
@@ -837,14 +2006,18 @@ ws_callbacks_t& wsRegister() {
 }
 
 void wsSend(JsonObject& root) {
-    // Note: 'measurement' tries to serialize json contents byte-by-byte,
-    //       which is somewhat costly, but likely unavoidable for us.
-    size_t len = root.measureLength();
-    AsyncWebSocketMessageBuffer* buffer = _ws.makeBuffer(len);
+    using namespace espurna::web::ws;
 
-    if (buffer) {
-        root.printTo(reinterpret_cast<char*>(buffer->get()), len + 1);
-        _ws.textAll(buffer);
+    const auto payload = message::make_payload(root);
+    if (!payload) {
+        return;
+    }
+
+    for (const auto& client : update::internal::clients) {
+        auto* ws_client = _ws.client(client.id);
+        if (ws_client) {
+            message::text(*ws_client, payload);
+        }
     }
 }
 
@@ -852,12 +2025,9 @@ void wsSend(uint32_t client_id, JsonObject& root) {
     AsyncWebSocketClient* client = _ws.client(client_id);
     if (client == nullptr) return;
 
-    size_t len = root.measureLength();
-    AsyncWebSocketMessageBuffer* buffer = _ws.makeBuffer(len);
-
-    if (buffer) {
-        root.printTo(reinterpret_cast<char*>(buffer->get()), len + 1);
-        client->text(buffer);
+    const auto payload = espurna::web::ws::message::make_payload(root);
+    if (payload) {
+        espurna::web::ws::message::text(*client, payload);
     }
 }
 
@@ -909,6 +2079,10 @@ void wsSetup() {
         .onConnected(_wsOnConnected)
         .onKeyCheck(_wsOnKeyCheck);
 
+#if TERMINAL_SUPPORT
+    espurna::terminal::add(WsCommands);
+#endif
+
     espurnaRegisterLoop(_wsLoop);
 }
 
@@ -11,6 +11,7 @@ Copyright (C) 2019 by Maxim Prokhorov <prokhorov dot max at outlook dot com>
 
 #include <ArduinoJson.h>
 
+#include <cstring>
 #include <functional>
 #include <vector>
 
@@ -31,6 +32,62 @@ Copyright (C) 2019 by Maxim Prokhorov <prokhorov dot max at outlook dot com>
 // - on_action will be ran whenever we receive special JSON 'action' payload
 // - on_keycheck will be used to determine if we can handle specific settings keys
 
+// Optional binary telemetry frames, which clients may request instead of the JSON state updates.
+// Every frame starts with the header {u8 version, u8 type, u16 count}, followed by the type-specific data.
+// Numbers are little-endian, floats are IEEE754 single precision.
+// - Magnitudes: `count` entries of {u8 index, u8 units, u8 error, u8 decimals, f32 value}
+// - Relays: `count` entries of {u8 index, u8 status, u8 lock}
+// - Light: {u8 state, u16 brightness}, followed by `count` channel values as {u16 value}
+
+namespace espurna {
+namespace web {
+namespace ws {
+namespace binary {
+
+constexpr uint8_t Version { 1 };
+
+enum class Type : uint8_t {
+    Magnitudes = 1,
+    Relays = 2,
+    Light = 3,
+};
+
+struct Writer {
+    explicit Writer(Print& out) :
+        _out(out)
+    {}
+
+    void header(Type type, size_t count) {
+        u8(Version);
+        u8(static_cast<uint8_t>(type));
+        u16(count);
+    }
+
+    void u8(uint8_t value) {
+        _out.write(value);
+    }
+
+    void u16(uint16_t value) {
+        u8(value & 0xff);
+        u8((value >> 8) & 0xff);
+    }
+
+    void f32(float value) {
+        uint32_t out;
+        std::memcpy(&out, &value, sizeof(out));
+        u16(out & 0xffff);
+        u16((out >> 16) & 0xffff);
+    }
+
+private:
+    Print& _out;
+};
+
+} // namespace binary
+} // namespace ws
+} // namespace web
+} // namespace espurna
+
 using ws_on_send_callback_f = std::function<void(JsonObject& root)>;
 using ws_on_action_callback_f = std::function<void(uint32_t client_id, const char* action, JsonObject& data)>;
 using ws_on_keycheck_callback_f = std::function<bool(espurna::StringView key, const JsonVariant& value)>;
@@ -52,12 +109,22 @@ struct ws_callbacks_t {
     using on_keycheck_f = bool(*)(espurna::StringView, const JsonVariant&);
     ws_callbacks_t& onKeyCheck(on_keycheck_f);
 
+    // module name should be the same one used with wsPostUpdate()
+    using on_binary_f = void(*)(espurna::web::ws::binary::Writer&);
+    ws_callbacks_t& onBinary(espurna::StringView module, on_binary_f);
+
+    struct on_binary_t {
+        espurna::StringView module;
+        on_binary_f callback;
+    };
+
     ws_on_send_callback_list_t on_visible;
     ws_on_send_callback_list_t on_connected;
     ws_on_send_callback_list_t on_data;
 
     ws_on_action_callback_list_t on_action;
     ws_on_keycheck_callback_list_t on_keycheck;
+    std::vector<on_binary_t> on_binary;
 };
 
 // Postponed debug messages. best-effort, will not be re-scheduled when ws queue is full
@@ -92,6 +159,19 @@ void wsPostSequence(ws_on_send_callback_list_t&& cbs);
 void wsPostSequence(uint32_t client_id, const ws_on_send_callback_list_t& cbs);
 void wsPostSequence(const ws_on_send_callback_list_t& cbs);
 
+// Postponed module state updates, e.g. relay status or sensor readings.
+// Only sent to the clients that are subscribed to the module (by default, client is subscribed to every one)
+// Each client receives only the parts of the payload that changed since the last update it received
+// (see ws.cpp for the exact rules)
+// Clients that requested binary frames will receive those instead, when the module registered onBinary()
+
+void wsPostUpdate(espurna::StringView module, ws_on_send_callback_f&& cb);
+void wsPostUpdate(espurna::StringView module, const ws_on_send_callback_f& cb);
+
+// Forget what the client received for the module, so the next update is sent in full.
+// E.g. after the client action was rejected, when the module state did not change and the client still shows the requested one
+void wsResync(uint32_t client_id, espurna::StringView module);
+
 // Immmediatly try to serialize and send JsonObject&
 // May silently fail when network is busy sending previous requests, or there's not enough RAM
 
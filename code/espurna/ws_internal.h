@@ -68,6 +68,18 @@ public:
         WsPostponedCallbacks(0, std::forward<T>(cb))
     {}
 
+    // state updates are sent to every client, but only when it is subscribed to the module
+    struct Update {
+        uint32_t module;
+    };
+
+    template <typename T>
+    WsPostponedCallbacks(Update update, T&& cb) :
+        WsPostponedCallbacks(0, std::forward<T>(cb))
+    {
+        _module = update.module;
+    }
+
     WsPostponedCallbacks(uint32_t client_id, const ws_on_send_callback_list_t& cbs, Mode mode = Mode::Sequence) :
         _client_id(client_id),
         _timestamp(TimeSource::now()),
@@ -121,10 +133,15 @@ public:
         return _timestamp;
     }
 
+    uint32_t module() const {
+        return _module;
+    }
+
 private:
     uint32_t _client_id;
     TimeSource::time_point _timestamp;
     Mode _mode;
+    uint32_t _module { 0 };
 
     std::unique_ptr<ws_on_send_callback_list_t> _storage;
 
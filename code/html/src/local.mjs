@@ -120,6 +120,7 @@ export function init() {
         core: 'WEB',
         heap: 999999,
         loadaverage: 99,
+        idleratio: 42,
         vcc: '3.3',
         mqttStatus: true,
         ntpStatus: true,
@@ -71,6 +71,11 @@ function initToggle(id) {
  */
 function updateFromState(states, schema) {
     states.forEach((state, id) => {
+        // unchanged since the last update
+        if (state === null) {
+            return;
+        }
+
         const elem = /** @type {!HTMLInputElement} */
             (document.querySelector(`input[name='relay'][data-id='${id}']`));
 
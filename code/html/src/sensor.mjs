@@ -554,6 +554,11 @@ function initMagnitudesSettings(values, schema) {
  */
 function updateMagnitudes(values, schema) {
     values.forEach((value, id) => {
+        // unchanged since the last update
+        if (value === null) {
+            return;
+        }
+
         const props = Magnitudes.properties.get(id);
         if (!props) {
             return;
@@ -599,6 +604,10 @@ function updateEnergyInput(input, saved) {
  */
 function updateEnergy(values, schema) {
     values.forEach((value) => {
+        if (value === null) {
+            return;
+        }
+
         const energy = fromSchema(value, schema);
 
         const props = Magnitudes.properties.get(
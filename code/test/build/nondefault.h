@@ -21,3 +21,4 @@
 #define RELAY_PROVIDER_DUAL_SUPPORT 1
 #define RELAY_PROVIDER_STM_SUPPORT 1
 #define IFAN_SUPPORT 1
+#define GROUP_SYNC_SUPPORT 1
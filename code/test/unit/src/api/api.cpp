@@ -0,0 +1,206 @@
+#include <unity.h>
+#include <Arduino.h>
+
+#include <espurna/api_path.h>
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+namespace espurna {
+namespace api {
+namespace {
+
+namespace test {
+
+struct Routes {
+    void add(String pattern) {
+        patterns.push_back(std::make_unique<String>(std::move(pattern)));
+        parts.emplace_back(*patterns.back());
+        TEST_ASSERT_EQUAL(parts.size() - 1, tree.add(parts.back()));
+    }
+
+    // the way separate handlers would've been checked
+    size_t linear(const PathParts& path) const {
+        for (size_t index = 0; index < parts.size(); ++index) {
+            if (parts[index].match(path)) {
+                return index;
+            }
+        }
+
+        return PathTree::Invalid;
+    }
+
+    std::vector<std::unique_ptr<String>> patterns;
+    std::vector<PathParts> parts;
+    PathTree tree;
+};
+
+void test_literal() {
+    Routes routes;
+    routes.add("/api/relay");
+    routes.add("/api/relay/0");
+    routes.add("/api/light");
+    routes.add("/api/rgb");
+
+    TEST_ASSERT_EQUAL(0, routes.tree.find(PathParts("/api/relay")));
+    TEST_ASSERT_EQUAL(1, routes.tree.find(PathParts("/api/relay/0")));
+    TEST_ASSERT_EQUAL(2, routes.tree.find(PathParts("/api/light")));
+    TEST_ASSERT_EQUAL(3, routes.tree.find(PathParts("/api/rgb")));
+
+    TEST_ASSERT_EQUAL(PathTree::Invalid, routes.tree.find(PathParts("/api/relay/1")));
+    TEST_ASSERT_EQUAL(PathTree::Invalid, routes.tree.find(PathParts("/api/relays")));
+    TEST_ASSERT_EQUAL(PathTree::Invalid, routes.tree.find(PathParts("/api/rel")));
+    TEST_ASSERT_EQUAL(PathTree::Invalid, routes.tree.find(PathParts("/api")));
+    TEST_ASSERT_EQUAL(PathTree::Invalid, routes.tree.find(PathParts("api/relay")));
+    TEST_ASSERT_EQUAL(PathTree::Invalid, routes.tree.find(PathParts("")));
+}
+
+void test_wildcards() {
+    Routes routes;
+    routes.add("/api/relay/+");
+    routes.add("/api/relay/0");
+    routes.add("/api/+/+/value");
+    routes.add("/api/event/#");
+    routes.add("/api/#");
+
+    TEST_ASSERT_EQUAL(0, routes.tree.find(PathParts("/api/relay/0")));
+    TEST_ASSERT_EQUAL(0, routes.tree.find(PathParts("/api/relay/5")));
+    TEST_ASSERT_EQUAL(2, routes.tree.find(PathParts("/api/relay/5/value")));
+    TEST_ASSERT_EQUAL(2, routes.tree.find(PathParts("/api/sensor/5/value")));
+    TEST_ASSERT_EQUAL(3, routes.tree.find(PathParts("/api/event")));
+    TEST_ASSERT_EQUAL(3, routes.tree.find(PathParts("/api/event/one/two/three")));
+    TEST_ASSERT_EQUAL(4, routes.tree.find(PathParts("/api/relay/5/something")));
+    TEST_ASSERT_EQUAL(4, routes.tree.find(PathParts("/api")));
+
+    // wildcards are not values
+    TEST_ASSERT_EQUAL(PathTree::Invalid, routes.tree.find(PathParts("/api/relay/+")));
+    TEST_ASSERT_EQUAL(PathTree::Invalid, routes.tree.find(PathParts("/api/#")));
+
+    String pattern("/api/+/+/value");
+    PathParts parts(pattern);
+
+    String path("/api/sensor/5/value");
+    PathParts value(path);
+
+    TEST_ASSERT(PathParts::wildcard(parts, value, 0)
+        .equals(STRING_VIEW("sensor")));
+    TEST_ASSERT(PathParts::wildcard(parts, value, 1)
+        .equals(STRING_VIEW("5")));
+}
+
+void test_invalid() {
+    PathTree tree;
+    TEST_ASSERT_EQUAL(PathTree::Invalid, tree.add(PathParts("/api/relay+")));
+    TEST_ASSERT_EQUAL(PathTree::Invalid, tree.add(PathParts("/api/#/relay")));
+    TEST_ASSERT_EQUAL(0, tree.routes());
+}
+
+// imitate a device with a lot of per-index endpoints, both with and without wildcards
+
+void make_routes(Routes& routes, size_t count) {
+    const char* const prefixes[] {
+        "/api/relay/", "/api/pulse/", "/api/timer/", "/api/lock/",
+        "/api/channel/", "/api/schedule/", "/api/event/", "/api/magnitude/",
+    };
+
+    size_t index { 0 };
+    while (routes.parts.size() < count) {
+        for (auto prefix : prefixes) {
+            routes.add(String(prefix) + String(index, 10));
+        }
+        ++index;
+    }
+
+    for (auto prefix : prefixes) {
+        routes.add(String(prefix) + '+');
+    }
+
+    routes.add("/api/list");
+    routes.add("/api/rpc");
+}
+
+void test_same_as_linear() {
+    Routes routes;
+    make_routes(routes, 200);
+
+    const char* const paths[] {
+        "/api/relay/0", "/api/relay/24", "/api/relay/25", "/api/relay/",
+        "/api/event/3", "/api/magnitude/99", "/api/lock/abc", "/api/list",
+        "/api/rpc", "/api/rpc/0", "/api/unknown", "/api", "/", "/api/channel/1/2",
+    };
+
+    for (auto path : paths) {
+        String tmp(path);
+        PathParts parts(tmp);
+        TEST_ASSERT_EQUAL_MESSAGE(
+            routes.linear(parts), routes.tree.find(parts), path);
+    }
+}
+
+using Clock = std::chrono::steady_clock;
+using Duration = std::chrono::duration<double, std::micro>;
+
+template <typename T>
+Duration measure(size_t iterations, T&& callback) {
+    const auto start = Clock::now();
+    for (size_t iteration = 0; iteration < iterations; ++iteration) {
+        callback();
+    }
+
+    return std::chrono::duration_cast<Duration>(Clock::now() - start) / iterations;
+}
+
+void test_benchmark() {
+    Routes routes;
+    make_routes(routes, 400);
+
+    std::vector<String> paths;
+    for (const auto& pattern : routes.patterns) {
+        paths.push_back(*pattern);
+    }
+    paths.push_back("/api/relay/12345");
+    paths.push_back("/api/nothing/here");
+
+    constexpr size_t Iterations { 50 };
+
+    size_t linear_found { 0 };
+    const auto linear = measure(Iterations, [&]() {
+        for (const auto& path : paths) {
+            linear_found += (routes.linear(PathParts(path)) != PathTree::Invalid);
+        }
+    });
+
+    size_t tree_found { 0 };
+    const auto tree = measure(Iterations, [&]() {
+        for (const auto& path : paths) {
+            tree_found += (routes.tree.find(PathParts(path)) != PathTree::Invalid);
+        }
+    });
+
+    TEST_ASSERT_EQUAL(linear_found, tree_found);
+
+    char buffer[128];
+    std::snprintf(buffer, sizeof(buffer),
+        "%zu routes, %zu nodes, %zu paths: linear %.1fus, tree %.1fus",
+        routes.tree.routes(), routes.tree.nodes(), paths.size(),
+        linear.count(), tree.count());
+    TEST_MESSAGE(buffer);
+}
+
+} // namespace test
+} // namespace
+} // namespace api
+} // namespace espurna
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    using namespace espurna::api::test;
+    RUN_TEST(test_literal);
+    RUN_TEST(test_wildcards);
+    RUN_TEST(test_invalid);
+    RUN_TEST(test_same_as_linear);
+    RUN_TEST(test_benchmark);
+    return UNITY_END();
+}
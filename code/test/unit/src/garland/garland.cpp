@@ -0,0 +1,277 @@
+#include <unity.h>
+#include <Arduino.h>
+
+#include <espurna/garland/bitstream.h>
+#include <espurna/garland/pixels.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iterator>
+#include <vector>
+
+namespace espurna {
+namespace garland {
+namespace pixels {
+namespace {
+
+namespace test {
+
+struct Color {
+    uint8_t r;
+    uint8_t g;
+    uint8_t b;
+
+    // previous implementation of the scene transition
+    Color interpolate(Color color, float x) const {
+        int r0 = x * (color.r - r) + r;
+        int g0 = x * (color.g - g) + g;
+        int b0 = x * (color.b - b) + b;
+        return Color{
+            static_cast<uint8_t>(r0),
+            static_cast<uint8_t>(g0),
+            static_cast<uint8_t>(b0)};
+    }
+};
+
+Lut::Table make_gamma() {
+    Lut::Table out;
+    for (size_t index = 0; index < out.size(); ++index) {
+        out[index] = std::lround(std::pow(index / 255.0, 2.2) * 255.0);
+    }
+
+    return out;
+}
+
+const Lut::Table Gamma = make_gamma();
+
+std::vector<Color> make_leds(size_t size, unsigned seed) {
+    std::srand(seed);
+
+    std::vector<Color> out;
+    out.reserve(size);
+    for (size_t index = 0; index < size; ++index) {
+        out.push_back(Color{
+            static_cast<uint8_t>(std::rand()),
+            static_cast<uint8_t>(std::rand()),
+            static_cast<uint8_t>(std::rand())});
+    }
+
+    return out;
+}
+
+uint8_t red(Packed value) {
+    return (value >> 16) & 0xff;
+}
+
+uint8_t green(Packed value) {
+    return (value >> 8) & 0xff;
+}
+
+uint8_t blue(Packed value) {
+    return value & 0xff;
+}
+
+// previous implementation of the scene output, using float interpolation and lut per channel
+void legacy(const Color* current, const Color* previous, size_t size, float transc, uint8_t brightness, Packed* out) {
+    for (size_t index = 0; index < size; ++index) {
+        Color c = (transc > 0)
+            ? current[index].interpolate(previous[index], transc)
+            : current[index];
+        uint8_t r = (int)(Gamma[c.r]) * brightness / 256;
+        uint8_t g = (int)(Gamma[c.g]) * brightness / 256;
+        uint8_t b = (int)(Gamma[c.b]) * brightness / 256;
+        out[index] = pack(r, g, b);
+    }
+}
+
+void test_pack() {
+    TEST_ASSERT_EQUAL_HEX32(0x00123456, pack(0x12, 0x34, 0x56));
+    TEST_ASSERT_EQUAL_HEX32(0x00ffffff, pack(Color{255, 255, 255}));
+    TEST_ASSERT_EQUAL_HEX32(0, pack(Color{0, 0, 0}));
+}
+
+void test_blend() {
+    const auto from = pack(255, 0, 100);
+    const auto to = pack(0, 255, 200);
+
+    TEST_ASSERT_EQUAL_HEX32(from, blend(from, to, 0));
+    TEST_ASSERT_EQUAL_HEX32(to, blend(from, to, WeightMax));
+
+    const auto half = blend(from, to, WeightMax / 2);
+    TEST_ASSERT_EQUAL(127, red(half));
+    TEST_ASSERT_EQUAL(127, green(half));
+    TEST_ASSERT_EQUAL(150, blue(half));
+
+    // every lane stays within its own 8 bits
+    const auto white = pack(255, 255, 255);
+    for (Weight weight = 0; weight <= WeightMax; ++weight) {
+        TEST_ASSERT_EQUAL_HEX32(white, blend(white, white, weight));
+    }
+}
+
+void test_blend_float() {
+    const auto current = make_leds(1000, 1);
+    const auto previous = make_leds(1000, 2);
+
+    for (Weight weight = 0; weight <= WeightMax; weight += 16) {
+        const float x = static_cast<float>(weight) / WeightMax;
+        for (size_t index = 0; index < current.size(); ++index) {
+            const auto expected = current[index].interpolate(previous[index], x);
+            const auto result = blend(pack(current[index]), pack(previous[index]), weight);
+
+            TEST_ASSERT_INT_WITHIN(1, expected.r, red(result));
+            TEST_ASSERT_INT_WITHIN(1, expected.g, green(result));
+            TEST_ASSERT_INT_WITHIN(1, expected.b, blue(result));
+        }
+    }
+}
+
+void test_lut() {
+    Lut lut;
+    lut.update(Gamma, 255);
+    TEST_ASSERT_EQUAL(0, lut[0]);
+    TEST_ASSERT_EQUAL((255 * 255) / 256, lut[255]);
+
+    lut.update(Gamma, 0);
+    TEST_ASSERT_EQUAL_HEX32(0, lut(pack(255, 255, 255)));
+
+    lut.update(Gamma, 128);
+    TEST_ASSERT_EQUAL_HEX32(
+        pack(Gamma[10] * 128 / 256, Gamma[200] * 128 / 256, Gamma[255] * 128 / 256),
+        lut(pack(10, 200, 255)));
+}
+
+void test_render() {
+    const auto current = make_leds(300, 3);
+    const auto previous = make_leds(300, 4);
+
+    Lut lut;
+    lut.update(Gamma, 200);
+
+    std::vector<Packed> expected(current.size());
+    legacy(current.data(), previous.data(), current.size(), 0.0f, 200, expected.data());
+
+    std::vector<Packed> result(current.size());
+    render(current.data(), previous.data(), current.size(), 0, lut,
+        [&](size_t index, Packed pixel) {
+            result[index] = pixel;
+        });
+
+    // without transition, output is exactly the same
+    TEST_ASSERT_EQUAL_HEX32_ARRAY(expected.data(), result.data(), expected.size());
+
+    legacy(current.data(), previous.data(), current.size(), 0.5f, 200, expected.data());
+    render(current.data(), previous.data(), current.size(), WeightMax / 2, lut,
+        [&](size_t index, Packed pixel) {
+            result[index] = pixel;
+        });
+
+    // gamma could stretch the rounding difference a bit
+    for (size_t index = 0; index < expected.size(); ++index) {
+        TEST_ASSERT_INT_WITHIN(4, red(expected[index]), red(result[index]));
+        TEST_ASSERT_INT_WITHIN(4, green(expected[index]), green(result[index]));
+        TEST_ASSERT_INT_WITHIN(4, blue(expected[index]), blue(result[index]));
+    }
+}
+
+void test_bitstream() {
+    TEST_ASSERT_EQUAL_HEX32(0x88888888, bitstream::encode(uint8_t{0x00}));
+    TEST_ASSERT_EQUAL_HEX32(0xeeeeeeee, bitstream::encode(uint8_t{0xff}));
+    TEST_ASSERT_EQUAL_HEX32(0xe8e88e8e, bitstream::encode(uint8_t{0xa5}));
+    TEST_ASSERT_EQUAL_HEX32(0x8888888e, bitstream::encode(uint8_t{0x01}));
+    TEST_ASSERT_EQUAL_HEX32(0xe8888888, bitstream::encode(uint8_t{0x80}));
+}
+
+void test_bitstream_frame() {
+    // two GRB pixels, as they are stored in the strip buffer
+    const uint8_t frame[] {0x12, 0x34, 0x56, 0xff, 0x00, 0x80};
+
+    uint32_t out[std::size(frame)] {};
+    TEST_ASSERT_EQUAL(std::size(frame), bitstream::encode(frame, std::size(frame), out));
+
+    for (size_t index = 0; index < std::size(frame); ++index) {
+        TEST_ASSERT_EQUAL_HEX32(bitstream::encode(frame[index]), out[index]);
+    }
+
+    TEST_ASSERT_EQUAL_HEX32(0x888e88e8, out[0]);
+    TEST_ASSERT_EQUAL_HEX32(0x88ee8e88, out[1]);
+    TEST_ASSERT_EQUAL_HEX32(0x8e8e8ee8, out[2]);
+}
+
+void test_bitstream_reset() {
+    TEST_ASSERT_EQUAL(30, bitstream::ResetWords);
+
+    // strip latches after at least 280us of low line
+    const auto bits = bitstream::ResetWords * 32;
+    TEST_ASSERT(bits * 1000000ull / bitstream::BitRate >= 280);
+}
+
+// not an actual test, only reports frame compute times for both implementations
+void test_benchmark() {
+    using Clock = std::chrono::steady_clock;
+    constexpr size_t Frames { 1000 };
+
+    Lut lut;
+    lut.update(Gamma, 200);
+
+    for (size_t leds : {100, 300, 1000}) {
+        const auto current = make_leds(leds, 5);
+        const auto previous = make_leds(leds, 6);
+
+        std::vector<Packed> out(leds);
+        Packed sink { 0 };
+
+        auto start = Clock::now();
+        for (size_t frame = 0; frame < Frames; ++frame) {
+            const float transc = static_cast<float>(Frames - frame) / Frames;
+            legacy(current.data(), previous.data(), leds, transc, 200, out.data());
+            sink ^= out[frame % leds];
+        }
+        const auto float_time = Clock::now() - start;
+
+        start = Clock::now();
+        for (size_t frame = 0; frame < Frames; ++frame) {
+            const auto weight = static_cast<Weight>((Frames - frame) * WeightMax / Frames);
+            render(current.data(), previous.data(), leds, weight, lut,
+                [&](size_t index, Packed pixel) {
+                    out[index] = pixel;
+                });
+            sink ^= out[frame % leds];
+        }
+        const auto fixed_time = Clock::now() - start;
+
+        using Nanoseconds = std::chrono::duration<double, std::nano>;
+
+        char buffer[128];
+        std::snprintf(buffer, sizeof(buffer),
+            "%4zu leds: float %8.1f ns/frame, fixed %8.1f ns/frame (%08x)",
+            leds,
+            Nanoseconds(float_time).count() / Frames,
+            Nanoseconds(fixed_time).count() / Frames,
+            static_cast<unsigned>(sink));
+        TEST_MESSAGE(buffer);
+    }
+}
+
+} // namespace test
+} // namespace
+} // namespace pixels
+} // namespace garland
+} // namespace espurna
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    using namespace espurna::garland::pixels::test;
+    RUN_TEST(test_pack);
+    RUN_TEST(test_blend);
+    RUN_TEST(test_blend_float);
+    RUN_TEST(test_lut);
+    RUN_TEST(test_render);
+    RUN_TEST(test_bitstream);
+    RUN_TEST(test_bitstream_frame);
+    RUN_TEST(test_bitstream_reset);
+    RUN_TEST(test_benchmark);
+    return UNITY_END();
+}
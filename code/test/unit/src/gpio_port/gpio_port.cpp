@@ -0,0 +1,156 @@
+#include <unity.h>
+#include <Arduino.h>
+
+#include <espurna/gpio_port.h>
+
+#include <vector>
+
+namespace espurna {
+namespace gpio {
+namespace {
+
+namespace test {
+
+// Output latch that remembers every write
+class MockPort : public Port {
+public:
+    explicit MockPort(const char* id) :
+        _id(id)
+    {}
+
+    const char* id() const override {
+        return _id;
+    }
+
+    void write(PortMask mask) override {
+        _writes.push_back(mask);
+        _latch = apply(_latch, mask);
+    }
+
+    const std::vector<PortMask>& writes() const {
+        return _writes;
+    }
+
+    uint32_t latch() const {
+        return _latch;
+    }
+
+private:
+    const char* _id;
+    std::vector<PortMask> _writes;
+    uint32_t _latch { 0 };
+};
+
+// Same as the expander port, every access is a separate SPI transaction
+class MockExpander : public Port {
+public:
+    const char* id() const override {
+        return "expander";
+    }
+
+    void write(PortMask mask) override {
+        ++reads;
+        olat = apply(olat, mask);
+        ++writes;
+    }
+
+    uint8_t olat { 0 };
+    size_t reads { 0 };
+    size_t writes { 0 };
+};
+
+void test_apply() {
+    TEST_ASSERT_EQUAL(0b1010, apply(0b0000, PortMask{.set = 0b1010, .clear = 0}));
+    TEST_ASSERT_EQUAL(0b0010, apply(0b1010, PortMask{.set = 0, .clear = 0b1000}));
+    TEST_ASSERT_EQUAL(0b0110, apply(0b1010, PortMask{.set = 0b0100, .clear = 0b1000}));
+    TEST_ASSERT_EQUAL(0b1111, apply(0b1111, PortMask{.set = 0, .clear = 0}));
+}
+
+void test_single_write() {
+    MockPort port("hardware");
+    PortBatch batch;
+
+    // e.g. 'all on' for 8 relays
+    for (uint8_t pin = 0; pin < 8; ++pin) {
+        batch.write(port, pin, true);
+    }
+
+    TEST_ASSERT_EQUAL(1, batch.pending());
+    TEST_ASSERT_EQUAL(0, port.writes().size());
+
+    batch.commit();
+    TEST_ASSERT_EQUAL(0, batch.pending());
+    TEST_ASSERT_EQUAL(1, port.writes().size());
+    TEST_ASSERT_EQUAL(0xff, port.writes()[0].set);
+    TEST_ASSERT_EQUAL(0, port.writes()[0].clear);
+    TEST_ASSERT_EQUAL(0xff, port.latch());
+
+    // and 'all off'
+    for (uint8_t pin = 0; pin < 8; ++pin) {
+        batch.write(port, pin, false);
+    }
+
+    batch.commit();
+    TEST_ASSERT_EQUAL(2, port.writes().size());
+    TEST_ASSERT_EQUAL(0, port.writes()[1].set);
+    TEST_ASSERT_EQUAL(0xff, port.writes()[1].clear);
+    TEST_ASSERT_EQUAL(0, port.latch());
+
+    // nothing to do
+    batch.commit();
+    TEST_ASSERT_EQUAL(2, port.writes().size());
+}
+
+void test_last_write() {
+    MockPort port("hardware");
+    PortBatch batch;
+
+    batch.write(port, 5, true);
+    batch.write(port, 5, false);
+    batch.write(port, 12, false);
+    batch.write(port, 12, true);
+    batch.write(port, 16, true);
+    batch.commit();
+
+    TEST_ASSERT_EQUAL(1, port.writes().size());
+    TEST_ASSERT_EQUAL((1 << 12) | (1 << 16), port.writes()[0].set);
+    TEST_ASSERT_EQUAL((1 << 5), port.writes()[0].clear);
+}
+
+void test_ports() {
+    MockPort hardware("hardware");
+    MockExpander expander;
+    PortBatch batch;
+
+    // interlocked pair on the expander, plus the hardware ones
+    expander.olat = 0b0000'0001;
+
+    batch.write(expander, 0, false);
+    batch.write(hardware, 4, true);
+    batch.write(expander, 1, true);
+    batch.write(hardware, 5, true);
+    TEST_ASSERT_EQUAL(2, batch.pending());
+
+    batch.commit();
+    TEST_ASSERT_EQUAL(1, hardware.writes().size());
+    TEST_ASSERT_EQUAL((1 << 4) | (1 << 5), hardware.latch());
+
+    TEST_ASSERT_EQUAL(1, expander.writes);
+    TEST_ASSERT_EQUAL(1, expander.reads);
+    TEST_ASSERT_EQUAL(0b0000'0010, expander.olat);
+}
+
+} // namespace test
+} // namespace
+} // namespace gpio
+} // namespace espurna
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    using namespace espurna::gpio::test;
+    RUN_TEST(test_apply);
+    RUN_TEST(test_single_write);
+    RUN_TEST(test_last_write);
+    RUN_TEST(test_ports);
+    return UNITY_END();
+}
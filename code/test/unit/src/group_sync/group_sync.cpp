@@ -0,0 +1,340 @@
+#include <unity.h>
+#include <Arduino.h>
+
+#include <espurna/group_sync_frame.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <vector>
+
+namespace espurna {
+namespace group_sync {
+namespace {
+
+namespace test {
+
+Frame make_light(uint32_t sequence) {
+    Frame out{};
+    out.header = Header{
+        .type = Type::Light,
+        .group = 42,
+        .sender = 0xdeadbeef,
+        .sequence = sequence,
+        .timestamp = 1000,
+        .apply = 1100,
+    };
+    out.light = Light{
+        .state = true,
+        .brightness = 128,
+        .channels = 3,
+        .values = {255, 127, 0, 0, 0},
+        .mireds = 153,
+        .time = 500,
+        .step = 10,
+    };
+
+    return out;
+}
+
+Frame make_relay(uint32_t sequence, uint32_t mask, uint32_t status) {
+    Frame out{};
+    out.header = Header{
+        .type = Type::Relay,
+        .group = 42,
+        .sender = 0xcafe,
+        .sequence = sequence,
+        .timestamp = 0xfffffff0,
+        .apply = 0x10,
+    };
+    out.relay = Relay{
+        .mask = mask,
+        .status = status,
+    };
+
+    return out;
+}
+
+void test_light() {
+    const auto frame = make_light(12345);
+
+    uint8_t buffer[FrameSizeMax];
+    const auto size = encode(frame, buffer, sizeof(buffer));
+    TEST_ASSERT_EQUAL(HeaderSize + LightSize, size);
+
+    Frame out{};
+    TEST_ASSERT(decode(buffer, size, out));
+    TEST_ASSERT(Type::Light == out.header.type);
+    TEST_ASSERT_EQUAL(42, out.header.group);
+    TEST_ASSERT_EQUAL(0xdeadbeef, out.header.sender);
+    TEST_ASSERT_EQUAL(12345, out.header.sequence);
+    TEST_ASSERT_EQUAL(100, out.header.apply - out.header.timestamp);
+
+    TEST_ASSERT(out.light.state);
+    TEST_ASSERT_EQUAL(128, out.light.brightness);
+    TEST_ASSERT_EQUAL(3, out.light.channels);
+    TEST_ASSERT_EQUAL(255, out.light.values[0]);
+    TEST_ASSERT_EQUAL(127, out.light.values[1]);
+    TEST_ASSERT_EQUAL(0, out.light.values[2]);
+    TEST_ASSERT_EQUAL(153, out.light.mireds);
+    TEST_ASSERT_EQUAL(500, out.light.time);
+    TEST_ASSERT_EQUAL(10, out.light.step);
+}
+
+void test_relay() {
+    const auto frame = make_relay(1, 0b1011, 0b0010);
+
+    uint8_t buffer[FrameSizeMax];
+    const auto size = encode(frame, buffer, sizeof(buffer));
+    TEST_ASSERT_EQUAL(HeaderSize + RelaySize, size);
+
+    Frame out{};
+    TEST_ASSERT(decode(buffer, size, out));
+    TEST_ASSERT(Type::Relay == out.header.type);
+    TEST_ASSERT_EQUAL(0b1011, out.relay.mask);
+    TEST_ASSERT_EQUAL(0b0010, out.relay.status);
+
+    // apply is still in the future, even after the sender clock overflows
+    TEST_ASSERT_EQUAL(0x20, out.header.apply - out.header.timestamp);
+}
+
+void test_invalid() {
+    const auto frame = make_light(1);
+
+    uint8_t buffer[FrameSizeMax];
+    const auto size = encode(frame, buffer, sizeof(buffer));
+
+    Frame out{};
+    TEST_ASSERT_FALSE(decode(buffer, size - 1, out));
+    TEST_ASSERT_FALSE(decode(buffer, HeaderSize, out));
+    TEST_ASSERT_FALSE(decode(buffer, 0, out));
+
+    uint8_t longer[FrameSizeMax + 1]{};
+    std::memcpy(longer, buffer, size);
+    TEST_ASSERT_FALSE(decode(longer, size + 1, out));
+
+    auto copy = [&]() {
+        std::vector<uint8_t> out(buffer, buffer + size);
+        return out;
+    };
+
+    auto magic = copy();
+    magic[0] = 'X';
+    TEST_ASSERT_FALSE(decode(magic.data(), magic.size(), out));
+
+    auto version = copy();
+    version[2] = Version + 1;
+    TEST_ASSERT_FALSE(decode(version.data(), version.size(), out));
+
+    auto type = copy();
+    type[3] = 0xff;
+    TEST_ASSERT_FALSE(decode(type.data(), type.size(), out));
+
+    auto channels = copy();
+    channels[HeaderSize + 2] = Light::ChannelsMax + 1;
+    TEST_ASSERT_FALSE(decode(channels.data(), channels.size(), out));
+
+    // too small for the frame
+    uint8_t small[HeaderSize];
+    TEST_ASSERT_EQUAL(0, encode(frame, small, sizeof(small)));
+}
+
+void test_sequence() {
+    Peers peers;
+
+    const uint32_t sequences[] {1, 2, 4, 3, 5, 5, 9};
+    const Peers::Result results[] {
+        Peers::Result::Accepted,
+        Peers::Result::Accepted,
+        Peers::Result::Accepted,
+        Peers::Result::Stale,
+        Peers::Result::Accepted,
+        Peers::Result::Duplicate,
+        Peers::Result::Accepted,
+    };
+
+    for (size_t index = 0; index < std::size(sequences); ++index) {
+        TEST_ASSERT(results[index] == peers.accept(1, sequences[index], index));
+    }
+
+    const auto& stats = peers.stats();
+    TEST_ASSERT_EQUAL(5, stats.accepted);
+    TEST_ASSERT_EQUAL(1, stats.stale);
+    TEST_ASSERT_EQUAL(1, stats.duplicate);
+    TEST_ASSERT_EQUAL(4, stats.lost);
+
+    // sequence numbers wrap around
+    TEST_ASSERT(Peers::Result::Accepted == peers.accept(2, 0xfffffffe, 0));
+    TEST_ASSERT(Peers::Result::Accepted == peers.accept(2, 0xffffffff, 0));
+    TEST_ASSERT(Peers::Result::Accepted == peers.accept(2, 0, 0));
+    TEST_ASSERT(Peers::Result::Stale == peers.accept(2, 0xffffffff, 0));
+    TEST_ASSERT_EQUAL(2, peers.size());
+
+    // sender restarted and its sequence is way behind
+    TEST_ASSERT(Peers::Result::Accepted == peers.accept(3, 1000, 0));
+    TEST_ASSERT(Peers::Result::Stale == peers.accept(3, 1000 - Peers::Window, 10));
+    TEST_ASSERT(Peers::Result::Accepted == peers.accept(3, 1, 20));
+    TEST_ASSERT(Peers::Result::Accepted == peers.accept(3, 2, 30));
+    TEST_ASSERT(Peers::Result::Stale == peers.accept(3, 1, 40));
+
+    // or, was not seen for a while and its sequence is only slightly behind
+    TEST_ASSERT(Peers::Result::Duplicate == peers.accept(3, 2, 40 + Peers::Expiry));
+    TEST_ASSERT(Peers::Result::Accepted == peers.accept(3, 1, 41 + 2 * Peers::Expiry));
+    TEST_ASSERT_EQUAL(2, peers.stats().restarted);
+}
+
+void test_peers() {
+    Peers peers;
+
+    for (uint32_t sender = 0; sender < Peers::Size; ++sender) {
+        TEST_ASSERT(Peers::Result::Accepted == peers.accept(sender, 10, sender));
+    }
+    TEST_ASSERT_EQUAL(Peers::Size, peers.size());
+
+    // sender #0 was seen the earliest, it is the one that is replaced
+    TEST_ASSERT(Peers::Result::Duplicate == peers.accept(1, 10, 100));
+    TEST_ASSERT(Peers::Result::Accepted == peers.accept(Peers::Size, 10, 101));
+    TEST_ASSERT_EQUAL(Peers::Size, peers.size());
+
+    TEST_ASSERT(Peers::Result::Accepted == peers.accept(0, 5, 102));
+    TEST_ASSERT(Peers::Result::Duplicate == peers.accept(1, 10, 103));
+}
+
+// actual sockets, sender side re-orders, repeats and drops some of the frames on its own
+
+struct Socket {
+    Socket() :
+        fd(::socket(AF_INET, SOCK_DGRAM, 0))
+    {}
+
+    ~Socket() {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+
+    bool bind() {
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = 0;
+
+        if (::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+            return false;
+        }
+
+        socklen_t len = sizeof(address);
+        return ::getsockname(fd, reinterpret_cast<sockaddr*>(&address), &len) == 0;
+    }
+
+    bool send(const sockaddr_in& to, const Frame& frame) {
+        uint8_t buffer[FrameSizeMax];
+        const auto size = encode(frame, buffer, sizeof(buffer));
+        return ::sendto(fd, buffer, size, 0,
+            reinterpret_cast<const sockaddr*>(&to), sizeof(to)) == static_cast<ssize_t>(size);
+    }
+
+    int receive(uint8_t* buffer, size_t size, int timeout) {
+        pollfd pfd{};
+        pfd.fd = fd;
+        pfd.events = POLLIN;
+
+        if (::poll(&pfd, 1, timeout) <= 0) {
+            return -1;
+        }
+
+        return ::recv(fd, buffer, size, 0);
+    }
+
+    int fd;
+    sockaddr_in address{};
+};
+
+void test_loopback() {
+    Socket receiver;
+    TEST_ASSERT(receiver.fd >= 0);
+    TEST_ASSERT(receiver.bind());
+
+    Socket sender;
+    TEST_ASSERT(sender.fd >= 0);
+
+    constexpr uint32_t Frames { 50 };
+
+    std::vector<uint32_t> order;
+    for (uint32_t sequence = 1; sequence <= Frames; ++sequence) {
+        // lost
+        if ((sequence % 10) == 0) {
+            continue;
+        }
+
+        // every frame is repeated once
+        order.push_back(sequence);
+        order.push_back(sequence);
+    }
+
+    // arrives after the newer one
+    std::swap(order[8], order[10]);
+    std::swap(order[20], order[24]);
+
+    size_t sent { 0 };
+    for (auto sequence : order) {
+        auto frame = make_relay(sequence, 1, sequence & 1);
+        TEST_ASSERT(sender.send(receiver.address, frame));
+        ++sent;
+    }
+
+    Peers peers;
+    std::vector<uint32_t> applied;
+    uint32_t status { 0 };
+
+    uint8_t buffer[FrameSizeMax + 1];
+    for (size_t received = 0; received < sent; ++received) {
+        const auto size = receiver.receive(buffer, sizeof(buffer), 1000);
+        TEST_ASSERT_GREATER_THAN(0, size);
+
+        Frame frame{};
+        TEST_ASSERT(decode(buffer, size, frame));
+
+        if (Peers::Result::Accepted == peers.accept(
+                frame.header.sender, frame.header.sequence, received))
+        {
+            applied.push_back(frame.header.sequence);
+            status = frame.relay.status;
+        }
+    }
+
+    // applied frames are always in order, the last state is the one from the last frame
+    TEST_ASSERT(std::is_sorted(applied.begin(), applied.end()));
+    TEST_ASSERT(std::adjacent_find(applied.begin(), applied.end()) == applied.end());
+    TEST_ASSERT_EQUAL(Frames - 1, applied.back());
+    TEST_ASSERT_EQUAL((Frames - 1) & 1, status);
+
+    const auto& stats = peers.stats();
+    TEST_ASSERT_EQUAL(applied.size(), stats.accepted);
+    TEST_ASSERT_EQUAL(sent, stats.accepted + stats.duplicate + stats.stale);
+    TEST_ASSERT_EQUAL(6, stats.stale);
+    TEST_ASSERT_EQUAL(Frames - 1 - applied.size(), stats.lost);
+}
+
+} // namespace test
+} // namespace
+} // namespace group_sync
+} // namespace espurna
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    using namespace espurna::group_sync::test;
+    RUN_TEST(test_light);
+    RUN_TEST(test_relay);
+    RUN_TEST(test_invalid);
+    RUN_TEST(test_sequence);
+    RUN_TEST(test_peers);
+    RUN_TEST(test_loopback);
+    return UNITY_END();
+}
@@ -0,0 +1,454 @@
+#include <unity.h>
+#include <Arduino.h>
+
+#include <espurna/light_curve.h>
+#include <espurna/light_transition.h>
+
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+namespace espurna {
+namespace light {
+namespace {
+
+namespace test {
+
+constexpr uint32_t Resolutions[] { 8, 10, 12, 14, 16 };
+
+constexpr uint32_t maximum(uint32_t bits) {
+    return (uint32_t{ 1 } << bits) - 1;
+}
+
+double reference(double lightness) {
+    lightness *= 100.0;
+    return (lightness <= 8.0)
+        ? (lightness / 903.3)
+        : std::pow((lightness + 16.0) / 116.0, 3.0);
+}
+
+void test_edges() {
+    for (auto bits : Resolutions) {
+        const auto max = maximum(bits);
+        TEST_ASSERT_EQUAL(0, curve::cie1931(0, max));
+        TEST_ASSERT_EQUAL(max, curve::cie1931(curve::Unit, max));
+        TEST_ASSERT_EQUAL(max, curve::cie1931(curve::Unit * 2, max));
+
+        TEST_ASSERT_EQUAL(0, curve::linear(0, max));
+        TEST_ASSERT_EQUAL(max, curve::linear(curve::Unit, max));
+    }
+}
+
+void test_reference() {
+    for (auto bits : Resolutions) {
+        const auto max = maximum(bits);
+        for (uint32_t input = 0; input <= curve::Unit; input += 7) {
+            const auto expected = reference(static_cast<double>(input) / curve::Unit) * max;
+            const auto value = curve::cie1931(input, max);
+            TEST_ASSERT_FLOAT_WITHIN(1.0f, expected, static_cast<float>(value));
+        }
+    }
+}
+
+void test_monotonic() {
+    for (auto bits : Resolutions) {
+        const auto max = maximum(bits);
+
+        uint32_t last { 0 };
+        for (uint32_t input = 0; input <= curve::Unit; ++input) {
+            const auto value = curve::cie1931(input, max);
+            TEST_ASSERT_GREATER_OR_EQUAL(last, value);
+            last = value;
+        }
+    }
+}
+
+// how many output levels are actually reachable, when the input is either
+// the old 8bit gamma table index or the full Q16 fixed point value
+void test_levels() {
+    for (auto bits : Resolutions) {
+        const auto max = maximum(bits);
+
+        uint32_t coarse { 0 };
+        uint32_t last { 0 };
+        for (uint32_t input = 0; input <= 255; ++input) {
+            const auto value = curve::cie1931((input * curve::Unit) / 255, max);
+            if (!input || (value != last)) {
+                ++coarse;
+            }
+            last = value;
+        }
+
+        uint32_t fine { 0 };
+        uint32_t low { 0 };
+        for (uint32_t input = 0; input <= curve::Unit; ++input) {
+            const auto value = curve::cie1931(input, max);
+            if (!input || (value != last)) {
+                ++fine;
+                if (input < (curve::Unit / 4)) {
+                    ++low;
+                }
+            }
+            last = value;
+        }
+
+        TEST_ASSERT_GREATER_OR_EQUAL(coarse, fine);
+        if (bits > 8) {
+            TEST_ASSERT_GREATER_THAN(coarse, fine);
+        }
+
+        char buffer[128];
+        std::snprintf(buffer, sizeof(buffer),
+            "%2u bit: %u levels from 8bit input, %u from Q16 (%u in the lower quarter)",
+            bits, coarse, fine, low);
+        TEST_MESSAGE(buffer);
+    }
+}
+
+constexpr Easing Easings[] { Easing::Linear, Easing::InOut, Easing::Exponential };
+
+void test_easing() {
+    for (auto easing : Easings) {
+        TEST_ASSERT_EQUAL(0, transition::ease(easing, 0));
+        TEST_ASSERT_EQUAL(transition::One, transition::ease(easing, transition::One));
+
+        uint32_t last { 0 };
+        for (uint32_t progress = 0; progress <= transition::One; ++progress) {
+            const auto value = transition::ease(easing, progress);
+            TEST_ASSERT_GREATER_OR_EQUAL(last, value);
+            TEST_ASSERT_LESS_OR_EQUAL(transition::One, value);
+            last = value;
+        }
+    }
+
+    // halfway point of the symmetric curve
+    TEST_ASSERT_EQUAL(transition::One / 2,
+        transition::ease(Easing::InOut, transition::One / 2));
+
+    // exponential curve stays low for most of the time
+    TEST_ASSERT_LESS_THAN(transition::One / 32,
+        transition::ease(Easing::Exponential, transition::One / 2));
+}
+
+void test_same_tick() {
+    const long targets[] { 255, 0, 128, 17, 255 };
+
+    for (auto easing : Easings) {
+        for (uint32_t steps : {1u, 2u, 3u, 50u, 333u, 1000u}) {
+            std::array<transition::Fixed, 5> values {
+                transition::fixed(0),
+                transition::fixed(255),
+                transition::fixed(128),
+                transition::fixed(200),
+                transition::fixed(1),
+            };
+
+            transition::Engine engine(easing, steps);
+            for (size_t index = 0; index < values.size(); ++index) {
+                engine.add(values[index], transition::fixed(targets[index]));
+            }
+
+            std::array<size_t, 5> calls{};
+            std::array<transition::Fixed, 5> last = values;
+
+            uint32_t runs { 0 };
+            bool next { true };
+            while (next) {
+                next = engine.run([&](size_t index, transition::Fixed value) {
+                    ++calls[index];
+                    // value never goes past the target and does not go backwards
+                    if (targets[index] * transition::One >= last[index]) {
+                        TEST_ASSERT_GREATER_OR_EQUAL(last[index], value);
+                    } else {
+                        TEST_ASSERT_LESS_OR_EQUAL(last[index], value);
+                    }
+                    last[index] = value;
+                });
+                ++runs;
+                TEST_ASSERT_LESS_OR_EQUAL(steps, runs);
+            }
+
+            TEST_ASSERT_EQUAL(steps, runs);
+            TEST_ASSERT_FALSE(engine.run([](size_t, transition::Fixed) {
+                TEST_FAIL_MESSAGE("no more steps");
+            }));
+
+            for (size_t index = 0; index < values.size(); ++index) {
+                TEST_ASSERT_EQUAL(transition::fixed(targets[index]), values[index]);
+            }
+
+            // unchanged channel is only sent out once, every other one on every step
+            TEST_ASSERT_EQUAL(1, calls[2]);
+            TEST_ASSERT_EQUAL(steps, calls[0]);
+            TEST_ASSERT_EQUAL(steps, calls[4]);
+        }
+    }
+}
+
+void test_immediate() {
+    transition::Fixed value { transition::fixed(10) };
+    transition::Fixed other { transition::fixed(20) };
+
+    transition::Engine engine(Easing::Linear, 1);
+    TEST_ASSERT_FALSE(engine.add(value, transition::fixed(100)));
+    TEST_ASSERT_FALSE(engine.add(other, transition::fixed(20)));
+
+    size_t calls { 0 };
+    TEST_ASSERT_FALSE(engine.run([&](size_t, transition::Fixed) {
+        ++calls;
+    }));
+
+    TEST_ASSERT_EQUAL(2, calls);
+    TEST_ASSERT_EQUAL(transition::fixed(100), value);
+}
+
+void test_frames() {
+    struct Frame {
+        std::array<transition::Fixed, 2> values;
+    };
+
+    transition::FrameRing<Frame, 4> frames;
+
+    transition::Fixed value { transition::fixed(0) };
+    transition::Fixed constant { transition::fixed(128) };
+
+    // only the first frame receives the constant value
+    transition::Engine engine(Easing::Linear, 10);
+    TEST_ASSERT(engine.add(value, transition::fixed(255)));
+    TEST_ASSERT_FALSE(engine.add(constant, transition::fixed(128)));
+
+    std::vector<Frame> out;
+
+    bool next { true };
+    while (next) {
+        while (next && !frames.full()) {
+            auto& frame = frames.next();
+            next = engine.run([&](size_t index, transition::Fixed result) {
+                frame.values[index] = result;
+            });
+            frames.push();
+        }
+
+        while (frames.size()) {
+            out.push_back(frames.pop());
+        }
+    }
+
+    TEST_ASSERT_EQUAL(10, out.size());
+    for (const auto& frame : out) {
+        TEST_ASSERT_EQUAL(transition::fixed(128), frame.values[1]);
+    }
+
+    TEST_ASSERT_EQUAL(transition::fixed(255), out.back().values[0]);
+
+    // dropped frames are never seen, next one continues from the last popped frame
+    auto& frame = frames.next();
+    frame.values[0] = transition::fixed(1);
+    frames.push();
+
+    TEST_ASSERT_EQUAL(1, frames.clear());
+    TEST_ASSERT_EQUAL(transition::fixed(255), frames.next().values[0]);
+    TEST_ASSERT_EQUAL(transition::fixed(128), frames.next().values[1]);
+}
+
+void test_color_hsv() {
+    const transition::Color red{1.0f, 0.0f, 0.0f};
+    const transition::Color green{0.0f, 1.0f, 0.0f};
+
+    // same hue distance, but through yellow instead of the dark olive
+    const auto middle = transition::interpolate(ColorSpace::Hsv, red, green, 0.5f);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 1.0f, middle.red);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 1.0f, middle.green);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.0f, middle.blue);
+
+    const auto channels = transition::interpolate(ColorSpace::Channels, red, green, 0.5f);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.5f, channels.red);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.5f, channels.green);
+
+    // 350deg to 10deg goes through red, not through the rest of the wheel
+    const transition::Color before{1.0f, 0.0f, 1.0f / 6.0f};
+    const transition::Color after{1.0f, 1.0f / 6.0f, 0.0f};
+
+    const auto wrap = transition::interpolate(ColorSpace::Hsv, before, after, 0.5f);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 1.0f, wrap.red);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.0f, wrap.green);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.0f, wrap.blue);
+
+    // white has no hue of its own
+    const transition::Color white{1.0f, 1.0f, 1.0f};
+    const auto pale = transition::interpolate(ColorSpace::Hsv, white, green, 0.5f);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.5f, pale.red);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 1.0f, pale.green);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.5f, pale.blue);
+}
+
+void test_color_oklab() {
+    const transition::Color red{1.0f, 0.0f, 0.0f};
+    const transition::Color green{0.0f, 1.0f, 0.0f};
+
+    const ColorSpace spaces[] {ColorSpace::Channels, ColorSpace::Hsv, ColorSpace::Oklab};
+    for (auto space : spaces) {
+        const auto from = transition::interpolate(space, red, green, 0.0f);
+        TEST_ASSERT_EQUAL_FLOAT(red.red, from.red);
+        TEST_ASSERT_EQUAL_FLOAT(red.green, from.green);
+
+        const auto to = transition::interpolate(space, red, green, 1.0f);
+        TEST_ASSERT_EQUAL_FLOAT(green.red, to.red);
+        TEST_ASSERT_EQUAL_FLOAT(green.green, to.green);
+    }
+
+    // roundtrip through the color space does not change the color
+    const transition::Color orange{1.0f, 0.5f, 0.25f};
+    const auto same = transition::interpolate(ColorSpace::Oklab, orange, orange, 0.5f);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, orange.red, same.red);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, orange.green, same.green);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, orange.blue, same.blue);
+
+    // per-channel middle has the least amount of light
+    const auto middle = transition::interpolate(ColorSpace::Oklab, red, green, 0.5f);
+    const auto channels = transition::interpolate(ColorSpace::Channels, red, green, 0.5f);
+    TEST_ASSERT((middle.red + middle.green) > (channels.red + channels.green));
+    TEST_ASSERT_FLOAT_WITHIN(0.05f, 0.0f, middle.blue);
+}
+
+void test_path() {
+    transition::Engine::Path path;
+    for (size_t index = 0; index < path.size(); ++index) {
+        path[index] = transition::fixed(static_cast<long>(index * index * 2));
+    }
+
+    transition::Fixed value { transition::fixed(10) };
+
+    constexpr uint32_t Steps { 64 };
+    transition::Engine engine(Easing::Linear, Steps);
+    TEST_ASSERT(engine.add(value, path));
+
+    // first point is replaced with the current value
+    std::vector<transition::Fixed> values;
+    values.push_back(value);
+    while (engine.run([&](size_t, transition::Fixed current) {
+        values.push_back(current);
+    })) {
+    }
+
+    TEST_ASSERT_EQUAL(Steps + 1, values.size());
+    TEST_ASSERT_EQUAL(transition::fixed(10), values.front());
+    TEST_ASSERT_EQUAL(path.back(), values.back());
+    TEST_ASSERT_EQUAL(path.back(), value);
+
+    // every other point is reached exactly, since the steps divide evenly
+    constexpr auto Stride = Steps / (transition::Engine::PathPoints - 1);
+    for (size_t index = 1; index < path.size(); ++index) {
+        TEST_ASSERT_EQUAL(path[index], values[index * Stride]);
+    }
+
+    // nothing to do when path is already at the target
+    transition::Engine::Path flat;
+    flat.fill(value);
+
+    transition::Engine other(Easing::Linear, Steps);
+    TEST_ASSERT_FALSE(other.add(value, flat));
+}
+
+// previous implementation, `value += step` for `count` times
+struct FloatRamp {
+    float& value;
+    long target;
+    float step;
+    size_t count;
+};
+
+using Clock = std::chrono::steady_clock;
+using Duration = std::chrono::duration<double, std::nano>;
+
+template <typename T>
+Duration measure(size_t iterations, T&& callback) {
+    const auto start = Clock::now();
+    for (size_t iteration = 0; iteration < iterations; ++iteration) {
+        callback();
+    }
+
+    return std::chrono::duration_cast<Duration>(Clock::now() - start) / iterations;
+}
+
+void test_benchmark() {
+    constexpr size_t Channels { 5 };
+    constexpr uint32_t Steps { 1000 };
+    constexpr size_t Iterations { 200 };
+
+    volatile uint32_t sink { 0 };
+
+    const auto reference = measure(Iterations, [&]() {
+        std::array<float, Channels> values{};
+        std::vector<FloatRamp> ramps;
+        for (auto& value : values) {
+            ramps.push_back(FloatRamp{value, 255, 255.0f / Steps, Steps});
+        }
+
+        bool next { true };
+        while (next) {
+            next = false;
+            for (auto& ramp : ramps) {
+                if (!ramp.count) {
+                    continue;
+                }
+
+                if (--ramp.count) {
+                    ramp.value += ramp.step;
+                    next = true;
+                } else {
+                    ramp.value = ramp.target;
+                }
+
+                sink = sink + static_cast<uint32_t>(ramp.value);
+            }
+        }
+    }) / Steps;
+
+    for (auto easing : Easings) {
+        const auto fixed = measure(Iterations, [&]() {
+            std::array<transition::Fixed, Channels> values{};
+
+            transition::Engine engine(easing, Steps);
+            for (auto& value : values) {
+                engine.add(value, transition::fixed(255));
+            }
+
+            while (engine.run([&](size_t, transition::Fixed value) {
+                sink = sink + static_cast<uint32_t>(value);
+            })) {
+            }
+        }) / Steps;
+
+        char buffer[128];
+        std::snprintf(buffer, sizeof(buffer),
+            "%zu channels, easing #%d: %.1fns per step (float linear %.1fns)",
+            Channels, static_cast<int>(easing), fixed.count(), reference.count());
+        TEST_MESSAGE(buffer);
+    }
+}
+
+} // namespace test
+} // namespace
+} // namespace light
+} // namespace espurna
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    using namespace espurna::light::test;
+    RUN_TEST(test_edges);
+    RUN_TEST(test_reference);
+    RUN_TEST(test_monotonic);
+    RUN_TEST(test_levels);
+    RUN_TEST(test_easing);
+    RUN_TEST(test_same_tick);
+    RUN_TEST(test_immediate);
+    RUN_TEST(test_frames);
+    RUN_TEST(test_color_hsv);
+    RUN_TEST(test_color_oklab);
+    RUN_TEST(test_path);
+    RUN_TEST(test_benchmark);
+    return UNITY_END();
+}
@@ -294,6 +294,65 @@ void test_case_insensitive() {
     TEST_ASSERT(find_and_call(input, DefaultOutput));
 }
 
+// commands are looked up through the name hash, make sure that names are still compared
+// ref. known FNV-1a 32bit collisions
+void test_hash_collisions() {
+    TEST_ASSERT_EQUAL(
+        parser::lowercase_fnv1_hash("costarring"),
+        parser::lowercase_fnv1_hash("liquid"));
+    TEST_ASSERT_EQUAL(
+        parser::lowercase_fnv1_hash("declinate"),
+        parser::lowercase_fnv1_hash("MACALLUMS"));
+
+    static int costarring = 0;
+    static int liquid = 0;
+    static int declinate = 0;
+
+    static Command commands[] {
+        Command{.name = "costarring", .func = [](CommandContext&&) {
+            ++costarring;
+        }},
+        Command{.name = "liquid", .func = [](CommandContext&&) {
+            ++liquid;
+        }},
+        Command{.name = "declinate", .func = [](CommandContext&&) {
+            ++declinate;
+        }},
+    };
+
+    add(Commands{std::begin(commands), std::end(commands)});
+
+    TEST_ASSERT(find_and_call("LIQUID", DefaultOutput));
+    TEST_ASSERT(find_and_call("costarring", DefaultOutput));
+    TEST_ASSERT(find_and_call("liquid", DefaultOutput));
+    TEST_ASSERT(find_and_call("declinate", DefaultOutput));
+
+    TEST_ASSERT_EQUAL(1, costarring);
+    TEST_ASSERT_EQUAL(2, liquid);
+    TEST_ASSERT_EQUAL(1, declinate);
+
+    PrintString out(64);
+    TEST_ASSERT(!find_and_call("macallums", DefaultOutput, out));
+    TEST_ASSERT_EQUAL_STRING("-ERROR: Command not found\n", out.c_str());
+}
+
+// lookup table is rebuilt when more commands are added after the first search
+void test_lookup_after_add() {
+    static int command_calls = 0;
+
+    TEST_ASSERT_NULL(find("test.lookup.late"));
+    const auto before = size();
+
+    add("test.lookup.late", [](CommandContext&&) {
+        ++command_calls;
+    });
+
+    TEST_ASSERT_EQUAL(before + 1, size());
+    TEST_ASSERT_NOT_NULL(find("TEST.LOOKUP.LATE"));
+    TEST_ASSERT(find_and_call("test.lookup.late", DefaultOutput));
+    TEST_ASSERT_EQUAL(1, command_calls);
+}
+
 // We can use command ctx.output to send something back into the stream
 void test_output() {
     add("test.output", [](CommandContext&& ctx) {
@@ -462,6 +521,8 @@ int main(int, char**) {
     RUN_TEST(test_hex_codes);
     RUN_TEST(test_quotes);
     RUN_TEST(test_case_insensitive);
+    RUN_TEST(test_hash_collisions);
+    RUN_TEST(test_lookup_after_add);
     RUN_TEST(test_output);
     RUN_TEST(test_new_line);
     RUN_TEST(test_line_view);
@@ -0,0 +1,165 @@
+#include <unity.h>
+#include <Arduino.h>
+
+#include <espurna/system_timer_wheel.h>
+
+#include <utility>
+#include <vector>
+
+namespace espurna {
+namespace timer {
+namespace wheel {
+namespace {
+
+namespace test {
+
+void test_once() {
+    int fired = 0;
+
+    Timer timer;
+    timer.start(3, [&]() {
+        ++fired;
+    }, false);
+    TEST_ASSERT(timer.armed());
+
+    advance(2);
+    TEST_ASSERT_EQUAL(0, fired);
+
+    advance(1);
+    TEST_ASSERT_EQUAL(1, fired);
+    TEST_ASSERT_FALSE(timer.armed());
+    TEST_ASSERT(idle());
+
+    advance(100);
+    TEST_ASSERT_EQUAL(1, fired);
+}
+
+void test_repeat() {
+    int fired = 0;
+
+    Timer timer;
+    timer.start(5, [&]() {
+        ++fired;
+    }, true);
+
+    for (int tick = 0; tick < 50; ++tick) {
+        advance(1);
+    }
+
+    TEST_ASSERT_EQUAL(10, fired);
+    TEST_ASSERT(timer.armed());
+
+    timer.stop();
+    TEST_ASSERT(idle());
+}
+
+// longer than the first level, the node has to cascade down before firing
+void test_cascade() {
+    std::vector<uint32_t> fired;
+    uint32_t now = 0;
+
+    Timer short_timer;
+    short_timer.start(70, [&]() {
+        fired.push_back(now);
+    }, false);
+
+    Timer long_timer;
+    long_timer.start(5000, [&]() {
+        fired.push_back(now);
+    }, false);
+
+    for (; now < 6000; ++now) {
+        advance(1);
+    }
+
+    TEST_ASSERT_EQUAL(2, fired.size());
+    TEST_ASSERT_EQUAL(69, fired[0]);
+    TEST_ASSERT_EQUAL(4999, fired[1]);
+    TEST_ASSERT(idle());
+}
+
+// replaced timer is unlinked before its node is destroyed,
+// moved one stays linked and fires as usual
+void test_move_assign_armed() {
+    int first = 0;
+    int second = 0;
+
+    Timer target;
+    target.start(10, [&]() {
+        ++first;
+    }, true);
+
+    Timer source;
+    source.start(20, [&]() {
+        ++second;
+    }, false);
+
+    TEST_ASSERT_EQUAL(2, stats().active);
+
+    target = std::move(source);
+    TEST_ASSERT_EQUAL(1, stats().active);
+    TEST_ASSERT(target.armed());
+    TEST_ASSERT_FALSE(source.armed());
+
+    advance(20);
+    TEST_ASSERT_EQUAL(0, first);
+    TEST_ASSERT_EQUAL(1, second);
+    TEST_ASSERT(idle());
+
+    Timer moved(std::move(target));
+    moved.start(5, [&]() {
+        ++second;
+    }, false);
+
+    {
+        Timer other;
+        other.start(5, [&]() {
+            ++first;
+        }, false);
+        other = std::move(moved);
+    }
+
+    TEST_ASSERT(idle());
+    advance(10);
+    TEST_ASSERT_EQUAL(0, first);
+    TEST_ASSERT_EQUAL(1, second);
+}
+
+// callback is allowed to replace its own timer
+void test_move_assign_from_callback() {
+    int fired = 0;
+
+    Timer timer;
+    timer.start(1, [&]() {
+        Timer next;
+        next.start(1, [&]() {
+            ++fired;
+        }, false);
+        timer = std::move(next);
+    }, true);
+
+    advance(1);
+    TEST_ASSERT_EQUAL(0, fired);
+    TEST_ASSERT_EQUAL(1, stats().active);
+
+    advance(1);
+    TEST_ASSERT_EQUAL(1, fired);
+    TEST_ASSERT(idle());
+}
+
+} // namespace test
+} // namespace
+} // namespace wheel
+} // namespace timer
+} // namespace espurna
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    using namespace espurna::timer::wheel::test;
+    RUN_TEST(test_once);
+    RUN_TEST(test_repeat);
+    RUN_TEST(test_cascade);
+    RUN_TEST(test_move_assign_armed);
+    RUN_TEST(test_move_assign_from_callback);
+    return UNITY_END();
+}